@@ -1,10 +1,6 @@
 #!/bin/bash
 source "$HOME/oss-cad-suite/environment"
 
-if [ -f ./synth.blif ]; then
-  echo "skipping synthesis, BLIF file already exists."
-fi
-
 if [ "$#" -ne 1 ]; then
   echo "Usage: $0 verilog_file" >&2
   exit 1
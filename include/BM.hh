@@ -1,9 +1,10 @@
 #ifndef BELLARE_MICALI_OT_PROTOCOL_HH
 #define BELLARE_MICALI_OT_PROTOCOL_HH
 
-#include "QuadraticResidueGroup.hh"
+#include "PrimeOrderGroup.hh"
 #include "MessageHandler.hh"
 #include "State.hh"
+#include "WireFormat.hh"
 
 // This Oblivious Transfer (OT) protocol was
 // first introduced by Bellare and Micali,
@@ -13,19 +14,27 @@
 
 namespace BM {
   const int MSG_NUM_BASE = 16;
+  // Exponentiations per transfer: the sender draws a random generator
+  // and encrypts both messages (two exponentiations each);
+  // the chooser computes its public key and its decryption key.
+  const unsigned SENDER_EXP_COUNT = 5;
+  const unsigned CHOOSER_EXP_COUNT = 2;
 
   class ParameterSet {
   public:
     unsigned securityParameter;
-    QuadraticResidueGroup group;
+    // Shared by all protocol states (and by nested protocols).
+    GroupPtr group;
+    WireFormat wireFormat = WireFormat::TEXT;
   };
 
   class SenderMemory {
   public:
     BigInt constant;
     BigInt publicKeys[2];
+    // Messages are hex strings.
     std::string messages[2];
-    std::string encryptionElements[2];
+    BigInt encryptionElements[2];
     std::string encryptedMessages[2];
     std::string receivedMessage;
   };
@@ -51,7 +60,7 @@ namespace BM {
     BigInt senderConstant;
     BigInt key;
     bool sigma;
-    std::string encryptionElement;
+    BigInt encryptionElement;
     std::string encryptedMessage;
     std::string chosenMessage;
     // Not to be confused with Sender's messages;
@@ -0,0 +1,36 @@
+#ifndef BIT_SLICED_EVALUATOR_HH
+#define BIT_SLICED_EVALUATOR_HH
+
+#include <cstdint>
+#include <vector>
+#include "Circuit.hh"
+
+// A BitSlicedEvaluator evaluates a circuit on many independent inputs
+// at once, in plaintext. Every driver holds a *slice* of `words` 64-bit
+// words; bit j of word w belongs to input vector (64 * w + j).
+// A gate is then a single bitwise operation across all lanes.
+// Depending on the CPU (checked at runtime), slices of 64, 256 or 512
+// lanes are evaluated with uint64, AVX2 or AVX-512 instructions.
+class BitSlicedEvaluator {
+public:
+  explicit BitSlicedEvaluator(Circuit& circuit);
+  // Number of 64-bit words per slice that the widest
+  // instruction set supported by this CPU can process at once.
+  static unsigned nativeWords();
+  // Evaluates the circuit on every input vector,
+  // and returns the output vectors in the same order.
+  // Results are identical to calling Circuit::evaluate on each input.
+  std::vector<ValueWord> evaluate(const std::vector<ValueWord>& inputs);
+  // Raw interface. `inputs` holds one slice per circuit input,
+  // `outputs` receives one slice per circuit output;
+  // both are stored slice after slice (i.e., inputs[i * words + w]).
+  // `words` must be 1, 4 or 8.
+  void evaluateSliced(
+    const uint64_t* inputs, uint64_t* outputs, unsigned words);
+private:
+  Circuit& circuit;
+  // Slices of all drivers, indexed by driver ID.
+  std::vector<uint64_t> values;
+};
+
+#endif
@@ -1,56 +1,161 @@
 #ifndef CIIRCUIT_HH
 #define CIIRCUIT_HH
 
+#include <cstdint>
 #include <vector>
-#include <memory>
 
-// A `Driver` is an entity that can drive a gate.
-// This can be either a gate, or an input wire to the circuit.
-// All drivers are managed inside a `Circuit`;
-// so, they can refer to each other by their ID's.
-class Driver {
-public:
-  unsigned id;
-  Driver(unsigned id);
-  void drive(unsigned gateId);
-  // A driver can 'drive' multiple gates,
-  // ID's of which are stored in `drivenGates`.
-  std::vector<unsigned> drivenGates;
-};
-
-typedef std::unique_ptr<Driver> DriverPtr;
 typedef std::vector<bool> ValueWord;
 typedef std::vector<unsigned> Word;
 
-class Gate : public Driver {
+// Placeholder for the (non-existent) input drivers of a circuit input.
+const uint32_t NO_DRIVER = UINT32_MAX;
+
+// Boolean function computed by a gate.
+// A NOT gate has a single input, stored as both its left and right input.
+enum class GateType : uint8_t { NAND, AND, OR, XOR, XNOR, NOT };
+const unsigned GATE_TYPE_COUNT = 6;
+
+bool evaluateGate(GateType type, bool left, bool right);
+// Names of gate types, as in Yosys cells (e.g., "XOR" for $_XOR_).
+const char* gateTypeName(GateType type);
+
+// A `DriverRange` is a contiguous range [begin, end) of driver ID's.
+struct DriverRange {
+  unsigned begin;
+  unsigned end;
+  unsigned size() const;
+};
+
+// A `Levelization` groups the gates of a circuit by their depth.
+// Inputs are at level 0, and every gate is one level above
+// its deepest input; so, gates of the same level
+// do not depend on each other and can be processed together.
+class Levelization {
+public:
+  // levels[id] is the level of driver `id`.
+  std::vector<uint32_t> levels;
+  // Gate ID's sorted by level;
+  // within a level, ID's are in ascending order.
+  std::vector<uint32_t> order;
+  // Gates of level k (k >= 1) are
+  // order[offsets[k - 1] .. offsets[k]).
+  std::vector<uint32_t> offsets;
+  // Number of gate levels; i.e., the depth of the circuit.
+  unsigned depth();
+  // Positions in `order` of the gates of level k (k >= 1).
+  DriverRange level(unsigned k);
+  unsigned width(unsigned k);
+  unsigned maxWidth();
+  double averageWidth();
+};
+
+// A `SlotAllocation` maps the drivers of a circuit to the slots
+// of a compact label store, for evaluation level by level.
+// A label is live from its own level up to the deepest level
+// that reads it, and output labels are live to the end.
+// A slot freed at level k is only reused from level k + 1 on;
+// so, the gates of a level can still be evaluated in parallel.
+// Inputs keep their ID's as slots. The number of slots
+// follows the width of the circuit, rather than its size.
+class SlotAllocation {
 public:
-  Gate(unsigned id, unsigned inputLeft, unsigned inputRight);
-  unsigned inputLeft;
-  unsigned inputRight;
+  // slots[id] is the slot of driver `id`.
+  std::vector<uint32_t> slots;
+  unsigned slotCount = 0;
 };
 
+// A *driver* is an entity that can drive a gate.
+// This can be either a gate, or an input wire to the circuit.
+// All drivers are managed inside a `Circuit`,
+// and they refer to each other by their ID's.
+//
+// The circuit is stored as a structure of arrays:
+// every attribute of a driver is kept in a contiguous array,
+// indexed by the driver ID. Drivers are laid out as follows:
+//   [ inputs | internal gates | output gates ]
+// A gate only refers to drivers with smaller ID's;
+// so, visiting drivers in ascending order of ID's
+// is a topological traversal of the circuit.
 class Circuit {
 public:
   Circuit(unsigned inputLength, unsigned outputLength);
-  unsigned addGate(unsigned inputLeft, unsigned inputRight);
-  std::vector<Driver*> shuffle();
-  std::vector<Driver*> get();
+  unsigned addGate(
+    unsigned inputLeft, unsigned inputRight,
+    GateType type = GateType::NAND);
+  unsigned addNot(unsigned input);
+  // Method shuffle() returns all driver ID's in a random order;
+  // the i-th element is the ID of the driver at position i.
+  // Inputs and outputs stay in place, only internals are shuffled.
+  // With a block size, gates are only shuffled within blocks of
+  // that many gates (in ID order); so, gates streamed in chunks
+  // of that size (see levelize()) stay in their chunks.
+  Word shuffle(unsigned blockSize = 0);
+  // Outputs are moved to the end of the circuit, in the given order.
+  // Outputs that cannot be moved (inputs, gates with fanout,
+  // and repeated outputs) are aliased to a new copy gate:
+  // a duplicate of the gate (of the same type and inputs),
+  // which costs no more than the gate itself in any scheme,
+  // or AND(x, x) for an input x.
+  // NOTE: this renumbers all gates following the first output gate.
   void updateOutputs(Word outputIds);
-  // Method size() returns the number of *drivers* in the circuit,
-  // i.e., this->drivers.size().
+  // Method size() returns the number of *drivers* in the circuit.
   unsigned size();
+  unsigned gateCount();
+  DriverRange inputs();
+  DriverRange internals();
+  DriverRange outputs();
+  // Internal and output gates together.
+  DriverRange gates();
+  unsigned inputLeft(unsigned id);
+  unsigned inputRight(unsigned id);
+  // Type of gate `id`; inputs are reported as NAND gates.
+  GateType gateType(unsigned id);
+  // Number of gates of the given type.
+  unsigned gateCount(GateType type);
+  // An equivalent circuit with only NAND gates, for protocols
+  // (e.g., LWY) that hide gate types from the garbler.
+  // Inputs and outputs stay in place; other gates are expanded,
+  // and NAND gates of the same inputs are shared; so, a copy
+  // of an output (see updateOutputs()) takes a single NAND gate.
+  Circuit toNand();
+  // An equivalent circuit whose output copies (see updateOutputs())
+  // are XOR gates of their driver and a shared zero, for garbling
+  // schemes with free XOR, in which they cost nothing.
+  // An output gate is a copy if it is AND(x, x) or OR(x, x),
+  // or if an internal gate has the same type and inputs.
+  Circuit withXorCopies();
+  // Gates driven by driver `id`, in ascending order of their ID's.
+  Word fanout(unsigned id);
+  unsigned fanoutCount(unsigned id);
+  // Computes the level of every driver, in linear time.
+  // With a chunk size, gates are evaluated chunk by chunk, as they
+  // are streamed (chunks of that many gates, in ID order), and level
+  // by level within a chunk; so, the levels of every chunk are put
+  // above those of earlier chunks.
+  Levelization levelize(unsigned chunkSize = 0);
+  // Label slots for evaluating the gates (with outputs)
+  // in the order of the given levelization.
+  SlotAllocation allocateSlots(Levelization& levelization);
   ValueWord evaluate(ValueWord input);
   ValueWord probe(ValueWord input, Word probed);
 private:
-  // A particular gate can be picked with just an ID,
-  // as all gates are NAND gates.
+  friend class BitSlicedEvaluator;
+  friend class CircuitCache;
   unsigned inputLength;
   unsigned outputLength;
-  unsigned counter;
-  std::vector<DriverPtr> inputs;
-  std::vector<DriverPtr> internals;
-  std::vector<DriverPtr> outputs;
-  Driver* findDriver(unsigned id);
+  bool hasOutputs = false;
+  // For inputs, `left` and `right` hold NO_DRIVER.
+  std::vector<uint32_t> left;
+  std::vector<uint32_t> right;
+  std::vector<GateType> types;
+  std::vector<uint32_t> fanoutCounts;
+  // Fanout of all drivers in compressed sparse row form:
+  // gates driven by `id` are in
+  // fanoutTargets[fanoutOffsets[id] .. fanoutOffsets[id + 1]).
+  // These arrays are (re)built lazily by indexFanout().
+  std::vector<uint32_t> fanoutOffsets;
+  std::vector<uint32_t> fanoutTargets;
+  void indexFanout();
   ValueWord evaluateInternal(ValueWord input);
 };
 
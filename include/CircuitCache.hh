@@ -0,0 +1,52 @@
+#ifndef CIRCUIT_CACHE_HH
+#define CIRCUIT_CACHE_HH
+
+#include <cstddef>
+#include <string>
+#include "Circuit.hh"
+
+// A CircuitCache keeps compiled circuits (i.e., synthesised and
+// optimized specs) in a directory, so that the monitor only runs
+// Yosys when the spec or the synthesis script changes.
+// Circuits are content-addressed: a cache file is named after
+// a hash of the spec, the synthesis script and the file format.
+//
+// A cache file is a CircuitFileHeader followed by the `left`
+// and `right` arrays (uint32) and the `types` array (uint8)
+// of the circuit, in native byte order. Loading maps the file
+// into memory and copies the arrays into the circuit as they are.
+
+class CircuitCache {
+public:
+  // An empty `directory` disables the cache.
+  explicit CircuitCache(std::string directory = DEFAULT_DIRECTORY);
+  // The compiled circuit of a spec: from the cache if present;
+  // otherwise, the spec is synthesised (or, for a `.bristol` file,
+  // read) and optimized, and the result is stored in the cache.
+  // The circuit must have the given monitor and system state inputs,
+  // and an output for each monitor state bit and the flag bit;
+  // a `.bristol` file must also split its inputs that way.
+  // Throws std::invalid_argument otherwise.
+  Circuit compile(
+    const std::string& specFileName,
+    unsigned monitorStateLength, unsigned systemStateLength);
+  // Hex digest of the spec and the synthesis script;
+  // empty if either of them cannot be read.
+  static std::string key(
+    const std::string& specFileName, const std::string& scriptFileName);
+  bool load(const std::string& key, Circuit& circuit);
+  void store(const std::string& key, Circuit& circuit);
+  std::string fileName(const std::string& key);
+
+  static constexpr const char* DEFAULT_DIRECTORY = ".circuit-cache";
+  static constexpr const char* SCRIPT_FILE_NAME = "synth.ys";
+  // Bump when the file format or the optimizer changes,
+  // so that stale cache files are no longer found.
+  static const uint32_t FORMAT_VERSION = 2;
+private:
+  std::string directory;
+  // Parses a cache file of `size` bytes at `data`.
+  static bool read(const char* data, size_t size, Circuit& circuit);
+};
+
+#endif
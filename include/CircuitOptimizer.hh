@@ -0,0 +1,59 @@
+#ifndef CIRCUIT_OPTIMIZER_HH
+#define CIRCUIT_OPTIMIZER_HH
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Circuit.hh"
+
+// Gate counts of a CircuitOptimizer run, and how often each rewrite applied.
+struct OptimizerStats {
+  unsigned gatesBefore = 0;
+  unsigned gatesAfter = 0;
+  // Gates with a constant input, or whose inputs are
+  // equal or complementary (e.g., x & ~x = 0).
+  unsigned folded = 0;
+  // Gates with the same type and inputs as an earlier gate.
+  unsigned merged = 0;
+  // NOT gates of NOT gates.
+  unsigned doubleNegations = 0;
+  // Gates outside the cone of every output.
+  unsigned dead = 0;
+};
+
+// A CircuitOptimizer rebuilds a circuit (with outputs)
+// into a smaller, equivalent one. Gates are visited once,
+// in topological order; every gate is first simplified
+// (constant folding, equal or complementary inputs,
+// double negation), then looked up among the gates built so far
+// (structural hashing). Gates that no output depends on are dropped.
+// Inputs and outputs keep their positions.
+class CircuitOptimizer {
+public:
+  explicit CircuitOptimizer(Circuit& circuit);
+  Circuit optimize();
+  OptimizerStats stats;
+private:
+  Circuit& circuit;
+  // Nodes of the optimized circuit: inputs, then gates in
+  // topological order. Constants are not nodes, but references
+  // CONST_ZERO and CONST_ONE (see CircuitOptimizer.cc).
+  std::vector<uint32_t> left;
+  std::vector<uint32_t> right;
+  std::vector<GateType> types;
+  // Structural hash, per gate type: (left, right) -> node.
+  std::array<std::unordered_map<uint64_t, uint32_t>, GATE_TYPE_COUNT>
+    nodeIndex;
+  // Simplified reference to the gate (type, l, r).
+  uint32_t addNode(GateType type, uint32_t l, uint32_t r);
+  uint32_t addNot(uint32_t x);
+  uint32_t appendNode(GateType type, uint32_t l, uint32_t r);
+  bool isNot(uint32_t x);
+  bool complementary(uint32_t x, uint32_t y);
+  // Turns a constant reference into a node; other references
+  // are returned as is.
+  uint32_t materialize(uint32_t ref);
+};
+
+#endif
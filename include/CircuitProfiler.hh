@@ -0,0 +1,50 @@
+#ifndef CIRCUIT_PROFILER_HH
+#define CIRCUIT_PROFILER_HH
+
+#include <array>
+#include <vector>
+#include "Circuit.hh"
+
+// Shape of a circuit (with outputs), as far as it matters
+// for the cost of garbling and evaluating it.
+// Histograms are over powers of two: bucket 0 counts zeros,
+// and bucket k >= 1 counts values in [2^(k-1), 2^k).
+struct CircuitProfile {
+  unsigned monitorStateLength = 0;
+  unsigned systemStateLength = 0;
+  unsigned outputLength = 0;
+  unsigned gateCount = 0;
+  std::array<unsigned, GATE_TYPE_COUNT> gateCounts = {};
+  unsigned depth = 0;
+  unsigned maxWidth = 0;
+  double averageWidth = 0;
+  // Number of levels, by width.
+  std::vector<unsigned> levelWidths;
+  // Number of drivers, by the number of gates they drive.
+  std::vector<unsigned> fanouts;
+  unsigned maxFanout = 0;
+  // Largest number of labels held at once when gates are evaluated
+  // in ascending order of ID's, if every label is dropped after
+  // its last reader (output labels are kept to the end).
+  unsigned peakLiveLabels = 0;
+  // Number of label slots evaluators allocate for evaluation
+  // level by level (see SlotAllocation).
+  unsigned labelSlots = 0;
+  void print();
+};
+
+// A CircuitProfiler measures a CircuitProfile in linear time.
+// The first `monitorStateLength` inputs are the monitor state,
+// and the rest is the system state.
+class CircuitProfiler {
+public:
+  CircuitProfiler(Circuit& circuit, unsigned monitorStateLength);
+  CircuitProfile profile();
+private:
+  Circuit& circuit;
+  unsigned monitorStateLength;
+  static void count(std::vector<unsigned>& histogram, unsigned value);
+  unsigned peakLiveLabels();
+};
+
+#endif
@@ -4,20 +4,41 @@
 #include <memory>
 #include <map>
 #include "MonitorableSystem.hh"
+#include "WireFormat.hh"
 
 enum class ProtocolType { YAO, LWY };
+// Groups for LWY: quadratic residues modulo a safe prime,
+// or an elliptic curve of about the same strength.
+enum class GroupType { QR, EC };
+// Garbling schemes: four ciphertexts per gate with trial decryption,
+// four ciphertexts ordered by colour bits (point-and-permute),
+// or half-gates with free-XOR (two per gate; Yao only).
+enum class GarblingScheme { CLASSIC, POINT_AND_PERMUTE, HALF_GATES };
 
 struct ParameterSet {
   unsigned securityParameter;
   unsigned monitorStateLength;
   unsigned systemStateLength;
   ProtocolType protocol;
+  GroupType group;
+  GarblingScheme garbling;
+  unsigned threadCount;
+  // Garbled gates per message; 0 sends them all in one message.
+  unsigned streamChunkSize;
+  // Picked by Monitor; System follows the gate count handshake.
+  WireFormat wireFormat;
+  // Cache file for fixed-base exponentiation tables; may be empty.
+  std::string tableFileName;
+  // Directory of compiled circuits; empty if caching is disabled.
+  std::string circuitCacheDirectory;
 };
 
 struct CommandLineInterface {
-  CommandLineInterface(int argc, char* argv[]);
+  // Plaintext tools (e.g., Simulator) do not need `-security`.
+  CommandLineInterface(int argc, char* argv[], bool needsSecurity = true);
   int argc;
   char** argv;
+  bool needsSecurity;
 
   ParameterSet parameters;
   std::unique_ptr<MonitorableSystem> system;
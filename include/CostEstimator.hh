@@ -0,0 +1,72 @@
+#ifndef COST_ESTIMATOR_HH
+#define COST_ESTIMATOR_HH
+
+#include <cstdint>
+#include <string>
+#include "Circuit.hh"
+#include "PrimeOrderGroup.hh"
+#include "WireFormat.hh"
+#include "YaoGarbler.hh"
+
+// Costs of a protocol run on a circuit, counted the way the protocols
+// compute and send things (e.g., hex labels separated by spaces
+// in the text wire format).
+// Exponentiations include those of oblivious transfers.
+struct CostEstimate {
+  std::string protocol;
+  // Every round.
+  uint64_t systemBytes = 0;
+  uint64_t monitorBytes = 0;
+  uint64_t systemExps = 0;
+  uint64_t monitorExps = 0;
+  uint64_t systemHashes = 0;
+  uint64_t monitorHashes = 0;
+  // Only in the first round, on top of the above: the circuit (Yao)
+  // or the labels (LWY), and transfers of the monitor state labels.
+  uint64_t setupBytes = 0;
+  uint64_t setupExps = 0;
+  static void printHeader();
+  void print();
+};
+
+// A CostEstimator estimates the costs of Yao and LWY on a circuit
+// (with outputs) at a given security parameter, without running them.
+// Garbled gates are measured by garbling one gate of each type
+// with the given garbler; other costs use the constants of
+// the protocols (see Y.hh, LWY.hh and BM.hh).
+// The first `monitorStateLength` inputs are the monitor state.
+// Bytes are those of messages in `wireFormat`, leaving out
+// the label lengths of the binary format (a few bytes per message).
+class CostEstimator {
+public:
+  CostEstimator(
+    Circuit& circuit, unsigned monitorStateLength,
+    unsigned securityParameter, WireFormat wireFormat = WireFormat::TEXT);
+  CostEstimate estimateYao(YaoGarbler& garbler, const std::string& name);
+  // The circuit is rewritten to NAND gates first, as LWY requires.
+  CostEstimate estimateLwy(
+    PrimeOrderGroup& group, YaoGarbler& garbler, const std::string& name);
+private:
+  Circuit& circuit;
+  unsigned monitorStateLength;
+  unsigned securityParameter;
+  WireFormat wireFormat;
+  // Message bytes of a number, a label of `labelLength` bytes,
+  // and a group element of `elementHexLength` hex digits.
+  uint64_t numberBytes(uint32_t n);
+  uint64_t labelBytes(unsigned labelLength);
+  uint64_t elementBytes(unsigned elementHexLength);
+  // Message bytes of a garbled gate of the given type
+  // with labels of `labelLength` bytes, if `rowCount` rows are sent.
+  uint64_t garbledGateBytes(
+    YaoGarbler& garbler, unsigned labelLength,
+    GateType type, unsigned rowCount);
+  // Bytes and exponentiations of transferring every monitor state label
+  // (of `messageHexLength` hex digits) over a group whose elements
+  // take `elementHexLength` hex digits.
+  void addTransfers(
+    CostEstimate& estimate,
+    unsigned elementHexLength, unsigned messageHexLength);
+};
+
+#endif
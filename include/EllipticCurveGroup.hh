@@ -0,0 +1,47 @@
+#ifndef ELLIPTIC_CURVE_GROUP_HH
+#define ELLIPTIC_CURVE_GROUP_HH
+
+#include <memory>
+#include <openssl/ec.h>
+#include "PrimeOrderGroup.hh"
+#include "BigInt.hh"
+
+// The group of points of a prime-order elliptic curve
+// (one of the NIST curves), built on OpenSSL's EC_POINT.
+//
+// An element is encoded as the BigInt whose big-endian bytes are
+// the compressed form of the point (0x02 or 0x03, then x);
+// the point at infinity is encoded as 0.
+// In multiplicative notation, mul() is point addition,
+// and exp() is scalar multiplication.
+class EllipticCurveGroup : public PrimeOrderGroup {
+public:
+  // `curveId` is an OpenSSL curve NID, e.g., NID_X9_62_prime256v1.
+  explicit EllipticCurveGroup(int curveId);
+  // The curve with (about) the same security as
+  // the safe-prime group of a `securityParameter`-bit modulus.
+  static int curveFor(unsigned securityParameter);
+
+  BigInt mul(const BigInt& a, const BigInt& b) override;
+  BigInt exp(const BigInt& a, const BigInt& n) override;
+  // Uses OpenSSL's precomputed multiples of the curve generator.
+  BigInt expFixedBase(const BigInt& base, const BigInt& n) override;
+  BigInt inv(const BigInt& a) override;
+  BigInt randomExponent() override;
+  unsigned elementHexLength() override;
+  BigInt order() override;
+
+private:
+  // The curve is never modified once built; so, copies share it,
+  // and it can be used by many threads at once.
+  std::shared_ptr<EC_GROUP> curve;
+  BigInt curveOrder;
+  // Size of an encoded point, in bytes.
+  unsigned encodedSize;
+  explicit EllipticCurveGroup(std::shared_ptr<EC_GROUP> curve);
+  // The caller owns (and frees) the decoded point.
+  EC_POINT* decode(const BigInt& a);
+  BigInt encode(const EC_POINT* point);
+};
+
+#endif
@@ -51,4 +51,22 @@ public:
     : std::runtime_error("Bad timer call sequence") {}
 };
 
+class InvalidGroupElement : public std::runtime_error {
+public:
+  InvalidGroupElement()
+    : std::runtime_error("Invalid group element") {}
+};
+
+class EllipticCurveError : public std::runtime_error {
+public:
+  EllipticCurveError()
+    : std::runtime_error("Elliptic curve operation failed") {}
+};
+
+class MalformedMessage : public std::runtime_error {
+public:
+  MalformedMessage()
+    : std::runtime_error("Malformed message") {}
+};
+
 #endif
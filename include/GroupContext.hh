@@ -0,0 +1,44 @@
+#ifndef GROUP_CONTEXT_HH
+#define GROUP_CONTEXT_HH
+
+#include <vector>
+#include <gmp.h>
+#include "BigInt.hh"
+
+// An element a of Z_p in Montgomery form, i.e., a * R mod p
+// for R = 2^(GMP_NUMB_BITS * limbCount), as exactly limbCount limbs.
+typedef std::vector<mp_limb_t> MontgomeryElement;
+
+// A `GroupContext` holds everything that is fixed for a prime modulus p,
+// including the precomputed state for Montgomery multiplication.
+// It is immutable once built; so, it is shared by all copies of a group,
+// and it can be used by many threads at once.
+//
+// Chained multiplications (e.g., exponentiations) are done
+// in Montgomery form, which replaces each division by p with
+// cheaper multiplications; elements are converted back
+// only when they leave the chain.
+class GroupContext {
+public:
+  // ASSUMPTION: p is an odd prime.
+  explicit GroupContext(BigInt p);
+  const BigInt primeModulus;
+  // Order of the group of quadratic residues modulo a safe prime p.
+  const BigInt smallPrime;
+  size_t limbCount() const;
+  MontgomeryElement toMontgomery(const BigInt& a) const;
+  BigInt fromMontgomery(const MontgomeryElement& a) const;
+  MontgomeryElement one() const;
+  // rop = a * b * R^(-1) mod p; rop may alias a or b.
+  // `scratch` must hold 2 * limbCount() limbs.
+  void mul(
+    mp_limb_t* rop, const mp_limb_t* a, const mp_limb_t* b,
+    mp_limb_t* scratch) const;
+private:
+  size_t limbs;
+  std::vector<mp_limb_t> modulusLimbs;
+  // -p^(-1) mod 2^GMP_NUMB_BITS.
+  mp_limb_t negativeInverse;
+};
+
+#endif
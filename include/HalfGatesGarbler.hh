@@ -0,0 +1,57 @@
+#ifndef HALF_GATES_GARBLER_HH
+#define HALF_GATES_GARBLER_HH
+
+#include "YaoGarbler.hh"
+
+// The HalfGatesGarbler class implements the half-gates scheme
+// of Zahur, Rosulek and Evans, on top of free-XOR and point-and-permute.
+//
+// All label pairs share a global offset R: label[1] = label[0] ^ R.
+// The last bit of R is set; so, the last bits of the two labels
+// of a wire differ, and serve as its permute bit.
+// An AND gate is garbled as two half gates (one per input),
+// each taking a single ciphertext; the evaluator computes
+// exactly one hash per half gate, without trial decryption.
+// With free-XOR, XOR, XNOR and NOT gates take no ciphertexts:
+// their output labels are XORs (or swaps) of their input labels.
+// A NAND gate is an AND gate whose output labels are swapped,
+// and an OR gate is a NAND gate of swapped input labels.
+//
+// Output labels are derived from input labels; so, only
+// input labels are random (see YaoGarbler::derivesOutputLabels).
+// Hashes are SHAKE-256, tweaked per gate (see YaoGarbler::enc)
+// and per half gate.
+
+class HalfGatesGarbler : public YaoGarbler {
+public:
+  // Labels are `labelLength` random bytes.
+  HalfGatesGarbler(unsigned labelLength);
+
+  GarbledGate enc(
+    const LabelPair& left,
+    const LabelPair& right,
+    LabelPair& out,
+    uint64_t tweak = 0,
+    GateType type = GateType::NAND) override;
+  Label dec(
+    const Label& left,
+    const Label& right,
+    const GarbledGate& gate,
+    uint64_t tweak = 0,
+    GateType type = GateType::NAND) override;
+  unsigned ciphertextCount(GateType type = GateType::NAND) override;
+  unsigned garblingHashCount(GateType type = GateType::NAND) override;
+  unsigned evaluationHashCount(GateType type = GateType::NAND) override;
+  bool derivesOutputLabels() override;
+  LabelPair randomLabelPair(unsigned length) override;
+private:
+  // The global free-XOR offset R; only known to the garbler.
+  Label offset;
+  static Label hash(const Label& label, uint64_t tweak, uint8_t half);
+  // Garbles a & b into gate[0..1]; returns the 0-label of the output.
+  Label garbleAnd(
+    const LabelPair& left, const LabelPair& right,
+    uint64_t tweak, GarbledGate& gate);
+};
+
+#endif
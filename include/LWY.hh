@@ -1,9 +1,10 @@
 #include <chrono>
+#include <future>
 #include <string>
 #include <vector>
 
 #include "BigInt.hh"
-#include "QuadraticResidueGroup.hh"
+#include "PrimeOrderGroup.hh"
 #include "YaoGarbler.hh"
 
 #include "Circuit.hh"
@@ -13,8 +14,10 @@
 #include "State.hh"
 
 #include "BM.hh"
+#include "WireFormat.hh"
 
 #include "Timer.hh"
+#include "ThreadPool.hh"
 
 // Original protocol was proposed by Liu, Wang, and Yiu
 // in the following paper:
@@ -26,6 +29,15 @@ namespace LWY {
   // Numbers sent in messages can be represented in bases other than 10.
   // To clarify this choice, we define MSG_NUM_BASE.
   const int MSG_NUM_BASE = 16;
+  // Exponentiations per gate and round. System raises both in-wire
+  // labels and the driver label of every gate to both exponents
+  // of a garbling pair; Monitor unlocks both in-wire labels.
+  const unsigned SYSTEM_EXPS_PER_GATE = 6;
+  const unsigned MONITOR_EXPS_PER_GATE = 2;
+  // Number of gates garbled by a thread in one go.
+  const unsigned GARBLING_CHUNK_SIZE = 64;
+  // Number of gates of a level evaluated by a thread in one go.
+  const unsigned EVALUATION_CHUNK_SIZE = 4;
 
   class ParameterSet {
   public:
@@ -38,10 +50,24 @@ namespace LWY {
     // Output length is always monitorStateLength + 1.
 
     // * Encryption parameters
-    QuadraticResidueGroup group;
+    // Shared by all protocol states (and by nested protocols).
+    GroupPtr group;
     YaoGarbler* garbler;
     unsigned securityParameter;
+    // Optional; without a pool, everything runs on one thread.
+    ThreadPool* threadPool = nullptr;
+    // Garbled gates are sent in messages of at most this many gates,
+    // each garbled while the previous one is sent, and evaluated
+    // by the monitor as it arrives; 0 sends all gates in a single message.
+    // Gates are only shuffled within their chunk.
+    unsigned streamChunkSize = 0;
+    // Encoding of all messages, including those of oblivious transfers.
+    WireFormat wireFormat = WireFormat::TEXT;
     unsigned inputLength();
+    // Number of messages of garbled gates in a round.
+    unsigned chunkCount();
+    // Gates of message k, as positions in the order they are sent.
+    DriverRange chunk(unsigned k);
   };
 
   class SystemMemory {
@@ -49,7 +75,13 @@ namespace LWY {
     MonitorableSystem* system;
     std::vector<BigInt> driverLabels;
     std::vector<BigInt> inWireLabels;
+    // Gates of the chunk being garbled (see ParameterSet::chunk).
     std::vector<GarbledGate> garbledGates;
+    // The next message of garbled gates, garbled in the background
+    // while earlier messages are sent; and the time it took,
+    // added to `timer` once it is sent.
+    std::future<std::string> nextGarbledChunk;
+    float nextGarblingTime = 0;
     std::array<BigInt, 2> garblingExponents;
     std::array<BigInt, 2> nextRoundGarblingExponents;
     bool isFirstRound = true;
@@ -72,10 +104,23 @@ namespace LWY {
   class MonitorMemory {
   public:
     Circuit* circuit;
-    std::vector<Driver*> shuffledCircuit;
+    // Both computed from `circuit` on first use, if left empty;
+    // gates are levelled by the chunks they are streamed in
+    // (see Circuit::levelize()).
+    Levelization levelization;
+    SlotAllocation slotAllocation;
+    // Driver ID's in the order they are sent to System.
+    Word shuffledCircuit;
+    // Position of every driver in shuffledCircuit;
+    // computed on first use.
+    std::vector<unsigned> unshuffledCircuit;
+    // Only kept until they are sent to System.
     std::vector<BigInt> driverLabels;
     std::vector<BigInt> inWireKeys;
+    // Gates of the chunk being evaluated; dropped once evaluated.
     std::vector<GarbledGate> garbledGates;
+    // Indexed by slot (see SlotAllocation); gates are evaluated
+    // level by level, and labels of dead drivers are overwritten.
     std::vector<BigInt> evaluatedDriverLabels;
     std::array<BigInt, 2> flagBitLabels;
     bool isFirstRound = true;
@@ -147,21 +192,25 @@ namespace LWY {
   public:
     using SystemState::SystemState;
     StatePtr next() override;
+    // Garbles the gates of chunk k, and returns their message.
+    std::string garbleChunk(unsigned k);
+    // Garbles chunk k in the background, into memory->nextGarbledChunk.
+    void garbleChunkInBackground(unsigned k);
   private:
     void generateGarblingExponents();
-    std::array<BigInt, 2> expLabel(
-      BigInt label,
-      std::array<BigInt, 2> exponents);
     std::string padLabel(BigInt label);
-    void garble();
+    void garble(DriverRange gates);
   };
 
   class SendGarbledGates : public SystemState {
   public:
-    using SystemState::SystemState;
+    SendGarbledGates(
+      ParameterSet* parameters, SystemMemory* memory, unsigned chunk);
     bool isSend() override;
     std::string message() override;
     StatePtr next() override;
+  private:
+    unsigned chunk;
   };
 
   class SendSystemInputLabels : public SystemState {
@@ -256,9 +305,12 @@ namespace LWY {
 
   class RecvGarbledGates : public MonitorState {
   public:
-    using MonitorState::MonitorState;
+    RecvGarbledGates(
+      ParameterSet* parameters, MonitorMemory* memory, unsigned chunk = 0);
     bool isRecv() override;
     StatePtr next() override;
+  private:
+    unsigned chunk;
   };
 
   class RecvSystemInputLabels : public MonitorState {
@@ -266,6 +318,8 @@ namespace LWY {
     using MonitorState::MonitorState;
     bool isRecv() override;
     StatePtr next() override;
+  private:
+    void allocateSlots();
   };
 
   class RecvFlagBitLabels : public MonitorState {
@@ -294,11 +348,14 @@ namespace LWY {
 
   class EvaluateCircuit : public MonitorState {
   public:
-    using MonitorState::MonitorState;
+    EvaluateCircuit(
+      ParameterSet* parameters, MonitorMemory* memory, unsigned chunk);
     StatePtr next() override;
   private:
+    unsigned chunk;
     std::string padLabel(BigInt label);
     std::vector<unsigned> getUnshuffling_Timed();
+    void evaluateGate(unsigned id, unsigned chunkBegin);
     void evaluateDriverLabels();
   };
 
@@ -0,0 +1,70 @@
+#ifndef LABEL_HH
+#define LABEL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// A Block is 128 bits, aligned to 16 bytes;
+// so, it is XOR'ed and compared as a single SSE word.
+struct alignas(16) Block {
+  uint64_t words[2];
+};
+
+// Labels of up to this many blocks (256 bits) are stored inline;
+// longer labels (e.g., group elements of LWY) are put on the heap.
+const unsigned INLINE_LABEL_BLOCKS = 2;
+
+// A Label is a fixed-width binary string, used for wire labels
+// and ciphertexts of garbled gates. Its bytes are stored in
+// whole blocks; bytes past size() are always zero,
+// so XOR and comparison work block by block.
+// Hex is only used when labels are put into protocol messages.
+class Label {
+public:
+  // The empty label.
+  Label();
+  // A label of `length` zero bytes.
+  explicit Label(size_t length);
+  Label(const Label& other);
+  Label(Label&& other) noexcept;
+  Label& operator=(const Label& other);
+  Label& operator=(Label&& other) noexcept;
+
+  // `length` bytes from /dev/urandom (see randomBytes).
+  static Label random(size_t length);
+  // Odd-length hex strings are read as if they had a leading zero.
+  static Label fromHex(std::string_view hex);
+  std::string toHex() const;
+
+  // Length in bytes.
+  size_t size() const;
+  bool empty() const;
+  unsigned char* data();
+  const unsigned char* data() const;
+  unsigned blockCount() const;
+
+  // Last bit of the last byte; used as a permute bit.
+  bool lsb() const;
+  void setLsb(bool bit);
+  // Bytes [begin, begin + length) as a new label.
+  Label slice(size_t begin, size_t length) const;
+
+  // Both labels should be of the same size.
+  Label& operator^=(const Label& other);
+  Label operator^(const Label& other) const;
+  bool operator==(const Label& other) const;
+  bool operator!=(const Label& other) const;
+private:
+  uint32_t length;
+  uint32_t count;
+  Block inlineBlocks[INLINE_LABEL_BLOCKS];
+  std::unique_ptr<Block[]> heapBlocks;
+  Block* blocks();
+  const Block* blocks() const;
+  void allocate(size_t length);
+};
+
+#endif
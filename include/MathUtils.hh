@@ -1,6 +1,7 @@
 #ifndef UTILS_HH
 #define UTILS_HH
 
+#include <initializer_list>
 #include <string>
 #include <vector>
 #include <gmp.h>
@@ -12,6 +13,20 @@ uint8_t hexValue(char c);
 std::string hashSha512(const std::string& s);
 std::string hashShake256(const std::string& s, size_t len = 0);
 
+// Binary variants of the hash functions above;
+// the inputs are hashed as if they were concatenated.
+struct HashInput {
+  const void* data;
+  size_t length;
+};
+const size_t SHA512_LENGTH = 64;
+// Writes SHA512_LENGTH bytes to `out`.
+void hashSha512(
+  std::initializer_list<HashInput> inputs, unsigned char* out);
+void hashShake256(
+  std::initializer_list<HashInput> inputs,
+  unsigned char* out, size_t outLength);
+
 uint64_t timeBasedSeed();
 
 // This number is only for the primes generated with initPrimes().
@@ -9,6 +9,28 @@
 typedef std::vector<unsigned> Word;
 typedef std::vector<Word> WordVector;
 
+// Architectures of the arithmetic modules below, trading gate count
+// against depth (i.e., the number of levels that cannot be
+// evaluated or garbled in parallel). For words of n bits:
+// - RIPPLE: a chain of full adders; depth 2n, 5n gates.
+// - KOGGE_STONE: depth 2 log n, about 3n log n gates.
+// - BRENT_KUNG: depth 4 log n, about 7n gates.
+// - SKLANSKY: depth 2 log n, about 2n log n gates, but high fanout.
+// (e.g., for n = 32: 160, 469, 238 and 307 gates, of depth
+// 65, 12, 18 and 13.)
+enum class AdderType { RIPPLE, KOGGE_STONE, BRENT_KUNG, SKLANSKY };
+// LINEAR comparators fold bits one by one (depth n);
+// TREE comparators fold them pairwise (depth log n).
+enum class ComparatorType { LINEAR, TREE };
+// For 2^s input words of n bits:
+// - MUX: a tree of 2-to-1 multiplexers; depth 2s, 4n (2^s - 1) gates.
+// - XOR_MUX: the same tree, with multiplexers a ^ (s & (a ^ b));
+//   depth 3s, 3n (2^s - 1) gates, but only a third of them are
+//   AND gates (XOR gates are free with half-gates).
+// - DECODER: decodes `select` to one-hot, then ANDs and XORs words;
+//   depth s + log s + 2, about (n + 1) 2^s AND gates.
+enum class SelectorType { MUX, XOR_MUX, DECODER };
+
 class Module {
 public:
   void build(Circuit&);
@@ -82,11 +104,14 @@ public:
 
 class Selector : public Module {
 public:
-  Selector(WordVector input, Word select);
+  Selector(
+    WordVector input, Word select, SelectorType type = SelectorType::MUX);
   void buildImpl(Circuit&) override;
 private:
   WordVector input;
   Word select;
+  SelectorType type;
+  void buildDecoder(Circuit&);
 };
 
 class HalfAdder : public Module {
@@ -114,7 +139,9 @@ private:
 
 class Adder : public Module {
 public:
-  Adder(Word inputLeft, Word inputRight, unsigned carryIn);
+  Adder(
+    Word inputLeft, Word inputRight, unsigned carryIn,
+    AdderType type = AdderType::RIPPLE);
   void buildImpl(Circuit&) override;
   Word sum();
   unsigned carry();
@@ -122,24 +149,35 @@ protected:
   Word inputLeft;
   Word inputRight;
   unsigned carryIn;
+  AdderType type;
+  void buildRipple(Circuit&);
+  // Carries are computed by a parallel prefix network
+  // over (generate, propagate) pairs.
+  void buildPrefix(Circuit&);
 };
 
 class EqChecker : public Module {
 public:
-  EqChecker(Word inputLeft, Word inputRight);
+  EqChecker(
+    Word inputLeft, Word inputRight,
+    ComparatorType type = ComparatorType::LINEAR);
   void buildImpl(Circuit&) override;
 private:
   Word inputLeft;
   Word inputRight;
+  ComparatorType type;
 };
 
 class LtChecker : public Module {
 public:
-  LtChecker(Word inputLeft, Word inputRight);
+  LtChecker(
+    Word inputLeft, Word inputRight,
+    ComparatorType type = ComparatorType::LINEAR);
   void buildImpl(Circuit&) override;
 private:
   Word inputLeft;
   Word inputRight;
+  ComparatorType type;
 };
 
 class Zero : public Module {
@@ -1,6 +1,7 @@
 #ifndef MONITORABLE_SYSTEM_HH
 #define MONITORABLE_SYSTEM_HH
 
+#include <string>
 #include <vector>
 #include "MathUtils.hh"
 #include "Exceptions.hh"
@@ -76,4 +77,20 @@ public:
   virtual const std::vector<bool>& data() override;
 };
 
+// A TraceSystem replays a recorded trace of system states.
+// A trace file has one system state per line,
+// written as a string of 0's and 1's (system[0] first).
+// Empty lines and lines starting with '#' are ignored.
+// Once the trace is exhausted, the last state is repeated.
+class TraceSystem : public MonitorableSystem {
+public:
+  TraceSystem(std::string traceFileName);
+
+  std::vector<std::vector<bool>> states;
+  unsigned cntr = 0;
+  unsigned length();
+  void next() override;
+  const std::vector<bool>& data() override;
+};
+
 #endif
@@ -0,0 +1,48 @@
+#ifndef POINT_AND_PERMUTE_GARBLER_HH
+#define POINT_AND_PERMUTE_GARBLER_HH
+
+#include "YaoGarbler.hh"
+
+// The PointAndPermuteGarbler class garbles gates into 4 rows,
+// like the default scheme, but orders the rows by colour bits
+// instead of shuffling them; so, the evaluator picks its row
+// directly, with a single SHAKE-256 hash and a single XOR,
+// and rows need no redundancy to be recognised.
+//
+// The colour of a label is one of its bits. For each gate input,
+// the garbler picks the lowest bit at which the two labels differ,
+// and sends its position with the gate. Labels of this garbler
+// differ in their last bit (see randomLabelPair); but labels made
+// elsewhere (e.g., group elements of LWY) work just as well.
+//
+// The positions of the left and right colour bits take
+// COLOUR_HEADER_SIZE bytes, stored in front of the first row.
+
+class PointAndPermuteGarbler : public YaoGarbler {
+public:
+  GarbledGate enc(
+    const LabelPair& left,
+    const LabelPair& right,
+    LabelPair& out,
+    uint64_t tweak = 0,
+    GateType type = GateType::NAND) override;
+  Label dec(
+    const Label& left,
+    const Label& right,
+    const GarbledGate& gate,
+    uint64_t tweak = 0,
+    GateType type = GateType::NAND) override;
+  LabelPair randomLabelPair(unsigned length) override;
+  unsigned evaluationHashCount(GateType type = GateType::NAND) override;
+
+  static const size_t COLOUR_HEADER_SIZE = 4;
+private:
+  // Position of the lowest bit at which `a` and `b` differ.
+  static unsigned colourPosition(const Label& a, const Label& b);
+  static bool colour(const Label& label, unsigned position);
+  static Label rowPad(
+    const Label& left, const Label& right,
+    uint64_t tweak, size_t length);
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PRIME_ORDER_GROUP_HH
+#define PRIME_ORDER_GROUP_HH
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CyclicGroup.hh"
+#include "BigInt.hh"
+#include "ThreadPool.hh"
+
+// Number of exponentiations done by a thread in one go.
+const unsigned EXP_BATCH_CHUNK_SIZE = 16;
+
+// An exponentiation job base ^ exponent for expBatch();
+// the operands are owned by the caller.
+struct ExpJob {
+  const BigInt* base;
+  const BigInt* exponent;
+};
+
+// A `PrimeOrderGroup` is a cyclic group of prime order
+// whose elements are encoded as (non-negative) BigInts.
+// This is everything that BM and LWY need from a group;
+// the group is written multiplicatively, whatever its backend.
+//
+// The batch methods have plain implementations in terms of exp();
+// backends override them where they can do better.
+class PrimeOrderGroup : public CyclicGroup<BigInt> {
+public:
+  explicit PrimeOrderGroup(BigInt baseGenerator);
+  // A fixed generator, known to both parties.
+  const BigInt baseGenerator;
+  virtual BigInt inv(const BigInt& a) = 0;
+  // A uniformly random exponent in {1, ..., order - 1}.
+  virtual BigInt randomExponent() = 0;
+  // Number of hex digits needed for any encoded element.
+  virtual unsigned elementHexLength() = 0;
+  // Number of bytes of any element in binary messages.
+  unsigned elementByteLength();
+  BigInt randomGenerator() override;
+  virtual BigInt expFixedBase(const BigInt& base, const BigInt& n);
+  // Computes all (independent) exponentiations in `jobs`,
+  // spread over the threads of `pool` if one is given;
+  // the i-th result belongs to the i-th job.
+  virtual std::vector<BigInt> expBatch(
+    const std::vector<ExpJob>& jobs, ThreadPool* pool = nullptr);
+  // Raises every base to both exponents, i.e.,
+  //   results[i] = { bases[i] ^ exponents[0], bases[i] ^ exponents[1] },
+  // spread over the threads of `pool` if one is given.
+  virtual std::vector<std::array<BigInt, 2>> expPairBatch(
+    const std::vector<const BigInt*>& bases,
+    const std::array<BigInt, 2>& exponents,
+    ThreadPool* pool = nullptr);
+  // Prepares exponentiations of baseGenerator; if a file name is given,
+  // precomputed data may be loaded from there, or saved there.
+  virtual void precomputeBaseGenerator(const std::string& cacheFileName = "");
+};
+
+typedef std::shared_ptr<PrimeOrderGroup> GroupPtr;
+
+#endif
@@ -1,29 +1,95 @@
 #ifndef QUADRATIC_RESIDUE_GROUP_HH
 #define QUADRATIC_RESIDUE_GROUP_HH
 
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
 #include <gmp.h>
-#include "CyclicGroup.hh"
+#include "PrimeOrderGroup.hh"
 #include "BigInt.hh"
+#include "GroupContext.hh"
+#include "ThreadPool.hh"
 
+// Exponents of a fixed base are split into windows of this many bits.
+const unsigned FIXED_BASE_WINDOW_BITS = 6;
+
+// A `FixedBaseTable` holds precomputed powers of a fixed base g:
+//   power k = j * (2^w - 1) + (d - 1) is g ^ (d * 2^(w * j))
+// for every window j and digit d in {1, ..., 2^w - 1},
+// where w = windowBits. Then, g^n is the product of
+// one table entry per nonzero window of n; no squarings are needed.
+// Powers are kept in Montgomery form, one after another;
+// i.e., power k is in powers[k * limbCount .. (k + 1) * limbCount).
+struct FixedBaseTable {
+  unsigned windowBits;
+  std::vector<mp_limb_t> powers;
+};
+
+// Exponents shared by many bases are split into windows of this many bits.
+const unsigned FIXED_EXPONENT_WINDOW_BITS = 4;
+
+// A `RecodedExponent` is an exponent split into windowBits-bit digits,
+// least significant digit first.
+struct RecodedExponent {
+  unsigned windowBits;
+  std::vector<uint8_t> digits;
+};
+
+// The group of quadratic residues modulo a safe prime p = 2q + 1,
+// which is of prime order q.
 class QuadraticResidueGroup
-  : public CyclicGroup<BigInt> {
+  : public PrimeOrderGroup {
 public:
   explicit QuadraticResidueGroup(BigInt p);
   ~QuadraticResidueGroup() override;
 
-  BigInt randomGenerator() override;
-  const BigInt baseGenerator = BigInt(4);
   BigInt mul(const BigInt& a, const BigInt& b) override;
   BigInt exp(const BigInt& a, const BigInt& n) override;
-  BigInt inv(const BigInt& a);
-  BigInt randomExponent();
+  std::vector<BigInt> expBatch(
+    const std::vector<ExpJob>& jobs, ThreadPool* pool = nullptr) override;
+  // Exponents are recoded only once for all bases,
+  // and both powers of a base share the same chain of squarings.
+  std::vector<std::array<BigInt, 2>> expPairBatch(
+    const std::vector<const BigInt*>& bases,
+    const std::array<BigInt, 2>& exponents,
+    ThreadPool* pool = nullptr) override;
+  // Precomputes a table of powers of `base`,
+  // which is used by expFixedBase() and expBatch() from then on.
+  void precomputeFixedBase(const BigInt& base);
+  // Same as exp(base, n), but uses the table of `base` if there is one.
+  BigInt expFixedBase(const BigInt& base, const BigInt& n) override;
+  // Precomputes the table of baseGenerator; if a file name is given,
+  // the tables are loaded from there, or saved there once built.
+  void precomputeBaseGenerator(
+    const std::string& cacheFileName = "") override;
+  // Tables are stored as text, along with the modulus,
+  // and followed by an end marker. Files are written aside,
+  // then renamed; so, concurrent readers see a whole file or none.
+  // Saving fails (returns false) if the file cannot be written.
+  // Loading fails (returns false, and loads no table) if the file is
+  // missing, belongs to another group, or is truncated or malformed.
+  bool saveFixedBaseTables(const std::string& fileName);
+  bool loadFixedBaseTables(const std::string& fileName);
+  BigInt inv(const BigInt& a) override;
+  BigInt randomExponent() override;
+  unsigned elementHexLength() override;
   BigInt order() override;
 
   friend std::string toString(const QuadraticResidueGroup& g);
 
 private:
-  BigInt primeModulus;
-  BigInt smallPrime;
+  // Copies of a group share the same context.
+  std::shared_ptr<const GroupContext> context;
+  // Tables are immutable once built;
+  // so, copies of a group share them.
+  std::map<BigInt, std::shared_ptr<const FixedBaseTable>> fixedBaseTables;
+  const FixedBaseTable* fixedBaseTable(const BigInt& base);
+  // Number of windows of windowBits bits that cover the order.
+  unsigned fixedBaseWindowCount(unsigned windowBits);
+  BigInt expWithTable(const FixedBaseTable& table, const BigInt& n);
+  RecodedExponent recode(const BigInt& n);
 };
 
 #endif
@@ -7,10 +7,17 @@
 // for encryption and decryption.
 
 class Sha512YaoGarbler : public YaoGarbler {
+public:
+  unsigned garblingHashCount(GateType type = GateType::NAND) override;
+  unsigned evaluationHashCount(GateType type = GateType::NAND) override;
 private:
-  std::string encImpl(Label left, Label right, Label out) override;
-  Label decImpl(Label left, Label right, Ciphertext cipher) override;
-  bool checkLabels(std::vector<Label> labels) override;
+  Ciphertext encImpl(
+    const Label& left, const Label& right, const Label& out) override;
+  Label decImpl(
+    const Label& left,
+    const Label& right,
+    const Ciphertext& cipher) override;
+  bool checkLabels(const std::vector<const Label*>& labels) override;
 };
 
 #endif
@@ -9,9 +9,13 @@
 
 class Shake256YaoGarbler : public YaoGarbler {
 private:
-  std::string encImpl(Label left, Label right, Label out) override;
-  Label decImpl(Label left, Label right, Ciphertext cipher) override;
-  bool checkLabels(std::vector<Label> labels) override;
+  Ciphertext encImpl(
+    const Label& left, const Label& right, const Label& out) override;
+  Label decImpl(
+    const Label& left,
+    const Label& right,
+    const Ciphertext& cipher) override;
+  bool checkLabels(const std::vector<const Label*>& labels) override;
 };
 
 #endif
@@ -1,7 +1,11 @@
 #ifndef SPEC_TO_CIRCUIT_CONVERTER_HH
 #define SPEC_TO_CIRCUIT_CONVERTER_HH
 
+#include <array>
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "Circuit.hh"
 #include "Module.hh"
 
@@ -34,25 +38,80 @@ private:
   Word readNumber(std::string number, unsigned length);
 };
 
-typedef std::pair<std::string, std::string> Connection;
-typedef std::unordered_map<std::string, std::vector<std::string>> CircuitGraph;
-
+// A BlifParser reads a BLIF netlist written by Yosys
+// (with `-icells -conn -impltf`) in a single streaming pass.
+// Wire names are interned to dense ID's on first sight;
+// every wire then keeps its definition (an input, a constant,
+// an alias or a gate) in flat arrays indexed by its ID.
+// Once the whole file is read, the cone of the outputs
+// is built in topological order with an explicit worklist;
+// so, time and memory are linear in the size of the netlist,
+// and deep netlists need no deep recursion.
 class BlifParser {
 public:
   BlifParser(std::string blifFileName);
   void parse(Circuit&);
 private:
+  enum class WireKind : uint8_t { UNDEFINED, INPUT, CONSTANT, ALIAS, GATE };
   std::string blifFileName;
-  unsigned monitorStateLength, systemStateLength;
-  unsigned outputLength;
-  std::unordered_map<std::string, unsigned> wireIndices;
-  CircuitGraph graph;
-  void parseInputs(const std::string& line);
-  void parseOutputs(const std::string& line);
-  void parseConnection(const std::string& line);
-  void parseGate(const std::string& line);
-  void buildCircuit(Circuit& circuit);
-  void buildWire(std::string wire, Circuit& circuit);
+  unsigned monitorStateLength = 0, systemStateLength = 0;
+  unsigned outputLength = 0;
+  // Interned wire names: wireIds[name] is the ID of wire `name`,
+  // and wireNames[id] points back to its name (for errors).
+  std::unordered_map<std::string, uint32_t> wireIds;
+  std::vector<const std::string*> wireNames;
+  // Definitions of wires, indexed by wire ID.
+  // For inputs, `wireLeft` is the input index;
+  // for constants, it is the value; for aliases, it is the
+  // aliased wire. Gates also use `wireRight` and `wireTypes`.
+  std::vector<WireKind> wireKinds;
+  std::vector<uint32_t> wireLeft;
+  std::vector<uint32_t> wireRight;
+  std::vector<GateType> wireTypes;
+  uint32_t internWire(const std::string& name);
+  void defineWire(
+    uint32_t wire, WireKind kind,
+    uint32_t left, uint32_t right = NO_DRIVER,
+    GateType type = GateType::NAND);
+  void parseLine(const std::vector<std::string>& tokens);
+  void parseGate(const std::vector<std::string>& tokens);
+  // Builds `wires` and all wires they depend on;
+  // driverIds[wire] receives the circuit driver of every built wire.
+  void buildWires(
+    const std::vector<uint32_t>& wires,
+    Circuit& circuit, std::vector<uint32_t>& driverIds);
+};
+
+// This converter reads a circuit in Bristol Fashion
+// (e.g., the standard MPC circuits of adders, comparators or AES).
+// Input values are concatenated into the circuit inputs, in order;
+// the first input value is the monitor state, and the remaining
+// values are the system state. Output values are concatenated
+// into the circuit outputs. AND, XOR, INV, EQ and EQW gates
+// are supported.
+// write() exports a circuit with one monitor state and one system
+// state input value (even if either of them is empty), and one
+// output value for the next monitor state and one for the flag
+// (the last output). Gate types other than AND, XOR and NOT
+// are expanded, using as few AND gates as possible
+// (e.g., a | b = a ^ b ^ ab).
+class BristolConverter : public SpecToCircuitConverter {
+public:
+  // Input and output lengths from the header,
+  // set by readHeader() and convert().
+  unsigned monitorStateLength = 0, systemStateLength = 0;
+  unsigned outputLength = 0;
+  BristolConverter(std::string specFileName);
+  Circuit convert() override;
+  // Reads the header only; throws std::invalid_argument
+  // if it cannot be read.
+  void readHeader();
+  static void write(
+    Circuit& circuit, unsigned monitorStateLength,
+    const std::string& fileName);
+private:
+  size_t gateCount = 0, wireCount = 0;
+  void readHeader(std::istream& file);
 };
 
 class YosysConverter : public SpecToCircuitConverter {
@@ -19,12 +19,21 @@ std::string toString(const QuadraticResidueGroup& g);
 std::tuple<std::vector<BigInt>, std::string>
 readBigInts(const std::string& message, int base, int count);
 
+// Only the first `width` ciphertexts of each gate are in the message.
 std::tuple<std::vector<GarbledGate>, std::string>
-readGarbledGates(const std::string& message, int count);
+readGarbledGates(const std::string& message, int count, int width = 4);
+// Gate i takes widths[i] ciphertexts.
+std::tuple<std::vector<GarbledGate>, std::string>
+readGarbledGates(
+  const std::string& message, const std::vector<unsigned>& widths);
 
 std::tuple<std::vector<std::string>, std::string>
 readStrings(const std::string& message, int count);
 
+// Labels are sent as hex strings.
+std::tuple<std::vector<Label>, std::string>
+readLabels(const std::string& message, int count);
+
 // A random hex string of specified length.
 // This string is generated using /dev/urandom.
 struct HexGeneratorState {
@@ -39,5 +48,7 @@ struct HexGeneratorState {
 extern HexGeneratorState SingletonHexGeneratorState;
 
 std::string randomHexString(unsigned length);
+// `length` random bytes, from the same source as randomHexString.
+void randomBytes(unsigned char* out, size_t length);
 
 #endif
@@ -0,0 +1,61 @@
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A ThreadPool runs data-parallel loops on a fixed set of threads.
+// Every thread (including the calling thread) owns a queue of tasks;
+// a thread takes tasks from the front of its own queue,
+// and when that is empty, it steals from the back of other queues.
+// So, uneven chunks (e.g., gates with expensive labels)
+// are balanced between threads automatically.
+class ThreadPool {
+public:
+  // A pool of `threadCount` threads, including the calling thread;
+  // so, ThreadPool(1) runs everything on the caller.
+  explicit ThreadPool(unsigned threadCount);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  unsigned size();
+  // Calls body(chunkBegin, chunkEnd) for consecutive chunks of
+  // [begin, end), each of at most `grain` indices, in parallel.
+  // Returns when all chunks are done; if a chunk throws,
+  // the (first) exception is rethrown here.
+  // NOTE: parallelFor should not be called from inside a chunk.
+  void parallelFor(
+    size_t begin, size_t end, size_t grain,
+    const std::function<void(size_t, size_t)>& body);
+private:
+  using Task = std::function<void()>;
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+  // queues[0] belongs to the calling thread,
+  // queues[i] to workers[i - 1].
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<size_t> pending = 0;
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  bool stopping = false;
+  bool runTask(unsigned self);
+  void work(unsigned self);
+};
+
+// Same as pool->parallelFor(...),
+// except that a null pool runs the whole range on the caller.
+void parallelFor(
+  ThreadPool* pool,
+  size_t begin, size_t end, size_t grain,
+  const std::function<void(size_t, size_t)>& body);
+
+#endif
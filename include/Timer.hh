@@ -14,6 +14,8 @@ public:
   void pause();
   void resume();
   void reset();
+  // Adds time measured elsewhere (e.g., on another thread).
+  void add(float milliseconds);
   float display();
 private:
   Timepoint startPoint;
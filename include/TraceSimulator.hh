@@ -0,0 +1,53 @@
+#ifndef TRACE_SIMULATOR_HH
+#define TRACE_SIMULATOR_HH
+
+#include <optional>
+#include <ostream>
+#include <vector>
+#include "Circuit.hh"
+#include "BitSlicedEvaluator.hh"
+#include "MonitorableSystem.hh"
+
+// A TraceSimulator is a plaintext reference for the monitoring protocols.
+// It evaluates a spec circuit round by round,
+// without any garbling or cryptography.
+// Like Monitor and System, it assumes the following circuit layout:
+// * inputs:  monitor state (monitorStateLength bits),
+//            followed by system state (systemStateLength bits);
+// * outputs: next monitor state (monitorStateLength bits),
+//            followed by the flag bit.
+// After each round, the monitor state outputs are carried back
+// into the monitor state inputs (see CopyMonitorStateLabels).
+class TraceSimulator {
+public:
+  TraceSimulator(
+    Circuit& circuit,
+    unsigned monitorStateLength,
+    unsigned systemStateLength);
+  // Evaluates a single round with the given system state,
+  // updates the monitor state, and returns the flag bit.
+  bool step(const std::vector<bool>& systemState);
+  // Runs `system` for at most `rounds` rounds, the same way
+  // the protocols do: the system is only updated (via next())
+  // when the flag bit is low. If `trace` is given,
+  // every system state is written to it (see TraceSystem).
+  // Returns the (1-based) round in which the flag bit
+  // first went high, if it did.
+  std::optional<unsigned> run(
+    MonitorableSystem& system,
+    unsigned rounds,
+    std::ostream* trace = nullptr);
+  ValueWord monitorState();
+  // Number of rounds evaluated so far.
+  unsigned roundCount();
+private:
+  unsigned monitorStateLength;
+  unsigned systemStateLength;
+  unsigned rounds = 0;
+  BitSlicedEvaluator evaluator;
+  // Single-word slices; only the lowest lane is used.
+  std::vector<uint64_t> inputs;
+  std::vector<uint64_t> outputs;
+};
+
+#endif
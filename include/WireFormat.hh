@@ -0,0 +1,78 @@
+#ifndef WIRE_FORMAT_HH
+#define WIRE_FORMAT_HH
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "BigInt.hh"
+#include "Label.hh"
+
+// Encodings of the messages of Y, LWY and BM.
+// TEXT: every field is followed by a space; numbers are in decimal,
+// and labels and group elements in hex (elements without padding).
+// BINARY: numbers take 4 big-endian bytes, and group elements are
+// big-endian, padded to the byte length of their group.
+// Labels are raw bytes. Labels are written in one of a few columns
+// (e.g., the rows of garbled gates); those of a column in a message
+// are of the same length, written (in 2 big-endian bytes)
+// before the first of them.
+// Hex strings are packed, after their number of digits (2 bytes).
+// Messages are framed by the MessageHandler; so, they carry
+// no length of their own.
+// Monitor picks the format, and System learns it from
+// the gate count handshake.
+enum class WireFormat { TEXT, BINARY };
+const unsigned LABEL_COLUMN_COUNT = 4;
+
+const char* wireFormatName(WireFormat format);
+// Throws std::invalid_argument for unknown names.
+WireFormat parseWireFormat(const std::string& name);
+
+// A MessageWriter appends the fields of a message in a wire format.
+class MessageWriter {
+public:
+  explicit MessageWriter(WireFormat format);
+  void number(uint32_t n);
+  // Labels of a column should be of the same length.
+  void label(const Label& label, unsigned column = 0);
+  void element(const BigInt& element, unsigned byteLength);
+  // A hex string of any length (e.g., an encrypted OT message).
+  void hex(const std::string& hex);
+  // The message written so far; the writer is left empty.
+  std::string take();
+private:
+  WireFormat format;
+  std::string buffer;
+  // Lengths of the labels of each column; 0 before the first one.
+  std::array<size_t, LABEL_COLUMN_COUNT> labelLengths = {};
+  void putBytes(uint64_t n, unsigned count);
+};
+
+// A MessageReader reads the fields of a message in the order
+// they were written, moving a pointer through the message;
+// the message is never split into tokens up front.
+// It should outlive the reader. Reading past its end,
+// or a malformed field, throws MalformedMessage.
+class MessageReader {
+public:
+  MessageReader(WireFormat format, const std::string& message);
+  uint32_t number();
+  Label label(unsigned column = 0);
+  BigInt element(unsigned byteLength);
+  std::string hex();
+  // Whether all fields have been read.
+  bool atEnd();
+private:
+  WireFormat format;
+  const unsigned char* position;
+  const unsigned char* end;
+  std::array<size_t, LABEL_COLUMN_COUNT> labelLengths = {};
+  // TEXT: the next whitespace-delimited field.
+  std::string_view token();
+  // BINARY: the next `count` bytes.
+  const unsigned char* bytes(size_t count);
+  uint64_t getBytes(unsigned count);
+};
+
+#endif
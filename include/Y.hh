@@ -1,15 +1,36 @@
 #ifndef YAO_PROTOCOL_HH
 #define YAO_PROTOCOL_HH
 
+#include <future>
 #include "Circuit.hh"
 #include "State.hh"
 #include "YaoGarbler.hh"
 #include "MonitorableSystem.hh"
 #include "MessageHandler.hh"
 #include "Timer.hh"
+#include "ThreadPool.hh"
 #include "BM.hh"
+#include "WireFormat.hh"
 
 namespace Y {
+  // Number of gates garbled by a thread in one go.
+  const unsigned GARBLING_CHUNK_SIZE = 512;
+  // Number of gates of a level evaluated by a thread in one go.
+  const unsigned EVALUATION_CHUNK_SIZE = 64;
+
+  // Tweak of gate `gateId` in round `round` (see YaoGarbler::enc):
+  // monitor state labels are carried across rounds, so the same
+  // labels may reach a gate in two rounds; with free-XOR, tables
+  // garbled with the same tweak would give away the global offset.
+  uint64_t gateTweak(unsigned round, unsigned gateId);
+
+  // The monitor decodes the flag bit with the digests of both
+  // of its labels (SHAKE-256, tweaked with gateTweak()),
+  // rather than the labels themselves: with free-XOR,
+  // their XOR would be the global offset, and would give away
+  // both labels of every wire.
+  Label flagBitDigest(const Label& label, uint64_t tweak);
+
   class ParameterSet {
   public:
     // Circuit description
@@ -21,16 +42,39 @@ namespace Y {
     // Encryption parameters
     YaoGarbler* garbler;
     unsigned securityParameter;
+    // Optional; without a pool, everything runs on one thread.
+    ThreadPool* threadPool = nullptr;
+    // Garbled gates are sent in messages of at most this many gates,
+    // each garbled while the previous one is sent, and evaluated
+    // by the monitor as it arrives; 0 sends all gates in a single message.
+    unsigned streamChunkSize = 0;
+    // Encoding of all messages, including those of oblivious transfers.
+    WireFormat wireFormat = WireFormat::TEXT;
     unsigned inputLength();
+    // Number of messages of garbled gates in a round.
+    unsigned chunkCount();
+    // Gates (as ID's) of message k.
+    DriverRange chunk(unsigned k);
   };
 
   class SystemMemory {
   public:
     Circuit* circuit;
     MonitorableSystem* system;
+    // Computed from `circuit` on first use, if left empty;
+    // only needed by garblers that derive output labels.
+    Levelization levelization;
     std::vector<LabelPair> driverLabels;
+    // Gates of the chunk being garbled (see ParameterSet::chunk).
     std::vector<GarbledGate> garbledGates;
+    // The next message of garbled gates, garbled in the background
+    // while earlier messages are sent; and the time it took,
+    // added to `timer` once it is sent.
+    std::future<std::string> nextGarbledChunk;
+    float nextGarblingTime = 0;
     bool isFirstRound = true;
+    // Counts rounds, for gate tweaks (see gateTweak()).
+    unsigned round = 0;
     // Whenever the current protocol state is a 'Recv' state,
     // receivedMessage stores the message received for that state.
     std::string receivedMessage;
@@ -50,10 +94,21 @@ namespace Y {
   class MonitorMemory {
   public:
     Circuit* circuit;
+    // Both computed from `circuit` on first use, if left empty;
+    // gates are levelled by the chunks they are streamed in
+    // (see Circuit::levelize()).
+    Levelization levelization;
+    SlotAllocation slotAllocation;
+    // Gates of the chunk being evaluated; dropped once evaluated.
     std::vector<GarbledGate> garbledGates;
+    // Indexed by slot (see SlotAllocation); gates are evaluated
+    // level by level, and labels of dead drivers are overwritten.
     std::vector<Label> evaluatedDriverLabels;
-    LabelPair flagBitLabels;
+    // Digests of both flag bit labels (see flagBitDigest()).
+    LabelPair flagBitDigests;
     bool isFirstRound = true;
+    // Counts rounds, in step with the system's (see gateTweak()).
+    unsigned round = 0;
     std::string receivedMessage;
     Timer timer;
   };
@@ -124,17 +179,24 @@ namespace Y {
   public:
     using SystemState::SystemState;
     StatePtr next() override;
+    // Garbles the gates of chunk k, and returns their message.
+    std::string garbleChunk(unsigned k);
+    // Garbles chunk k in the background, into memory->nextGarbledChunk.
+    void garbleChunkInBackground(unsigned k);
   private:
-    void garble();
+    void garble(DriverRange gates);
     void fillDriverLabels();
   };
 
   class SendGarbledGates : public SystemState {
   public:
-    using SystemState::SystemState;
+    SendGarbledGates(
+      ParameterSet* parameters, SystemMemory* memory, unsigned chunk);
     bool isSend() override;
     std::string message() override;
     StatePtr next() override;
+  private:
+    unsigned chunk;
   };
 
   class SendSystemInputLabels : public SystemState {
@@ -159,7 +221,7 @@ namespace Y {
     std::string message() override;
     StatePtr next() override;
   private:
-    LabelPair flagBitLabels();
+    LabelPair flagBitDigests();
   };
 
   class SystemObliviousTransfer : public SystemState {
@@ -221,9 +283,12 @@ namespace Y {
 
   class RecvGarbledGates : public MonitorState {
   public:
-    using MonitorState::MonitorState;
+    RecvGarbledGates(
+      ParameterSet* parameters, MonitorMemory* memory, unsigned chunk = 0);
     bool isRecv() override;
     StatePtr next() override;
+  private:
+    unsigned chunk;
   };
 
   class RecvSystemInputLabels : public MonitorState {
@@ -231,6 +296,8 @@ namespace Y {
     using MonitorState::MonitorState;
     bool isRecv() override;
     StatePtr next() override;
+  private:
+    void allocateSlots();
   };
 
   class RecvFlagBitLabels : public MonitorState {
@@ -259,11 +326,14 @@ namespace Y {
 
   class EvaluateCircuit : public MonitorState {
   public:
-    using MonitorState::MonitorState;
+    EvaluateCircuit(
+      ParameterSet* parameters, MonitorMemory* memory, unsigned chunk);
     StatePtr next() override;
   private:
+    unsigned chunk;
     std::string padLabel(BigInt label);
     std::vector<unsigned> getUnshuffling_Timed();
+    void evaluateGate(unsigned id, unsigned chunkBegin);
     void evaluateDriverLabels();
   };
 
@@ -2,23 +2,22 @@
 #define YAO_GARBLER_HH
 
 #include <array>
-#include <string>
 #include <vector>
-
-using Label = std::string;
-using Ciphertext = std::string;
+#include "Circuit.hh"
+#include "Label.hh"
 
 // As the garbler does encryption and decryption,
-// it suffices to define its interface using only strings
-// and convert wire labels to strings outside the garbler.
+// it suffices to define its interface using only binary labels
+// and convert wire labels (e.g., group elements) outside the garbler.
 // For this reason, both LabelPair and GarbledGate are
-// defined as containers of strings.
+// defined as containers of labels.
+using Ciphertext = Label;
 
-// A LabelPair is an array of [exactly] 2 strings.
+// A LabelPair is an array of [exactly] 2 labels.
 using LabelPair = std::array<Label, 2>;
 
-// A GarbledGate is an array of [exactly] 4 strings;
-// each string is the encrypted form of an output wire label.
+// A GarbledGate is an array of [exactly] 4 labels;
+// each one is the encrypted form of an output wire label.
 // This vector should be thought of as 
 // a random permutation of the encrypted values
 // (e.g., similar to an unordered_set).
@@ -26,29 +25,61 @@ using GarbledGate = std::array<Ciphertext, 4>;
 
 class YaoGarbler {
 public:
-  GarbledGate enc(
-    LabelPair left,
-    LabelPair right,
-    LabelPair out);
+  virtual ~YaoGarbler() = default;
+
+  // Garbles a gate with the given tweak, used by schemes that hash
+  // labels per gate, and ignored otherwise. A tweak must not be used
+  // for two gates of a session; e.g., Yao tweaks gate ID's with
+  // the round (see Y::gateTweak), as labels may repeat across rounds.
+  // Schemes that derive output labels (see derivesOutputLabels())
+  // overwrite `out` with the labels of the garbled gate.
+  // For NOT gates, `right` is the same pair as `left`.
+  virtual GarbledGate enc(
+    const LabelPair& left,
+    const LabelPair& right,
+    LabelPair& out,
+    uint64_t tweak = 0,
+    GateType type = GateType::NAND);
 
   // For decryption, only the 'correct' keys are necessary.
   // With these keys, the garbler tries to decrypt the gate
   // and returns at the first succesful decryption.
-  Label dec(
-    Label left,
-    Label right,
-    GarbledGate gate);
+  virtual Label dec(
+    const Label& left,
+    const Label& right,
+    const GarbledGate& gate,
+    uint64_t tweak = 0,
+    GateType type = GateType::NAND);
+
+  // Number of ciphertexts per garbled gate of the given type
+  // that are actually used; the remaining entries
+  // of a GarbledGate are left empty.
+  virtual unsigned ciphertextCount(GateType type = GateType::NAND);
+
+  // Number of hash function calls made by enc() and dec()
+  // for a gate of the given type; only used for cost estimates.
+  virtual unsigned garblingHashCount(GateType type = GateType::NAND);
+  virtual unsigned evaluationHashCount(GateType type = GateType::NAND);
+
+  // If true, output labels of a gate are computed by enc()
+  // from its input labels; so, gates must be garbled
+  // in topological order, and only input labels are random.
+  virtual bool derivesOutputLabels();
+
+  // A fresh pair of labels, each of `length` random bytes.
+  virtual LabelPair randomLabelPair(unsigned length);
 protected:
-  virtual bool checkLabels(std::vector<Label> labels) = 0;
+  // The following hooks implement the default 4-row scheme;
+  // schemes that override enc() and dec() need not implement them.
+  virtual bool checkLabels(const std::vector<const Label*>& labels);
 
   // As the exact implementation of {en,de}-cryption
   // is left to the children of YaoGarbler,
-  // the following methods are suffixed with 'Impl'
-  // and defined as protected pure virtual methods.
+  // the following methods are suffixed with 'Impl'.
   virtual Ciphertext encImpl(
-    Label left, Label right, Label out) = 0;
+    const Label& left, const Label& right, const Label& out);
   virtual Label decImpl(
-    Label left, Label right, Ciphertext cipher) = 0;
+    const Label& left, const Label& right, const Ciphertext& cipher);
 };
 
 #endif
@@ -81,7 +81,7 @@ P::GenerateConstant::GenerateConstant(
 
 StatePtr P::GenerateConstant::next() {
   printf("I: GenerateConstant::next\n");
-  this->memory->constant = this->parameters->group.randomGenerator();
+  this->memory->constant = this->parameters->group->randomGenerator();
   // printf("D:   generated constant: %s\n",
   //   toString(this->memory->constant, P::MSG_NUM_BASE).c_str());
   return std::make_unique<SendConstant> (
@@ -97,7 +97,10 @@ bool P::SendConstant::isSend() {
 }
 
 std::string P::SendConstant::message() {
-  return toString(this->memory->constant, P::MSG_NUM_BASE);
+  MessageWriter writer(this->parameters->wireFormat);
+  writer.element(
+    this->memory->constant, this->parameters->group->elementByteLength());
+  return writer.take();
 }
 
 StatePtr P::SendConstant::next() {
@@ -115,7 +118,7 @@ bool P::RecvPublicKey::isRecv() {
 }
 
 void P::RecvPublicKey::evaluatePublicKeys(BigInt receivedKey) {
-  auto group = this->parameters->group;
+  auto& group = *this->parameters->group;
   this->memory->publicKeys[0] = receivedKey;
   this->memory->publicKeys[1] = group.mul(
     this->memory->constant,
@@ -125,8 +128,10 @@ void P::RecvPublicKey::evaluatePublicKeys(BigInt receivedKey) {
 
 StatePtr P::RecvPublicKey::next() {
   printf("I: RecvPublicKey::next\n");
-  auto& message = this->memory->receivedMessage;
-  auto receivedKey = BigInt(message, P::MSG_NUM_BASE);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  auto receivedKey =
+    reader.element(this->parameters->group->elementByteLength());
   this->evaluatePublicKeys(receivedKey);
   return std::make_unique<EncryptMessages> (
     this->parameters, this->memory);
@@ -151,17 +156,17 @@ std::string P::EncryptMessages::encrypt(
 
 std::string P::EncryptMessages::padNumber(BigInt number) {
   auto labelStr = toString(number, P::MSG_NUM_BASE);
-  auto targetLength = this->parameters->securityParameter / 4;
+  auto targetLength = this->parameters->group->elementHexLength();
   return std::string(targetLength - labelStr.size(), '0') + labelStr;
 }
 
 StatePtr P::EncryptMessages::next() {
   printf("I: EncryptMessages::next\n");
-  auto group = this->parameters->group;
+  auto& group = *this->parameters->group;
   for (size_t i = 0; i < 2; i++) {
-    auto randomExponent = this->parameters->group.randomExponent();
-    this->memory->encryptionElements[i] = toString(
-      group.exp(group.baseGenerator, randomExponent), P::MSG_NUM_BASE);
+    auto randomExponent = this->parameters->group->randomExponent();
+    this->memory->encryptionElements[i] =
+      group.expFixedBase(group.baseGenerator, randomExponent);
     auto expdPubKey = group.exp(this->memory->publicKeys[i], randomExponent);
     auto padExpPubKey = this->padNumber(expdPubKey);
     auto hashedExpdPubKey = hashShake256(padExpPubKey);
@@ -182,11 +187,13 @@ bool P::SendEncryptedMessages::isSend() {
 }
 
 std::string P::SendEncryptedMessages::message() {
-  return
-    this->memory->encryptionElements[0] + ' '
-    + this->memory->encryptedMessages[0] + ' '
-    + this->memory->encryptionElements[1] + ' '
-    + this->memory->encryptedMessages[1];
+  MessageWriter writer(this->parameters->wireFormat);
+  auto elementByteLength = this->parameters->group->elementByteLength();
+  for (size_t i = 0; i < 2; i++) {
+    writer.element(this->memory->encryptionElements[i], elementByteLength);
+    writer.hex(this->memory->encryptedMessages[i]);
+  }
+  return writer.take();
 }
 
 StatePtr P::SendEncryptedMessages::next() {
@@ -225,9 +232,12 @@ bool P::RecvConstant::isRecv() {
 
 StatePtr P::RecvConstant::next() {
   printf("I: RecvConstant::next\n");
-  std::cout << "D: received message: " << this->memory->receivedMessage << '\n';
-  auto& message = this->memory->receivedMessage;
-  this->memory->senderConstant = BigInt(message, P::MSG_NUM_BASE);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  this->memory->senderConstant =
+    reader.element(this->parameters->group->elementByteLength());
+  std::cout << "D: received constant: "
+    << toString(this->memory->senderConstant, P::MSG_NUM_BASE) << '\n';
   return std::make_unique<GeneratePublicKey> (
     this->parameters, this->memory);
 }
@@ -238,7 +248,7 @@ P::GeneratePublicKey::GeneratePublicKey(
 
 StatePtr P::GeneratePublicKey::next() {
   printf("I: GeneratePublicKey::next\n");
-  this->memory->key = this->parameters->group.randomExponent();
+  this->memory->key = this->parameters->group->randomExponent();
   return std::make_unique<SendPublicKey> (
     this->parameters, this->memory);
 }
@@ -252,15 +262,17 @@ bool P::SendPublicKey::isSend() {
 }
 
 std::string P::SendPublicKey::message() {
-  auto group = this->parameters->group;
+  auto& group = *this->parameters->group;
   BigInt pubKeys[2];
   const bool sigma = this->memory->sigma;
-  pubKeys[sigma] = group.exp(
+  pubKeys[sigma] = group.expFixedBase(
     group.baseGenerator, this->memory->key);
   pubKeys[not sigma] = group.mul(
     this->memory->senderConstant,
     group.inv(pubKeys[sigma]));
-  return toString(pubKeys[0], P::MSG_NUM_BASE);
+  MessageWriter writer(this->parameters->wireFormat);
+  writer.element(pubKeys[0], group.elementByteLength());
+  return writer.take();
 }
 
 StatePtr P::SendPublicKey::next() {
@@ -279,14 +291,17 @@ bool P::RecvEncryptedMessages::isRecv() {
 
 StatePtr P::RecvEncryptedMessages::next() {
   printf("I: RecvEncryptedMessages::next\n");
-  auto& message = this->memory->receivedMessage;
-  std::string parsedMessage[4];
-  std::stringstream ss(message);
-  for (size_t i = 0; i < 4; i++)
-    ss >> parsedMessage[i];
-  auto elementIndex = 2 * this->memory->sigma;
-  this->memory->encryptionElement = parsedMessage[elementIndex];
-  this->memory->encryptedMessage = parsedMessage[elementIndex + 1];
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  auto elementByteLength = this->parameters->group->elementByteLength();
+  for (size_t i = 0; i < 2; i++) {
+    auto encryptionElement = reader.element(elementByteLength);
+    auto encryptedMessage = reader.hex();
+    if (i == this->memory->sigma) {
+      this->memory->encryptionElement = encryptionElement;
+      this->memory->encryptedMessage = encryptedMessage;
+    }
+  }
   return std::make_unique<DecryptChosenMessage> (
     this->parameters, this->memory);
 }
@@ -310,16 +325,15 @@ std::string P::DecryptChosenMessage::decrypt(
 
 std::string P::DecryptChosenMessage::padNumber(BigInt number) {
   auto labelStr = toString(number, P::MSG_NUM_BASE);
-  auto targetLength = this->parameters->securityParameter / 4;
+  auto targetLength = this->parameters->group->elementHexLength();
   return std::string(targetLength - labelStr.size(), '0') + labelStr;
 }
 
 StatePtr P::DecryptChosenMessage::next() {
   printf("I: DecryptChosenMessage::next\n");
-  auto group = this->parameters->group;
-  auto encryptionElement = BigInt(
-    this->memory->encryptionElement, P::MSG_NUM_BASE);
-  auto encryptionKey = group.exp(encryptionElement, this->memory->key);
+  auto& group = *this->parameters->group;
+  auto encryptionKey =
+    group.exp(this->memory->encryptionElement, this->memory->key);
   auto padEncKey = this->padNumber(encryptionKey);
   auto hashedEncKey = hashShake256(padEncKey);
   auto& encryptedMessage = this->memory->encryptedMessage;
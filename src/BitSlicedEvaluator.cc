@@ -0,0 +1,192 @@
+#include <cassert>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_SLICED_X86 1
+#endif
+#include "BitSlicedEvaluator.hh"
+
+namespace {
+  inline uint64_t gateWord(GateType type, uint64_t a, uint64_t b) {
+    switch (type) {
+      case GateType::NAND: return ~(a & b);
+      case GateType::AND:  return a & b;
+      case GateType::OR:   return a | b;
+      case GateType::XOR:  return a ^ b;
+      case GateType::XNOR: return ~(a ^ b);
+      case GateType::NOT:  return ~a;
+    }
+    return 0;
+  }
+
+  // Each of the following functions evaluates gates [begin, end)
+  // of a circuit, given as left and right input arrays and gate types,
+  // on slices of `words` 64-bit words.
+  void gateSlices64(
+    const uint32_t* left, const uint32_t* right, const GateType* types,
+    uint64_t* values, unsigned begin, unsigned end, unsigned words)
+  {
+    for (unsigned id = begin; id < end; id++) {
+      auto l = values + left[id] * words;
+      auto r = values + right[id] * words;
+      auto o = values + id * words;
+      for (unsigned w = 0; w < words; w++)
+        o[w] = gateWord(types[id], l[w], r[w]);
+    }
+  }
+
+#ifdef BIT_SLICED_X86
+  __attribute__((target("avx2")))
+  inline __m256i gate256(GateType type, __m256i a, __m256i b) {
+    const __m256i ones = _mm256_set1_epi64x(-1);
+    switch (type) {
+      case GateType::NAND:
+        return _mm256_xor_si256(_mm256_and_si256(a, b), ones);
+      case GateType::AND:  return _mm256_and_si256(a, b);
+      case GateType::OR:   return _mm256_or_si256(a, b);
+      case GateType::XOR:  return _mm256_xor_si256(a, b);
+      case GateType::XNOR:
+        return _mm256_xor_si256(_mm256_xor_si256(a, b), ones);
+      case GateType::NOT:  return _mm256_xor_si256(a, ones);
+    }
+    return a;
+  }
+
+  __attribute__((target("avx2")))
+  void gateSlices256(
+    const uint32_t* left, const uint32_t* right, const GateType* types,
+    uint64_t* values, unsigned begin, unsigned end, unsigned words)
+  {
+    for (unsigned id = begin; id < end; id++) {
+      auto l = values + left[id] * words;
+      auto r = values + right[id] * words;
+      auto o = values + id * words;
+      for (unsigned w = 0; w < words; w += 4) {
+        auto a = _mm256_loadu_si256((const __m256i*) (l + w));
+        auto b = _mm256_loadu_si256((const __m256i*) (r + w));
+        _mm256_storeu_si256((__m256i*) (o + w), gate256(types[id], a, b));
+      }
+    }
+  }
+
+  __attribute__((target("avx512f")))
+  inline __m512i gate512(GateType type, __m512i a, __m512i b) {
+    // Truth tables over (a, b), for any third operand;
+    // bit (4a + 2b + c) of the immediate is the result.
+    switch (type) {
+      case GateType::NAND: return _mm512_ternarylogic_epi64(a, b, a, 0x3f);
+      case GateType::AND:  return _mm512_ternarylogic_epi64(a, b, a, 0xc0);
+      case GateType::OR:   return _mm512_ternarylogic_epi64(a, b, a, 0xfc);
+      case GateType::XOR:  return _mm512_ternarylogic_epi64(a, b, a, 0x3c);
+      case GateType::XNOR: return _mm512_ternarylogic_epi64(a, b, a, 0xc3);
+      case GateType::NOT:  return _mm512_ternarylogic_epi64(a, b, a, 0x0f);
+    }
+    return a;
+  }
+
+  __attribute__((target("avx512f")))
+  void gateSlices512(
+    const uint32_t* left, const uint32_t* right, const GateType* types,
+    uint64_t* values, unsigned begin, unsigned end, unsigned words)
+  {
+    for (unsigned id = begin; id < end; id++) {
+      auto a = _mm512_loadu_si512(values + left[id] * words);
+      auto b = _mm512_loadu_si512(values + right[id] * words);
+      _mm512_storeu_si512(values + id * words, gate512(types[id], a, b));
+    }
+  }
+#endif
+
+  bool supportsAvx2() {
+#ifdef BIT_SLICED_X86
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  }
+
+  bool supportsAvx512() {
+#ifdef BIT_SLICED_X86
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+  }
+}
+
+BitSlicedEvaluator::BitSlicedEvaluator(Circuit& circuit)
+  : circuit(circuit) {}
+
+unsigned BitSlicedEvaluator::nativeWords() {
+  if (supportsAvx512())
+    return 8;
+  if (supportsAvx2())
+    return 4;
+  return 1;
+}
+
+void BitSlicedEvaluator::evaluateSliced(
+  const uint64_t* inputs, uint64_t* outputs, unsigned words)
+{
+  assert (words == 1 or words == 4 or words == 8);
+  auto& circuit = this->circuit;
+  auto inputRange = circuit.inputs();
+  auto gateRange = circuit.gates();
+  auto outputRange = circuit.outputs();
+  this->values.resize(circuit.size() * words);
+  std::copy(
+    inputs, inputs + inputRange.size() * words, this->values.begin());
+
+  auto left = circuit.left.data();
+  auto right = circuit.right.data();
+  auto types = circuit.types.data();
+  auto values = this->values.data();
+  auto begin = gateRange.begin, end = gateRange.end;
+#ifdef BIT_SLICED_X86
+  if (words == 8 and supportsAvx512())
+    gateSlices512(left, right, types, values, begin, end, words);
+  else if (words >= 4 and supportsAvx2())
+    gateSlices256(left, right, types, values, begin, end, words);
+  else
+#endif
+    gateSlices64(left, right, types, values, begin, end, words);
+
+  std::copy(
+    this->values.begin() + outputRange.begin * words,
+    this->values.begin() + outputRange.end * words,
+    outputs);
+}
+
+std::vector<ValueWord> BitSlicedEvaluator::evaluate(
+  const std::vector<ValueWord>& inputs)
+{
+  auto inputLength = this->circuit.inputs().size();
+  auto outputLength = this->circuit.outputs().size();
+  auto words = nativeWords();
+  auto lanes = 64 * words;
+  std::vector<ValueWord> results(inputs.size());
+  std::vector<uint64_t> slicedInputs(inputLength * words);
+  std::vector<uint64_t> slicedOutputs(outputLength * words);
+  for (size_t batch = 0; batch < inputs.size(); batch += lanes) {
+    auto batchSize = std::min<size_t>(lanes, inputs.size() - batch);
+    // Transpose the batch: input vector k becomes lane k of every slice.
+    std::fill(slicedInputs.begin(), slicedInputs.end(), 0);
+    for (size_t k = 0; k < batchSize; k++) {
+      auto& input = inputs[batch + k];
+      assert (input.size() == inputLength);
+      uint64_t bit = uint64_t(1) << (k % 64);
+      for (unsigned i = 0; i < inputLength; i++)
+        if (input[i])
+          slicedInputs[i * words + k / 64] |= bit;
+    }
+    this->evaluateSliced(
+      slicedInputs.data(), slicedOutputs.data(), words);
+    for (size_t k = 0; k < batchSize; k++) {
+      auto& result = results[batch + k];
+      result.resize(outputLength);
+      for (unsigned o = 0; o < outputLength; o++)
+        result[o] = (slicedOutputs[o * words + k / 64] >> (k % 64)) & 1;
+    }
+  }
+  return results;
+}
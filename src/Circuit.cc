@@ -1,93 +1,442 @@
 #include <algorithm>
+#include <numeric>
 #include <random>
+#include <unordered_map>
 #include <assert.h>
 #include "MathUtils.hh"
 #include "Circuit.hh"
 
-Driver::Driver(unsigned id) : id(id) {}
+unsigned DriverRange::size() const {
+  return this->end - this->begin;
+}
+
+unsigned Levelization::depth() {
+  return this->offsets.size() - 1;
+}
+
+DriverRange Levelization::level(unsigned k) {
+  assert (k >= 1 and k <= this->depth());
+  return { this->offsets[k - 1], this->offsets[k] };
+}
+
+unsigned Levelization::width(unsigned k) {
+  return this->level(k).size();
+}
+
+unsigned Levelization::maxWidth() {
+  unsigned result = 0;
+  for (unsigned k = 1; k <= this->depth(); k++)
+    result = std::max(result, this->width(k));
+  return result;
+}
 
-void Driver::drive(unsigned gateId) {
-  this->drivenGates.push_back(gateId);
+double Levelization::averageWidth() {
+  if (this->depth() == 0)
+    return 0;
+  return (double) this->order.size() / this->depth();
 }
 
-Gate::Gate(unsigned id, unsigned left, unsigned right)
-  : Driver(id), inputLeft(left), inputRight(right) {}
+bool evaluateGate(GateType type, bool left, bool right) {
+  switch (type) {
+    case GateType::NAND: return not (left and right);
+    case GateType::AND:  return left and right;
+    case GateType::OR:   return left or right;
+    case GateType::XOR:  return left != right;
+    case GateType::XNOR: return left == right;
+    case GateType::NOT:  return not left;
+  }
+  assert (false);
+  return false;
+}
+
+const char* gateTypeName(GateType type) {
+  const char* names[GATE_TYPE_COUNT] =
+    { "NAND", "AND", "OR", "XOR", "XNOR", "NOT" };
+  return names[static_cast<unsigned>(type)];
+}
 
 Circuit::Circuit(unsigned inputLength, unsigned outputLength)
-  : inputLength(inputLength), outputLength(outputLength)
-{
-  this->counter = inputLength;
-  for (unsigned i = 0; i < this->inputLength; i++)
-    this->inputs.push_back(std::make_unique<Driver>(i));
+  : inputLength(inputLength), outputLength(outputLength),
+    left(inputLength, NO_DRIVER),
+    right(inputLength, NO_DRIVER),
+    types(inputLength, GateType::NAND),
+    fanoutCounts(inputLength, 0) {}
+
+unsigned Circuit::addNot(unsigned input) {
+  return this->addGate(input, input, GateType::NOT);
 }
 
-unsigned Circuit::addGate(unsigned inputLeft, unsigned inputRight)
+unsigned Circuit::addGate(
+  unsigned inputLeft, unsigned inputRight, GateType type)
 {
-  DriverPtr gate = std::make_unique<Gate>(
-    this->counter, inputLeft, inputRight);
-  this->findDriver(inputLeft)->drive(gate->id);
-  this->findDriver(inputRight)->drive(gate->id);
-  this->internals.push_back(std::move(gate));
-  return this->counter++;
+  // Gates can only be added before outputs are fixed;
+  // otherwise, the output range would not be at the end.
+  assert (not this->hasOutputs);
+  unsigned id = this->size();
+  assert (inputLeft < id and inputRight < id);
+  this->left.push_back(inputLeft);
+  this->right.push_back(inputRight);
+  this->types.push_back(type);
+  this->fanoutCounts.push_back(0);
+  this->fanoutCounts[inputLeft]++;
+  this->fanoutCounts[inputRight]++;
+  this->fanoutOffsets.clear();
+  return id;
 }
 
-std::vector<Driver*> Circuit::shuffle() {
-  auto shuffledGates = this->get();
-  assert (this->inputLength + this->outputLength < this->counter);
+Word Circuit::shuffle(unsigned blockSize) {
+  Word shuffledIds(this->size());
+  std::iota(shuffledIds.begin(), shuffledIds.end(), 0);
+  assert (this->inputLength + this->outputLength < this->size());
   // Only *some* gates need to be shuffled;
   // inputs and gates driving a circuit output wire
   // should stay in place. So, we start shuffling
   // from the first until the last 'internal' 'gate'.
-  auto seed = timeBasedSeed();
-  std::shuffle(
-    shuffledGates.begin() + this->inputLength,
-    shuffledGates.end() - this->outputLength,
-    std::default_random_engine(seed));
-  return shuffledGates;
-}
-
-std::vector<Driver*> Circuit::get() {
-  std::vector<Driver*> drivers;
-  for (auto& input : this->inputs)
-    drivers.push_back(input.get());
-  for (auto& gate : this->internals)
-    drivers.push_back(gate.get());
-  for (auto& output : this->outputs)
-    drivers.push_back(output.get());
-  return drivers;
+  auto begin = this->inputLength;
+  auto end = this->size() - this->outputLength;
+  if (blockSize == 0)
+    blockSize = end - begin;
+  auto random = std::default_random_engine(timeBasedSeed());
+  for (auto block = begin; block < end; block += blockSize)
+    std::shuffle(
+      shuffledIds.begin() + block,
+      shuffledIds.begin() + std::min(block + blockSize, end),
+      random);
+  return shuffledIds;
 }
 
 void Circuit::updateOutputs(Word outputIds) {
   assert (outputIds.size() == this->outputLength);
-  // ASSUMPTION: internals are sorted in ascending order of their ID's.
-  std::vector<unsigned> indices;
+  assert (not this->hasOutputs);
+  // An output must be a gate of its own, driving no other gate;
+  // otherwise, it cannot be moved to the end of the circuit.
+  // Other outputs (i.e., inputs, gates driving other gates,
+  // and drivers of several outputs) are aliased to a copy.
+  std::vector<uint32_t> outputCounts(this->size(), 0);
+  for (auto id : outputIds)
+    outputCounts[id]++;
   for (auto& id : outputIds) {
-    auto foundDriver = std::lower_bound(
-      this->internals.begin(), this->internals.end(), id,
-      [] (const DriverPtr& driver, unsigned id) { return driver->id < id; });
-    assert (foundDriver != this->internals.end());
-    indices.push_back(foundDriver - this->internals.begin());
+    if (id < this->inputLength)
+      id = this->addGate(id, id, GateType::AND);
+    else if (this->fanoutCounts[id] > 0 or outputCounts[id] > 1) {
+      outputCounts[id]--;
+      id = this->addGate(this->left[id], this->right[id], this->types[id]);
+    }
   }
-  for (auto& i : indices)
-    this->outputs.push_back(std::move(this->internals[i]));
-  auto removeIt = std::remove_if(
-    this->internals.begin(), this->internals.end(),
-    [] (const DriverPtr& driver) { return driver == nullptr; });
-  this->internals.erase(removeIt, this->internals.end());
-  assert (this->outputs.size() == this->outputLength);
-  assert (
-    this->internals.size() + this->inputs.size()
-    == this->counter - this->outputLength);
+  auto driverCount = this->size();
+  std::vector<bool> isOutput(driverCount, false);
+  for (auto id : outputIds) {
+    assert (id >= this->inputLength and id < driverCount);
+    assert (not isOutput[id]);
+    isOutput[id] = true;
+  }
+  // newIds[id] is the ID of driver `id` after moving outputs to the end.
+  // Other drivers keep their relative order.
+  // If outputs are already the last gates (in order),
+  // this is the identity mapping.
+  std::vector<uint32_t> newIds(driverCount);
+  unsigned counter = 0;
+  for (unsigned id = 0; id < driverCount; id++)
+    if (not isOutput[id])
+      newIds[id] = counter++;
+  for (auto id : outputIds)
+    newIds[id] = counter++;
+
+  std::vector<uint32_t> newLeft(driverCount, NO_DRIVER);
+  std::vector<uint32_t> newRight(driverCount, NO_DRIVER);
+  std::vector<GateType> newTypes(driverCount, GateType::NAND);
+  std::vector<uint32_t> newFanoutCounts(driverCount);
+  for (unsigned id = 0; id < driverCount; id++) {
+    auto newId = newIds[id];
+    newFanoutCounts[newId] = this->fanoutCounts[id];
+    if (id < this->inputLength)
+      continue;
+    newLeft[newId] = newIds[this->left[id]];
+    newRight[newId] = newIds[this->right[id]];
+    newTypes[newId] = this->types[id];
+  }
+  // As outputs drive no gates, ID order is still a topological order.
+  for (unsigned id = this->inputLength; id < driverCount; id++)
+    assert (newLeft[id] < id and newRight[id] < id);
+  this->left = std::move(newLeft);
+  this->right = std::move(newRight);
+  this->types = std::move(newTypes);
+  this->fanoutCounts = std::move(newFanoutCounts);
+  this->fanoutOffsets.clear();
+  this->hasOutputs = true;
 }
 
 unsigned Circuit::size() {
-  return this->counter;
+  return this->left.size();
+}
+
+unsigned Circuit::gateCount() {
+  return this->size() - this->inputLength;
+}
+
+DriverRange Circuit::inputs() {
+  return { 0, this->inputLength };
+}
+
+DriverRange Circuit::internals() {
+  auto end = this->hasOutputs
+    ? this->size() - this->outputLength
+    : this->size();
+  return { this->inputLength, end };
+}
+
+DriverRange Circuit::outputs() {
+  if (not this->hasOutputs)
+    return { this->size(), this->size() };
+  return { this->size() - this->outputLength, this->size() };
+}
+
+DriverRange Circuit::gates() {
+  return { this->inputLength, this->size() };
+}
+
+unsigned Circuit::inputLeft(unsigned id) {
+  return this->left[id];
+}
+
+unsigned Circuit::inputRight(unsigned id) {
+  return this->right[id];
+}
+
+GateType Circuit::gateType(unsigned id) {
+  return this->types[id];
+}
+
+unsigned Circuit::gateCount(GateType type) {
+  auto range = this->gates();
+  return std::count(
+    this->types.begin() + range.begin, this->types.begin() + range.end, type);
+}
+
+Circuit Circuit::toNand() {
+  Circuit result(this->inputLength, this->outputLength);
+  // nandIds[id] is the ID of the driver computing `id` in `result`.
+  std::vector<uint32_t> nandIds(this->size());
+  for (unsigned id = 0; id < this->inputLength; id++)
+    nandIds[id] = id;
+  // NAND gates of `result`, by their (ordered) inputs.
+  std::unordered_map<uint64_t, uint32_t> nands;
+  auto nand = [&] (uint32_t l, uint32_t r) {
+    auto key = (uint64_t(std::min(l, r)) << 32) | std::max(l, r);
+    auto [it, inserted] = nands.try_emplace(key, 0);
+    if (inserted)
+      it->second = result.addGate(l, r);
+    return it->second;
+  };
+  auto gateRange = this->gates();
+  for (auto id = gateRange.begin; id < gateRange.end; id++) {
+    auto l = nandIds[this->left[id]];
+    auto r = nandIds[this->right[id]];
+    unsigned out = 0;
+    switch (this->types[id]) {
+      case GateType::NAND:
+        out = nand(l, r);
+        break;
+      case GateType::AND: {
+        auto lr = nand(l, r);
+        out = nand(lr, lr);
+        break;
+      } case GateType::OR: {
+        // a + b = ~((~a) (~b))
+        auto lInv = nand(l, l);
+        auto rInv = nand(r, r);
+        out = nand(lInv, rInv);
+        break;
+      } case GateType::XOR:
+      case GateType::XNOR: {
+        // l ^ r = ~(~(l & ~(lr)) & ~(r & ~(lr)))
+        auto nandAux = nand(l, r);
+        auto nandLAux = nand(l, nandAux);
+        auto nandRAux = nand(r, nandAux);
+        out = nand(nandLAux, nandRAux);
+        if (this->types[id] == GateType::XNOR)
+          out = nand(out, out);
+        break;
+      } case GateType::NOT:
+        out = nand(l, l);
+        break;
+    }
+    nandIds[id] = out;
+  }
+  if (this->hasOutputs) {
+    Word outputIds;
+    auto outputRange = this->outputs();
+    for (auto id = outputRange.begin; id < outputRange.end; id++)
+      outputIds.push_back(nandIds[id]);
+    result.updateOutputs(outputIds);
+  }
+  return result;
+}
+
+Circuit Circuit::withXorCopies() {
+  assert (this->hasOutputs and this->inputLength > 0);
+  Circuit result(this->inputLength, this->outputLength);
+  // Internal gates keep their ID's; they are indexed
+  // by type and (ordered) inputs to find copies.
+  std::unordered_map<uint64_t, uint32_t> gateIndex[GATE_TYPE_COUNT];
+  auto key = [] (uint32_t l, uint32_t r) {
+    return (uint64_t(std::min(l, r)) << 32) | std::max(l, r);
+  };
+  auto internalRange = this->internals();
+  for (auto id = internalRange.begin; id < internalRange.end; id++) {
+    auto type = this->types[id];
+    result.addGate(this->left[id], this->right[id], type);
+    gateIndex[static_cast<unsigned>(type)].try_emplace(
+      key(this->left[id], this->right[id]), id);
+  }
+  // The zero is x ^ x, for the first input x.
+  auto zero = NO_DRIVER;
+  Word outputIds;
+  auto outputRange = this->outputs();
+  for (auto id = outputRange.begin; id < outputRange.end; id++) {
+    auto l = this->left[id], r = this->right[id];
+    auto type = this->types[id];
+    auto source = NO_DRIVER;
+    if (l == r and (type == GateType::AND or type == GateType::OR))
+      source = l;
+    auto& index = gateIndex[static_cast<unsigned>(type)];
+    if (auto found = index.find(key(l, r)); found != index.end())
+      source = found->second;
+    if (source == NO_DRIVER) {
+      outputIds.push_back(result.addGate(l, r, type));
+      continue;
+    }
+    if (zero == NO_DRIVER)
+      zero = result.addGate(0, 0, GateType::XOR);
+    outputIds.push_back(result.addGate(source, zero, GateType::XOR));
+  }
+  result.updateOutputs(outputIds);
+  return result;
+}
+
+void Circuit::indexFanout() {
+  // Counting sort of (driver, gate) edges by driver.
+  auto driverCount = this->size();
+  this->fanoutOffsets.assign(driverCount + 1, 0);
+  for (unsigned id = 0; id < driverCount; id++)
+    this->fanoutOffsets[id + 1] =
+      this->fanoutOffsets[id] + this->fanoutCounts[id];
+  this->fanoutTargets.resize(this->fanoutOffsets[driverCount]);
+  std::vector<uint32_t> cursor(
+    this->fanoutOffsets.begin(), this->fanoutOffsets.end() - 1);
+  for (unsigned id = this->inputLength; id < driverCount; id++) {
+    this->fanoutTargets[cursor[this->left[id]]++] = id;
+    this->fanoutTargets[cursor[this->right[id]]++] = id;
+  }
+}
+
+Word Circuit::fanout(unsigned id) {
+  assert (id < this->size());
+  if (this->fanoutOffsets.empty())
+    this->indexFanout();
+  return Word(
+    this->fanoutTargets.begin() + this->fanoutOffsets[id],
+    this->fanoutTargets.begin() + this->fanoutOffsets[id + 1]);
+}
+
+unsigned Circuit::fanoutCount(unsigned id) {
+  return this->fanoutCounts[id];
+}
+
+Levelization Circuit::levelize(unsigned chunkSize) {
+  Levelization result;
+  auto driverCount = this->size();
+  auto& levels = result.levels;
+  levels.assign(driverCount, 0);
+  unsigned depth = 0;
+  // Lowest level of the gates of the current chunk.
+  unsigned chunkLevel = 1;
+  // ID order is a topological order;
+  // so, inputs of a gate are always levelled before the gate.
+  for (unsigned id = this->inputLength; id < driverCount; id++) {
+    if (chunkSize > 0 and (id - this->inputLength) % chunkSize == 0)
+      chunkLevel = depth + 1;
+    levels[id] = std::max(chunkLevel,
+      1 + std::max(levels[this->left[id]], levels[this->right[id]]));
+    depth = std::max(depth, levels[id]);
+  }
+  // Counting sort of gates by level.
+  auto& offsets = result.offsets;
+  offsets.assign(depth + 1, 0);
+  for (unsigned id = this->inputLength; id < driverCount; id++)
+    offsets[levels[id]]++;
+  for (unsigned k = 1; k <= depth; k++)
+    offsets[k] += offsets[k - 1];
+  std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+  result.order.resize(this->gateCount());
+  for (unsigned id = this->inputLength; id < driverCount; id++)
+    result.order[cursor[levels[id] - 1]++] = id;
+  return result;
+}
+
+SlotAllocation Circuit::allocateSlots(Levelization& levelization) {
+  assert (this->hasOutputs);
+  auto driverCount = this->size();
+  auto depth = levelization.depth();
+  auto& levels = levelization.levels;
+  // lastLevels[id] is the deepest level reading driver `id`;
+  // drivers that no gate reads die at their own level.
+  std::vector<uint32_t> lastLevels(levels.begin(), levels.end());
+  for (unsigned id = this->inputLength; id < driverCount; id++) {
+    auto level = levels[id];
+    auto& left = lastLevels[this->left[id]];
+    auto& right = lastLevels[this->right[id]];
+    left = std::max(left, level);
+    right = std::max(right, level);
+  }
+  auto outputRange = this->outputs();
+  for (auto id = outputRange.begin; id < outputRange.end; id++)
+    lastLevels[id] = depth + 1;
+
+  // Counting sort of drivers by the level after which they die.
+  std::vector<uint32_t> releaseOffsets(depth + 3, 0);
+  for (unsigned id = 0; id < driverCount; id++)
+    releaseOffsets[lastLevels[id] + 1]++;
+  for (unsigned k = 1; k < releaseOffsets.size(); k++)
+    releaseOffsets[k] += releaseOffsets[k - 1];
+  std::vector<uint32_t> releaseOrder(driverCount);
+  std::vector<uint32_t> cursor(releaseOffsets.begin(), releaseOffsets.end() - 1);
+  for (unsigned id = 0; id < driverCount; id++)
+    releaseOrder[cursor[lastLevels[id]]++] = id;
+
+  SlotAllocation result;
+  auto& slots = result.slots;
+  slots.resize(driverCount);
+  for (unsigned id = 0; id < this->inputLength; id++)
+    slots[id] = id;
+  result.slotCount = this->inputLength;
+  std::vector<uint32_t> freeSlots;
+  auto release = [&] (unsigned k) {
+    for (auto i = releaseOffsets[k]; i < releaseOffsets[k + 1]; i++)
+      freeSlots.push_back(slots[releaseOrder[i]]);
+  };
+  // Inputs that no gate reads are free from the start.
+  release(0);
+  for (unsigned k = 1; k <= depth; k++) {
+    auto level = levelization.level(k);
+    for (auto i = level.begin; i < level.end; i++) {
+      auto id = levelization.order[i];
+      if (freeSlots.empty()) {
+        slots[id] = result.slotCount++;
+      } else {
+        slots[id] = freeSlots.back();
+        freeSlots.pop_back();
+      }
+    }
+    release(k);
+  }
+  return result;
 }
 
 ValueWord Circuit::evaluate(ValueWord input) {
-  Word probed;
-  for (auto& o : this->outputs)
-    probed.push_back(o->id);
+  auto outputRange = this->outputs();
+  Word probed(outputRange.size());
+  std::iota(probed.begin(), probed.end(), outputRange.begin);
   auto circuitOutput = this->probe(input, probed);
   // printf("D: circuitOutput.size() = %lu\n", circuitOutput.size());
   assert (circuitOutput.size() == this->outputLength);
@@ -102,46 +451,26 @@ ValueWord Circuit::probe(ValueWord input, Word probed) {
   return probedVals;
 }
 
-Driver* Circuit::findDriver(unsigned id) {
-  // printf("D: -- findDriver(%u) --\n", id);
-  assert (id < this->counter);
-  if (id < this->inputLength)
-    return this->inputs[id].get();
-  auto foundDriver = std::find_if(
-    this->internals.begin(), this->internals.end(),
-    [id] (const DriverPtr& driver) { return driver->id == id; });
-  if (foundDriver != this->internals.end())
-    return foundDriver->get();
-
-  foundDriver = std::find_if(
-    this->outputs.begin(), this->outputs.end(),
-    [id] (const DriverPtr& driver) { return driver->id == id; });
-  // If a driver is not an input or an internal gate,
-  // it must be an output gate.
-  assert (foundDriver != this->outputs.end());
-  return foundDriver->get();
-}
-
 ValueWord Circuit::evaluateInternal(ValueWord input) {
-  // TODO: evaluate in topological order.
-  // This *can* be as simple as evaluating based on id.
+  // Gates only refer to drivers with smaller ID's;
+  // so, evaluating by ID is evaluating in topological order.
   assert (input.size() == this->inputLength);
-  ValueWord driverVals (this->counter, false);
-  auto evalGate = [&] (Gate* gate) {
-    bool left = driverVals[gate->inputLeft];
-    bool right = driverVals[gate->inputRight];
+  ValueWord driverVals (this->size(), false);
+  auto evalGate = [&] (unsigned id) {
+    bool left = driverVals[this->left[id]];
+    bool right = driverVals[this->right[id]];
     // printf("D: id=%u, inputLeft=%u, inputRight=%u, left=%u, right=%u\n",
-    // gate->id, gate->inputLeft, gate->inputRight, left, right);
-    return !(left and right);
+    // id, this->left[id], this->right[id], left, right);
+    return evaluateGate(this->types[id], left, right);
   };
   for (unsigned i = 0; i < this->inputLength; i++)
     driverVals[i] = input[i];
-  for (auto& i : this->internals)
-    driverVals[i->id] = evalGate( static_cast<Gate*> ( i.get() ) );
-  printf("D: internals evaluated\n");
+  auto internalRange = this->internals();
+  for (auto i = internalRange.begin; i < internalRange.end; i++)
+    driverVals[i] = evalGate(i);
 
-  for (auto& o : this->outputs)
-    driverVals[o->id] = evalGate( static_cast<Gate*> ( o.get() ) );
-  printf("D: outputs evaluated\n");
+  auto outputRange = this->outputs();
+  for (auto o = outputRange.begin; o < outputRange.end; o++)
+    driverVals[o] = evalGate(o);
   return driverVals;
 }
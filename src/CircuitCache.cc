@@ -0,0 +1,188 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "CircuitCache.hh"
+#include "CircuitOptimizer.hh"
+#include "MathUtils.hh"
+#include "SpecToCircuitConverter.hh"
+#include "Timer.hh"
+
+namespace {
+  const char MAGIC[8] = { 'P', 'P', 'M', 'C', 'I', 'R', 'C', '\0' };
+
+  struct CircuitFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t inputLength;
+    uint32_t outputLength;
+    uint32_t driverCount;
+  };
+
+  bool readFile(const std::string& fileName, std::string& contents) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (not file)
+      return false;
+    std::stringstream ss;
+    ss << file.rdbuf();
+    contents = ss.str();
+    return true;
+  }
+}
+
+CircuitCache::CircuitCache(std::string directory)
+  : directory(directory) {}
+
+std::string CircuitCache::key(
+  const std::string& specFileName, const std::string& scriptFileName)
+{
+  std::string spec, script;
+  if (not readFile(specFileName, spec) or
+      not readFile(scriptFileName, script))
+    return "";
+  // Lengths separate the two files, so that no other
+  // pair of files has the same hash input.
+  std::stringstream ss;
+  ss << FORMAT_VERSION << ' '
+     << spec.size() << ' ' << spec
+     << script.size() << ' ' << script;
+  return hashShake256(ss.str(), 16);
+}
+
+std::string CircuitCache::fileName(const std::string& key) {
+  return this->directory + "/" + key + ".circuit";
+}
+
+bool CircuitCache::read(const char* data, size_t size, Circuit& circuit) {
+  CircuitFileHeader header;
+  if (size < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+  size_t n = header.driverCount;
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+    or header.version != FORMAT_VERSION
+    or size != sizeof(header) + n * (2 * sizeof(uint32_t) + 1)
+    or header.inputLength + header.outputLength > n)
+    return false;
+  auto left = (const uint32_t*) (data + sizeof(header));
+  auto right = left + n;
+  auto types = (const GateType*) (right + n);
+
+  Circuit result(header.inputLength, header.outputLength);
+  result.left.assign(left, left + n);
+  result.right.assign(right, right + n);
+  result.types.assign(types, types + n);
+  result.fanoutCounts.assign(n, 0);
+  // A corrupt file must not break the invariants of the circuit.
+  for (size_t id = 0; id < header.inputLength; id++)
+    if (left[id] != NO_DRIVER or right[id] != NO_DRIVER)
+      return false;
+  for (size_t id = header.inputLength; id < n; id++) {
+    if (left[id] >= id or right[id] >= id
+      or (uint8_t) types[id] >= GATE_TYPE_COUNT)
+      return false;
+    result.fanoutCounts[left[id]]++;
+    result.fanoutCounts[right[id]]++;
+  }
+  result.hasOutputs = true;
+  circuit = std::move(result);
+  return true;
+}
+
+bool CircuitCache::load(const std::string& key, Circuit& circuit) {
+  if (this->directory.empty() or key.empty())
+    return false;
+  int fd = open(this->fileName(key).c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat status;
+  if (fstat(fd, &status) != 0 or status.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = status.st_size;
+  auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+  bool found = read((const char*) data, size, circuit);
+  munmap(data, size);
+  return found;
+}
+
+void CircuitCache::store(const std::string& key, Circuit& circuit) {
+  if (this->directory.empty() or key.empty())
+    return;
+  mkdir(this->directory.c_str(), 0755);
+  CircuitFileHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FORMAT_VERSION;
+  header.inputLength = circuit.inputs().size();
+  header.outputLength = circuit.outputs().size();
+  header.driverCount = circuit.size();
+  size_t n = header.driverCount;
+
+  // Other processes may read the cache concurrently;
+  // so, the file is written aside, then renamed.
+  auto fileName = this->fileName(key);
+  auto tempFileName = fileName + "." + std::to_string(getpid());
+  std::ofstream file(tempFileName, std::ios::binary);
+  file.write((const char*) &header, sizeof(header));
+  file.write((const char*) circuit.left.data(), n * sizeof(uint32_t));
+  file.write((const char*) circuit.right.data(), n * sizeof(uint32_t));
+  file.write((const char*) circuit.types.data(), n);
+  file.close();
+  if (not file or rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+    printf("I: could not write circuit cache file %s\n", fileName.c_str());
+    remove(tempFileName.c_str());
+  }
+}
+
+Circuit CircuitCache::compile(
+  const std::string& specFileName,
+  unsigned monitorStateLength, unsigned systemStateLength)
+{
+  Timer timer;
+  timer.start();
+  // The split of Bristol inputs is not cached; so, the header
+  // is checked even if the circuit is.
+  bool isBristol = specFileName.ends_with(".bristol");
+  if (isBristol) {
+    auto converter = BristolConverter(specFileName);
+    converter.readHeader();
+    if (converter.monitorStateLength != monitorStateLength
+      or converter.systemStateLength != systemStateLength)
+      throw std::invalid_argument(
+        "Bristol inputs are " + std::to_string(converter.monitorStateLength)
+        + " monitor state and " + std::to_string(converter.systemStateLength)
+        + " system state bits, not mslen and sslen");
+  }
+  auto key = CircuitCache::key(specFileName, SCRIPT_FILE_NAME);
+  Circuit circuit(0, 0);
+  if (this->load(key, circuit)) {
+    printf("I: loaded circuit from cache %s in %f ms\n",
+      this->fileName(key).c_str(), timer.display());
+  } else {
+    // Bristol Fashion circuits are read as they are;
+    // other specs are synthesised with Yosys.
+    auto synthesised = isBristol
+      ? BristolConverter(specFileName).convert()
+      : YosysConverter(specFileName).convert();
+    circuit = CircuitOptimizer(synthesised).optimize();
+    this->store(key, circuit);
+  }
+  if (circuit.inputs().size() != monitorStateLength + systemStateLength)
+    throw std::invalid_argument(
+      "The spec has " + std::to_string(circuit.inputs().size())
+      + " inputs, not mslen + sslen");
+  if (circuit.outputs().size() != monitorStateLength + 1)
+    throw std::invalid_argument(
+      "The spec has " + std::to_string(circuit.outputs().size())
+      + " outputs, not mslen + 1");
+  return circuit;
+}
@@ -0,0 +1,179 @@
+#include <cassert>
+#include <cstdio>
+#include <utility>
+#include "CircuitOptimizer.hh"
+
+namespace {
+  // References to constants; no node ID is that large.
+  const uint32_t CONST_ZERO = UINT32_MAX - 1;
+  const uint32_t CONST_ONE = UINT32_MAX - 2;
+
+  bool isConstant(uint32_t ref) {
+    return ref == CONST_ZERO or ref == CONST_ONE;
+  }
+
+  uint32_t constant(bool value) {
+    return value ? CONST_ONE : CONST_ZERO;
+  }
+}
+
+CircuitOptimizer::CircuitOptimizer(Circuit& circuit)
+  : circuit(circuit) {}
+
+uint32_t CircuitOptimizer::appendNode(
+  GateType type, uint32_t l, uint32_t r)
+{
+  auto id = this->left.size();
+  this->left.push_back(l);
+  this->right.push_back(r);
+  this->types.push_back(type);
+  return id;
+}
+
+bool CircuitOptimizer::isNot(uint32_t x) {
+  return not isConstant(x) and
+    this->left[x] != NO_DRIVER and
+    this->types[x] == GateType::NOT;
+}
+
+bool CircuitOptimizer::complementary(uint32_t x, uint32_t y) {
+  return (isNot(x) and this->left[x] == y) or
+    (isNot(y) and this->left[y] == x);
+}
+
+uint32_t CircuitOptimizer::addNot(uint32_t x) {
+  return this->addNode(GateType::NOT, x, x);
+}
+
+uint32_t CircuitOptimizer::addNode(GateType type, uint32_t l, uint32_t r) {
+  auto& stats = this->stats;
+  if (type == GateType::NOT) {
+    if (isConstant(l)) {
+      stats.folded++;
+      return constant(l == CONST_ZERO);
+    }
+    if (isNot(l)) {
+      stats.doubleNegations++;
+      return this->left[l];
+    }
+  } else {
+    // All gate types are symmetric; constants (if any) go right.
+    if (l > r)
+      std::swap(l, r);
+    if (isConstant(r)) {
+      stats.folded++;
+      bool c = r == CONST_ONE;
+      if (isConstant(l))
+        return constant(evaluateGate(type, l == CONST_ONE, c));
+      switch (type) {
+        case GateType::AND:  return c ? l : CONST_ZERO;
+        case GateType::NAND: return c ? this->addNot(l) : CONST_ONE;
+        case GateType::OR:   return c ? CONST_ONE : l;
+        case GateType::XOR:  return c ? this->addNot(l) : l;
+        case GateType::XNOR: return c ? l : this->addNot(l);
+        default: assert (false);
+      }
+    }
+    if (l == r) {
+      stats.folded++;
+      switch (type) {
+        case GateType::AND:
+        case GateType::OR:   return l;
+        case GateType::NAND: return this->addNot(l);
+        case GateType::XOR:  return CONST_ZERO;
+        case GateType::XNOR: return CONST_ONE;
+        default: assert (false);
+      }
+    }
+    if (complementary(l, r)) {
+      stats.folded++;
+      // x & ~x = 0, x | ~x = 1, x ^ ~x = 1
+      return constant(evaluateGate(type, false, true));
+    }
+  }
+  auto key = (uint64_t(l) << 32) | r;
+  auto& index = this->nodeIndex[static_cast<unsigned>(type)];
+  auto found = index.find(key);
+  if (found != index.end()) {
+    stats.merged++;
+    return found->second;
+  }
+  auto id = this->appendNode(type, l, r);
+  index.emplace(key, id);
+  return id;
+}
+
+uint32_t CircuitOptimizer::materialize(uint32_t ref) {
+  if (not isConstant(ref))
+    return ref;
+  // Constants are derived from the first input:
+  // x NAND ~x = 1, x AND ~x = 0.
+  auto notX = this->addNot(0);
+  auto type = ref == CONST_ONE ? GateType::NAND : GateType::AND;
+  return this->appendNode(type, 0, notX);
+}
+
+Circuit CircuitOptimizer::optimize() {
+  auto& circuit = this->circuit;
+  auto inputLength = circuit.inputs().size();
+  auto outputRange = circuit.outputs();
+  assert (inputLength > 0);
+  this->stats = OptimizerStats();
+  this->stats.gatesBefore = circuit.gateCount();
+  this->left.assign(inputLength, NO_DRIVER);
+  this->right.assign(inputLength, NO_DRIVER);
+  this->types.assign(inputLength, GateType::NAND);
+  for (auto& index : this->nodeIndex)
+    index.clear();
+
+  // refs[id] is the node (or constant) computing driver `id`.
+  std::vector<uint32_t> refs(circuit.size());
+  for (unsigned id = 0; id < inputLength; id++)
+    refs[id] = id;
+  auto gateRange = circuit.gates();
+  for (auto id = gateRange.begin; id < gateRange.end; id++)
+    refs[id] = this->addNode(
+      circuit.gateType(id),
+      refs[circuit.inputLeft(id)],
+      refs[circuit.inputRight(id)]);
+  Word outputs;
+  for (auto id = outputRange.begin; id < outputRange.end; id++)
+    outputs.push_back(this->materialize(refs[id]));
+
+  // Only gates in the cone of an output are kept.
+  auto nodeCount = this->left.size();
+  std::vector<bool> live(nodeCount, false);
+  for (auto id : outputs)
+    live[id] = true;
+  for (auto id = nodeCount; id-- > inputLength;) {
+    if (not live[id])
+      continue;
+    live[this->left[id]] = true;
+    live[this->right[id]] = true;
+  }
+
+  Circuit result(inputLength, outputRange.size());
+  std::vector<uint32_t> newIds(nodeCount);
+  for (unsigned id = 0; id < inputLength; id++)
+    newIds[id] = id;
+  for (auto id = inputLength; id < nodeCount; id++) {
+    if (not live[id]) {
+      this->stats.dead++;
+      continue;
+    }
+    newIds[id] = result.addGate(
+      newIds[this->left[id]], newIds[this->right[id]], this->types[id]);
+  }
+  for (auto& id : outputs)
+    id = newIds[id];
+  result.updateOutputs(outputs);
+
+  this->stats.gatesAfter = result.gateCount();
+  printf(
+    "I: optimized circuit from %u to %u gates "
+    "(%u folded, %u merged, %u double negations, %u dead)\n",
+    this->stats.gatesBefore, this->stats.gatesAfter,
+    this->stats.folded, this->stats.merged,
+    this->stats.doubleNegations, this->stats.dead);
+  return result;
+}
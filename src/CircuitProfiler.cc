@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include "CircuitProfiler.hh"
+
+namespace {
+  std::string bucketName(unsigned k) {
+    if (k <= 1)
+      return std::to_string(k);
+    auto low = 1U << (k - 1);
+    return std::to_string(low) + "-" + std::to_string(2 * low - 1);
+  }
+
+  void printHistogram(const char* name, std::vector<unsigned>& histogram) {
+    printf("- %s:", name);
+    for (unsigned k = 0; k < histogram.size(); k++)
+      if (histogram[k] > 0)
+        printf(" [%s] %u", bucketName(k).c_str(), histogram[k]);
+    printf("\n");
+  }
+}
+
+void CircuitProfile::print() {
+  printf("I: circuit profile\n");
+  printf("- inputs: %u monitor state + %u system state bits; outputs: %u\n",
+    this->monitorStateLength, this->systemStateLength, this->outputLength);
+  printf("- gates: %u (", this->gateCount);
+  bool first = true;
+  for (unsigned t = 0; t < GATE_TYPE_COUNT; t++) {
+    if (this->gateCounts[t] == 0)
+      continue;
+    printf("%s%s %u", first ? "" : ", ",
+      gateTypeName(static_cast<GateType>(t)), this->gateCounts[t]);
+    first = false;
+  }
+  printf(")\n");
+  printf("- depth: %u levels (max. width %u, avg. width %.1f)\n",
+    this->depth, this->maxWidth, this->averageWidth);
+  printHistogram("levels by width", this->levelWidths);
+  printHistogram("drivers by fanout", this->fanouts);
+  printf("- max. fanout: %u\n", this->maxFanout);
+  printf("- peak live labels: %u (%u slots by level)\n",
+    this->peakLiveLabels, this->labelSlots);
+}
+
+CircuitProfiler::CircuitProfiler(
+  Circuit& circuit, unsigned monitorStateLength)
+  : circuit(circuit), monitorStateLength(monitorStateLength) {}
+
+void CircuitProfiler::count(std::vector<unsigned>& histogram, unsigned value) {
+  unsigned k = 0;
+  while (k < 32 and (value >> k) != 0)
+    k++;
+  if (histogram.size() <= k)
+    histogram.resize(k + 1, 0);
+  histogram[k]++;
+}
+
+unsigned CircuitProfiler::peakLiveLabels() {
+  auto& circuit = this->circuit;
+  auto driverCount = circuit.size();
+  auto outputRange = circuit.outputs();
+  // lastReaders[id] is the last gate that reads driver `id`,
+  // or `id` itself if no gate does.
+  std::vector<uint32_t> lastReaders(driverCount);
+  for (unsigned id = 0; id < driverCount; id++)
+    lastReaders[id] = id;
+  auto gateRange = circuit.gates();
+  for (auto id = gateRange.begin; id < gateRange.end; id++) {
+    lastReaders[circuit.inputLeft(id)] = id;
+    lastReaders[circuit.inputRight(id)] = id;
+  }
+  // Labels are dropped when their last reader is evaluated,
+  // before the label of the reader is computed.
+  std::vector<uint32_t> releases(driverCount, 0);
+  for (unsigned id = 0; id < outputRange.begin; id++)
+    if (lastReaders[id] != id)
+      releases[lastReaders[id]]++;
+
+  auto inputLength = circuit.inputs().size();
+  unsigned live = inputLength;
+  unsigned peak = live;
+  for (unsigned id = 0; id < inputLength; id++)
+    if (lastReaders[id] == id)
+      live--;
+  for (auto id = gateRange.begin; id < gateRange.end; id++) {
+    live -= releases[id];
+    live++;
+    peak = std::max(peak, live);
+    bool isOutput = id >= outputRange.begin;
+    if (not isOutput and lastReaders[id] == id)
+      live--;
+  }
+  return peak;
+}
+
+CircuitProfile CircuitProfiler::profile() {
+  auto& circuit = this->circuit;
+  CircuitProfile result;
+  auto inputLength = circuit.inputs().size();
+  assert (this->monitorStateLength <= inputLength);
+  result.monitorStateLength = this->monitorStateLength;
+  result.systemStateLength = inputLength - this->monitorStateLength;
+  result.outputLength = circuit.outputs().size();
+  result.gateCount = circuit.gateCount();
+  for (unsigned t = 0; t < GATE_TYPE_COUNT; t++)
+    result.gateCounts[t] = circuit.gateCount(static_cast<GateType>(t));
+
+  auto levelization = circuit.levelize();
+  result.depth = levelization.depth();
+  result.maxWidth = levelization.maxWidth();
+  result.averageWidth = levelization.averageWidth();
+  for (unsigned k = 1; k <= result.depth; k++)
+    count(result.levelWidths, levelization.width(k));
+
+  // A NOT gate reads its input once, though it is stored twice.
+  std::vector<unsigned> fanouts(circuit.size(), 0);
+  auto gateRange = circuit.gates();
+  for (auto id = gateRange.begin; id < gateRange.end; id++) {
+    auto left = circuit.inputLeft(id), right = circuit.inputRight(id);
+    fanouts[left]++;
+    if (right != left)
+      fanouts[right]++;
+  }
+  for (auto fanout : fanouts) {
+    count(result.fanouts, fanout);
+    result.maxFanout = std::max(result.maxFanout, fanout);
+  }
+
+  result.peakLiveLabels = this->peakLiveLabels();
+  result.labelSlots = circuit.allocateSlots(levelization).slotCount;
+  return result;
+}
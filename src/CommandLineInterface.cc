@@ -3,16 +3,30 @@
 #include <cstdlib>
 #include <string>
 #include "CommandLineInterface.hh"
+#include "CircuitCache.hh"
 
 typedef CommandLineInterface CLI;
 
-CLI::CommandLineInterface(int argc, char* argv[])
-: argc(argc), argv(argv) {}
+CLI::CommandLineInterface(int argc, char* argv[], bool needsSecurity)
+: argc(argc), argv(argv), needsSecurity(needsSecurity) {}
 
 void CLI::usage() {
   printf(
     "Usage: %s -proto p -security k -mslen m -sslen s -ngates n "
-    "[-sys sys_name] [-spec spec_name]\n", argv[0]);
+    "[-sys sys_name] [-spec spec_name] [-threads t] "
+    "[-tables table_file] [-group qr|ec] "
+    "[-garbling classic|permute|halfgates] [-stream g] "
+    "[-wire text|binary] [-cache dir|none]\n", argv[0]);
+  printf(
+    "Plaintext simulation: %s -mslen m -sslen s -spec spec_name "
+    "(-sys sys_name | -sys trace -trace trace_file) "
+    "[-rounds r] [-record trace_file] [-cache dir|none]\n", argv[0]);
+  printf(
+    "Bristol Fashion export: %s -mslen m -sslen s -spec spec_name "
+    "-export circuit_file\n", argv[0]);
+  printf(
+    "Profiling and cost estimates: %s -mslen m -sslen s -spec spec_name "
+    "[-security k] [-group qr|ec] [-cache dir|none]\n", argv[0]);
   exit(EXIT_SUCCESS);
 }
 
@@ -34,16 +48,44 @@ void CLI::parse() {
     exit(EXIT_SUCCESS);
   }
 
-  assert (args.contains("-security"));
+  assert (args.contains("-security") or not needsSecurity);
   assert (args.contains("-mslen"));
   assert (args.contains("-sslen"));
 
-  parameters.securityParameter = std::stoul(args["-security"]);
+  parameters.securityParameter =
+    args.contains("-security") ? std::stoul(args["-security"]) : 0;
   parameters.monitorStateLength = std::stoul(args["-mslen"]);
   parameters.systemStateLength = std::stoul(args["-sslen"]);
   auto protocolStr = args["-proto"];
   parameters.protocol =
     protocolStr == "yao" ? ProtocolType::YAO : ProtocolType::LWY;
+  parameters.group =
+    args["-group"] == "ec" ? GroupType::EC : GroupType::QR;
+  auto garblingStr = args["-garbling"];
+  parameters.garbling =
+    garblingStr == "halfgates" ? GarblingScheme::HALF_GATES :
+    garblingStr == "permute" ? GarblingScheme::POINT_AND_PERMUTE :
+    GarblingScheme::CLASSIC;
+  if (  parameters.garbling == GarblingScheme::HALF_GATES
+    and parameters.protocol != ProtocolType::YAO)
+  {
+    printf("Error: half-gates garbling is only supported by yao\n");
+    exit(EXIT_FAILURE);
+  }
+  parameters.threadCount =
+    args.contains("-threads") ? std::stoul(args["-threads"]) : 1;
+  assert (parameters.threadCount >= 1);
+  parameters.streamChunkSize =
+    args.contains("-stream") ? std::stoul(args["-stream"]) : 0;
+  parameters.wireFormat = args.contains("-wire")
+    ? parseWireFormat(args["-wire"])
+    : WireFormat::TEXT;
+  if (args.contains("-tables"))
+    parameters.tableFileName = args["-tables"];
+  parameters.circuitCacheDirectory =
+    args.contains("-cache") ? args["-cache"] : CircuitCache::DEFAULT_DIRECTORY;
+  if (parameters.circuitCacheDirectory == "none")
+    parameters.circuitCacheDirectory = "";
 
   if (args.contains("-spec"))
     specFileName = args["-spec"];
@@ -84,6 +126,9 @@ void CLI::parse() {
       assert (args.contains("-nlocks"));
       unsigned nLocks = std::stoul(args["-nlocks"]);
       system = std::make_unique<Locks>(nLocks);
+    } else if (sysName == "trace") {
+      assert (args.contains("-trace"));
+      system = std::make_unique<TraceSystem>(args["-trace"]);
     } else {
       printf("Error: invalid system name\n");
       exit(EXIT_FAILURE);
@@ -0,0 +1,164 @@
+#include <array>
+#include <cstdio>
+#include <string>
+#include "CostEstimator.hh"
+#include "BM.hh"
+#include "LWY.hh"
+#include "MathUtils.hh"
+#include "QuadraticResidueGroup.hh"
+
+void CostEstimate::printHeader() {
+  printf("%-16s %12s %12s %10s %10s %10s %10s %12s %10s\n",
+    "protocol", "bytes S->M", "bytes M->S", "exps S", "exps M",
+    "hashes S", "hashes M", "setup bytes", "setup exps");
+}
+
+void CostEstimate::print() {
+  printf("%-16s %12lu %12lu %10lu %10lu %10lu %10lu %12lu %10lu\n",
+    this->protocol.c_str(), this->systemBytes, this->monitorBytes,
+    this->systemExps, this->monitorExps,
+    this->systemHashes, this->monitorHashes,
+    this->setupBytes, this->setupExps);
+}
+
+CostEstimator::CostEstimator(
+  Circuit& circuit, unsigned monitorStateLength,
+  unsigned securityParameter, WireFormat wireFormat)
+  : circuit(circuit),
+    monitorStateLength(monitorStateLength),
+    securityParameter(securityParameter),
+    wireFormat(wireFormat) {}
+
+uint64_t CostEstimator::numberBytes(uint32_t n) {
+  if (this->wireFormat == WireFormat::BINARY)
+    return 4;
+  return std::to_string(n).size() + 1;
+}
+
+uint64_t CostEstimator::labelBytes(unsigned labelLength) {
+  if (this->wireFormat == WireFormat::BINARY)
+    return labelLength;
+  return 2 * labelLength + 1;
+}
+
+uint64_t CostEstimator::elementBytes(unsigned elementHexLength) {
+  // Binary elements are padded; text ones usually take every digit.
+  if (this->wireFormat == WireFormat::BINARY)
+    return (elementHexLength + 1) / 2;
+  return elementHexLength + 1;
+}
+
+uint64_t CostEstimator::garbledGateBytes(
+  YaoGarbler& garbler, unsigned labelLength,
+  GateType type, unsigned rowCount)
+{
+  auto left = garbler.randomLabelPair(labelLength);
+  auto right = type == GateType::NOT
+    ? left
+    : garbler.randomLabelPair(labelLength);
+  auto out = garbler.randomLabelPair(labelLength);
+  auto gate = garbler.enc(left, right, out, 0, type);
+  uint64_t bytes = 0;
+  for (unsigned j = 0; j < rowCount; j++)
+    bytes += this->labelBytes(gate[j].size());
+  return bytes;
+}
+
+void CostEstimator::addTransfers(
+  CostEstimate& estimate,
+  unsigned elementHexLength, unsigned messageHexLength)
+{
+  // The sender sends a constant, then two encryption elements
+  // and two encrypted messages; the chooser sends a public key.
+  uint64_t messageBytes = this->wireFormat == WireFormat::BINARY
+    ? 2 + (messageHexLength + 1) / 2
+    : messageHexLength + 1;
+  uint64_t bytes =
+    4 * this->elementBytes(elementHexLength) + 2 * messageBytes;
+  estimate.setupBytes += this->monitorStateLength * bytes;
+  estimate.setupExps += this->monitorStateLength
+    * (BM::SENDER_EXP_COUNT + BM::CHOOSER_EXP_COUNT);
+}
+
+CostEstimate CostEstimator::estimateYao(
+  YaoGarbler& garbler, const std::string& name)
+{
+  auto& circuit = this->circuit;
+  CostEstimate estimate;
+  estimate.protocol = name;
+  // As in Y::InitMonitorStateLabels, labels are k / 4 bytes.
+  auto labelLength = this->securityParameter >> 2;
+  uint64_t labelBytes = this->labelBytes(labelLength);
+  std::array<uint64_t, GATE_TYPE_COUNT> gateBytes;
+  for (unsigned t = 0; t < GATE_TYPE_COUNT; t++) {
+    auto type = static_cast<GateType>(t);
+    gateBytes[t] = garbledGateBytes(
+      garbler, labelLength, type, garbler.ciphertextCount(type));
+  }
+
+  auto gateRange = circuit.gates();
+  for (auto id = gateRange.begin; id < gateRange.end; id++) {
+    auto type = circuit.gateType(id);
+    estimate.systemBytes += gateBytes[static_cast<unsigned>(type)];
+    estimate.systemHashes += garbler.garblingHashCount(type);
+    estimate.monitorHashes += garbler.evaluationHashCount(type);
+    // Each gate is sent as its inputs, its type and its ID.
+    estimate.setupBytes +=
+      this->numberBytes(circuit.inputLeft(id)) +
+      this->numberBytes(circuit.inputRight(id)) +
+      this->numberBytes(static_cast<uint32_t>(type)) +
+      this->numberBytes(id);
+  }
+  // System input labels and both flag bit digests; then the flag bit.
+  auto systemStateLength =
+    circuit.inputs().size() - this->monitorStateLength;
+  estimate.systemBytes += (systemStateLength + 2) * labelBytes;
+  estimate.monitorBytes += this->numberBytes(0);
+
+  // Yao transfers labels over quadratic residues,
+  // whatever the group of LWY.
+  auto group = QuadraticResidueGroup(getSafePrime(this->securityParameter));
+  this->addTransfers(estimate, group.elementHexLength(), 2 * labelLength);
+  return estimate;
+}
+
+CostEstimate CostEstimator::estimateLwy(
+  PrimeOrderGroup& group, YaoGarbler& garbler, const std::string& name)
+{
+  auto circuit = this->circuit.toNand();
+  CostEstimate estimate;
+  estimate.protocol = name;
+  // Labels are group elements, padded to the same number of hex digits.
+  uint64_t elementHexLength = group.elementHexLength();
+  uint64_t elementBytes = this->elementBytes(elementHexLength);
+  auto labelLength = (elementHexLength + 1) / 2;
+  uint64_t gateCount = circuit.gateCount();
+  uint64_t driverCount = circuit.size();
+  auto systemStateLength =
+    circuit.inputs().size() - this->monitorStateLength;
+
+  // All four rows of every gate are sent.
+  estimate.systemBytes += gateCount * garbledGateBytes(
+    garbler, labelLength, GateType::NAND, 4);
+  estimate.systemBytes += (systemStateLength + 2) * elementBytes;
+  estimate.monitorBytes += this->numberBytes(0);
+  // System input labels and both flag bit labels are raised
+  // to garbling exponents as well.
+  estimate.systemExps =
+    LWY::SYSTEM_EXPS_PER_GATE * gateCount + systemStateLength + 2;
+  estimate.monitorExps = LWY::MONITOR_EXPS_PER_GATE * gateCount;
+  estimate.systemHashes = gateCount * garbler.garblingHashCount();
+  estimate.monitorHashes = gateCount * garbler.evaluationHashCount();
+
+  // Monitor sends a label for every driver but the flag bit,
+  // and both in-wire labels of every gate; monitor state outputs
+  // share the labels of monitor state inputs.
+  estimate.setupBytes += (driverCount - 1 + 2 * gateCount) * elementBytes;
+  estimate.setupExps +=
+    driverCount - this->monitorStateLength - 1 + 2 * gateCount;
+  // System raises each monitor state label to both garbling exponents
+  // before transferring it.
+  estimate.setupExps += 2 * this->monitorStateLength;
+  this->addTransfers(estimate, elementHexLength, elementHexLength);
+  return estimate;
+}
@@ -0,0 +1,184 @@
+#include <cassert>
+#include <vector>
+#include <openssl/bn.h>
+#include <openssl/obj_mac.h>
+#include "EllipticCurveGroup.hh"
+#include "Exceptions.hh"
+
+namespace {
+  struct OpenSSLFree {
+    void operator()(EC_GROUP* group) { EC_GROUP_free(group); }
+    void operator()(EC_POINT* point) { EC_POINT_free(point); }
+    void operator()(BIGNUM* n) { BN_free(n); }
+    void operator()(BN_CTX* context) { BN_CTX_free(context); }
+  };
+  using PointPointer = std::unique_ptr<EC_POINT, OpenSSLFree>;
+  using NumberPointer = std::unique_ptr<BIGNUM, OpenSSLFree>;
+  using ContextPointer = std::unique_ptr<BN_CTX, OpenSSLFree>;
+
+  BigInt fromBytes(const unsigned char* bytes, size_t size) {
+    BigInt result;
+    mpz_import(result.get_mpz_t(), size, 1, 1, 1, 0, bytes);
+    return result;
+  }
+
+  // Big-endian bytes of n, left-padded with zeros to `size` bytes.
+  std::vector<unsigned char> toBytes(const BigInt& n, size_t size) {
+    assert (n >= 0);
+    auto byteCount = (mpz_sizeinbase(n.get_mpz_t(), 2) + 7) / 8;
+    if (byteCount > size)
+      throw InvalidGroupElement();
+    std::vector<unsigned char> bytes(size, 0);
+    if (n != 0)
+      mpz_export(
+        bytes.data() + size - byteCount, nullptr,
+        1, 1, 1, 0, n.get_mpz_t());
+    return bytes;
+  }
+
+  NumberPointer toNumber(const BigInt& n) {
+    auto bytes = toBytes(n, (mpz_sizeinbase(n.get_mpz_t(), 2) + 7) / 8);
+    NumberPointer number(BN_bin2bn(bytes.data(), bytes.size(), nullptr));
+    if (not number)
+      throw EllipticCurveError();
+    return number;
+  }
+
+  BigInt fromNumber(const BIGNUM* n) {
+    std::vector<unsigned char> bytes(BN_num_bytes(n));
+    BN_bn2bin(n, bytes.data());
+    return fromBytes(bytes.data(), bytes.size());
+  }
+
+  BigInt encodePoint(const EC_GROUP* curve, const EC_POINT* point) {
+    if (EC_POINT_is_at_infinity(curve, point))
+      return BigInt(0);
+    unsigned char bytes[1 + 66];
+    auto size = EC_POINT_point2oct(
+      curve, point, POINT_CONVERSION_COMPRESSED,
+      bytes, sizeof(bytes), nullptr);
+    if (size == 0)
+      throw EllipticCurveError();
+    return fromBytes(bytes, size);
+  }
+
+  std::shared_ptr<EC_GROUP> newCurve(int curveId) {
+    auto curve = EC_GROUP_new_by_curve_name(curveId);
+    if (curve == nullptr)
+      throw EllipticCurveError();
+    return std::shared_ptr<EC_GROUP>(curve, OpenSSLFree());
+  }
+}
+
+EllipticCurveGroup::EllipticCurveGroup(int curveId)
+  : EllipticCurveGroup(newCurve(curveId)) {}
+
+EllipticCurveGroup::EllipticCurveGroup(std::shared_ptr<EC_GROUP> curve)
+  : PrimeOrderGroup(
+      encodePoint(curve.get(), EC_GROUP_get0_generator(curve.get()))),
+    curve(curve),
+    curveOrder(fromNumber(EC_GROUP_get0_order(curve.get()))),
+    encodedSize(1 + (EC_GROUP_get_degree(curve.get()) + 7) / 8) {}
+
+int EllipticCurveGroup::curveFor(unsigned securityParameter) {
+  // Equivalent strengths as recommended by NIST SP 800-57.
+  if (securityParameter <= 3072)
+    return NID_X9_62_prime256v1;
+  if (securityParameter <= 7680)
+    return NID_secp384r1;
+  return NID_secp521r1;
+}
+
+EC_POINT* EllipticCurveGroup::decode(const BigInt& a) {
+  auto curve = this->curve.get();
+  PointPointer point(EC_POINT_new(curve));
+  if (not point)
+    throw EllipticCurveError();
+  if (a == 0) {
+    EC_POINT_set_to_infinity(curve, point.get());
+    return point.release();
+  }
+  auto bytes = toBytes(a, this->encodedSize);
+  if (not EC_POINT_oct2point(
+        curve, point.get(), bytes.data(), bytes.size(), nullptr))
+    throw InvalidGroupElement();
+  return point.release();
+}
+
+BigInt EllipticCurveGroup::encode(const EC_POINT* point) {
+  return encodePoint(this->curve.get(), point);
+}
+
+BigInt EllipticCurveGroup::mul(const BigInt& a, const BigInt& b) {
+  auto curve = this->curve.get();
+  PointPointer pointA(this->decode(a));
+  PointPointer pointB(this->decode(b));
+  PointPointer sum(EC_POINT_new(curve));
+  if (not sum
+    or not EC_POINT_add(curve, sum.get(), pointA.get(), pointB.get(), nullptr))
+    throw EllipticCurveError();
+  return this->encode(sum.get());
+}
+
+BigInt EllipticCurveGroup::exp(const BigInt& a, const BigInt& n) {
+  auto curve = this->curve.get();
+  PointPointer point(this->decode(a));
+  BigInt reduced = n % this->curveOrder;
+  if (reduced < 0)
+    reduced += this->curveOrder;
+  auto scalar = toNumber(reduced);
+  ContextPointer context(BN_CTX_new());
+  PointPointer product(EC_POINT_new(curve));
+  if (not context or not product
+    or not EC_POINT_mul(
+      curve, product.get(), nullptr, point.get(), scalar.get(),
+      context.get()))
+    throw EllipticCurveError();
+  return this->encode(product.get());
+}
+
+BigInt EllipticCurveGroup::expFixedBase(const BigInt& base, const BigInt& n) {
+  if (base != this->baseGenerator)
+    return this->exp(base, n);
+  auto curve = this->curve.get();
+  BigInt reduced = n % this->curveOrder;
+  if (reduced < 0)
+    reduced += this->curveOrder;
+  auto scalar = toNumber(reduced);
+  ContextPointer context(BN_CTX_new());
+  PointPointer product(EC_POINT_new(curve));
+  if (not context or not product
+    or not EC_POINT_mul(
+      curve, product.get(), scalar.get(), nullptr, nullptr, context.get()))
+    throw EllipticCurveError();
+  return this->encode(product.get());
+}
+
+BigInt EllipticCurveGroup::inv(const BigInt& a) {
+  auto curve = this->curve.get();
+  PointPointer point(this->decode(a));
+  if (not EC_POINT_invert(curve, point.get(), nullptr))
+    throw EllipticCurveError();
+  return this->encode(point.get());
+}
+
+BigInt EllipticCurveGroup::randomExponent() {
+  auto order = toNumber(this->curveOrder);
+  NumberPointer exponent(BN_new());
+  if (not exponent)
+    throw EllipticCurveError();
+  // Exponent must be in {1, ..., order - 1}.
+  do {
+    if (not BN_rand_range(exponent.get(), order.get()))
+      throw EllipticCurveError();
+  } while (BN_is_zero(exponent.get()));
+  return fromNumber(exponent.get());
+}
+
+unsigned EllipticCurveGroup::elementHexLength() {
+  return 2 * this->encodedSize;
+}
+
+BigInt EllipticCurveGroup::order() {
+  return this->curveOrder;
+}
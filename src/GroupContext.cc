@@ -0,0 +1,78 @@
+#include <cassert>
+#include "GroupContext.hh"
+
+GroupContext::GroupContext(BigInt p)
+  : primeModulus(p), smallPrime((p - 1) / 2)
+{
+  assert (p > 2 and mpz_odd_p(p.get_mpz_t()));
+  this->limbs = mpz_size(p.get_mpz_t());
+  auto pLimbs = mpz_limbs_read(p.get_mpz_t());
+  this->modulusLimbs.assign(pLimbs, pLimbs + this->limbs);
+  // Newton iteration for p^(-1) mod 2^64;
+  // each step doubles the number of correct low bits.
+  mp_limb_t inverse = 1;
+  for (unsigned bits = 1; bits < GMP_NUMB_BITS; bits *= 2)
+    inverse *= 2 - this->modulusLimbs[0] * inverse;
+  this->negativeInverse = -inverse;
+}
+
+size_t GroupContext::limbCount() const {
+  return this->limbs;
+}
+
+MontgomeryElement GroupContext::toMontgomery(const BigInt& a) const {
+  BigInt shifted;
+  mpz_mod(shifted.get_mpz_t(), a.get_mpz_t(), this->primeModulus.get_mpz_t());
+  mpz_mul_2exp(
+    shifted.get_mpz_t(), shifted.get_mpz_t(), GMP_NUMB_BITS * this->limbs);
+  mpz_mod(
+    shifted.get_mpz_t(), shifted.get_mpz_t(), this->primeModulus.get_mpz_t());
+  MontgomeryElement result(this->limbs, 0);
+  auto size = mpz_size(shifted.get_mpz_t());
+  auto limbs = mpz_limbs_read(shifted.get_mpz_t());
+  std::copy(limbs, limbs + size, result.begin());
+  return result;
+}
+
+BigInt GroupContext::fromMontgomery(const MontgomeryElement& a) const {
+  assert (a.size() == this->limbs);
+  // a * 1 * R^(-1) = the canonical form of a.
+  MontgomeryElement unit(this->limbs, 0);
+  unit[0] = 1;
+  MontgomeryElement canonical(this->limbs);
+  std::vector<mp_limb_t> scratch(2 * this->limbs);
+  this->mul(canonical.data(), a.data(), unit.data(), scratch.data());
+  BigInt result;
+  auto limbs = mpz_limbs_write(result.get_mpz_t(), this->limbs);
+  std::copy(canonical.begin(), canonical.end(), limbs);
+  mpz_limbs_finish(result.get_mpz_t(), this->limbs);
+  return result;
+}
+
+MontgomeryElement GroupContext::one() const {
+  return this->toMontgomery(BigInt(1));
+}
+
+void GroupContext::mul(
+  mp_limb_t* rop, const mp_limb_t* a, const mp_limb_t* b,
+  mp_limb_t* scratch) const
+{
+  auto n = this->limbs;
+  auto p = this->modulusLimbs.data();
+  if (a == b)
+    mpn_sqr(scratch, a, n);
+  else
+    mpn_mul_n(scratch, a, b, n);
+  // REDC, one limb at a time: adding m * p clears the lowest limb,
+  // and leaves the product divided by R in the upper half.
+  mp_limb_t carry = 0;
+  for (size_t i = 0; i < n; i++) {
+    mp_limb_t m = scratch[i] * this->negativeInverse;
+    auto c = mpn_addmul_1(scratch + i, p, n, m);
+    carry += mpn_add_1(scratch + i + n, scratch + i + n, n - i, c);
+  }
+  if (carry or mpn_cmp(scratch + n, p, n) >= 0)
+    mpn_sub_n(rop, scratch + n, p, n);
+  else
+    mpn_copyi(rop, scratch + n, n);
+}
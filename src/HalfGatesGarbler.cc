@@ -0,0 +1,159 @@
+#include <cassert>
+#include "HalfGatesGarbler.hh"
+#include "MathUtils.hh"
+#include "Exceptions.hh"
+
+HalfGatesGarbler::HalfGatesGarbler(unsigned labelLength) {
+  assert (labelLength > 0);
+  this->offset = Label::random(labelLength);
+  // The permute bits of the two labels of a wire must differ.
+  this->offset.setLsb(1);
+}
+
+Label HalfGatesGarbler::hash(
+  const Label& label, uint64_t tweak, uint8_t half)
+{
+  Label h(label.size());
+  hashShake256(
+    { { label.data(), label.size() },
+      { &tweak, sizeof(tweak) },
+      { &half, sizeof(half) } },
+    h.data(), h.size());
+  return h;
+}
+
+Label HalfGatesGarbler::garbleAnd(
+  const LabelPair& left,
+  const LabelPair& right,
+  uint64_t tweak,
+  GarbledGate& gate)
+{
+  auto& R = this->offset;
+  // Both halves of a gate hash with their own tweak.
+  const uint8_t halfG = 0, halfE = 1;
+  auto pa = left[0].lsb(), pb = right[0].lsb();
+
+  // Generator half gate: the garbler knows the right input's
+  // permute bit `pb`, and garbles a ^ pb using the left labels.
+  auto hashA0 = hash(left[0], tweak, halfG);
+  auto tableG = hashA0 ^ hash(left[1], tweak, halfG);
+  if (pb)
+    tableG ^= R;
+  auto outG = pa ? hashA0 ^ tableG : hashA0;
+
+  // Evaluator half gate: the evaluator knows b ^ pb
+  // (the permute bit of its right label), and garbles a & (b ^ pb).
+  auto hashB0 = hash(right[0], tweak, halfE);
+  auto tableE = hashB0 ^ hash(right[1], tweak, halfE) ^ left[0];
+  auto outE = pb ? hashB0 ^ tableE ^ left[0] : hashB0;
+
+  gate[0] = std::move(tableG);
+  gate[1] = std::move(tableE);
+  // outG ^ outE is the 0-label of a & b.
+  return outG ^ outE;
+}
+
+GarbledGate HalfGatesGarbler::enc(
+  const LabelPair& left,
+  const LabelPair& right,
+  LabelPair& out,
+  uint64_t tweak,
+  GateType type)
+{
+  auto& R = this->offset;
+  if (left[0].size() != R.size() or right[0].size() != R.size())
+    throw InvalidLabels();
+  GarbledGate gate;
+  switch (type) {
+    case GateType::XOR:
+    case GateType::XNOR: {
+      auto xorZero = left[0] ^ right[0];
+      auto xorOne = xorZero ^ R;
+      if (type == GateType::XOR)
+        out = { std::move(xorZero), std::move(xorOne) };
+      else
+        out = { std::move(xorOne), std::move(xorZero) };
+      break;
+    } case GateType::NOT:
+      out = { left[1], left[0] };
+      break;
+    case GateType::AND:
+    case GateType::NAND: {
+      auto andZero = this->garbleAnd(left, right, tweak, gate);
+      if (type == GateType::AND)
+        out = { andZero, andZero ^ R };
+      else
+        out = { andZero ^ R, andZero };
+      break;
+    } case GateType::OR: {
+      // a | b = ~(~a & ~b)
+      auto andZero = this->garbleAnd(
+        { left[1], left[0] }, { right[1], right[0] }, tweak, gate);
+      out = { andZero ^ R, andZero };
+      break;
+    }
+  }
+  return gate;
+}
+
+Label HalfGatesGarbler::dec(
+  const Label& left,
+  const Label& right,
+  const GarbledGate& gate,
+  uint64_t tweak,
+  GateType type)
+{
+  switch (type) {
+    case GateType::XOR:
+    case GateType::XNOR:
+      return left ^ right;
+    case GateType::NOT:
+      return left;
+    default:
+      break;
+  }
+  auto& tableG = gate[0];
+  auto& tableE = gate[1];
+  if (left.size() != tableG.size() or right.size() != tableE.size())
+    throw InvalidCipher();
+  const uint8_t halfG = 0, halfE = 1;
+  auto outG = hash(left, tweak, halfG);
+  if (left.lsb())
+    outG ^= tableG;
+  auto outE = hash(right, tweak, halfE);
+  if (right.lsb())
+    outE ^= tableE ^ left;
+  outG ^= outE;
+  return outG;
+}
+
+unsigned HalfGatesGarbler::ciphertextCount(GateType type) {
+  switch (type) {
+    case GateType::XOR:
+    case GateType::XNOR:
+    case GateType::NOT:
+      return 0;
+    default:
+      return 2;
+  }
+}
+
+// Each half gate hashes both labels of its input when garbled,
+// and one of them when evaluated.
+unsigned HalfGatesGarbler::garblingHashCount(GateType type) {
+  return this->ciphertextCount(type) == 0 ? 0 : 4;
+}
+
+unsigned HalfGatesGarbler::evaluationHashCount(GateType type) {
+  return this->ciphertextCount(type) == 0 ? 0 : 2;
+}
+
+bool HalfGatesGarbler::derivesOutputLabels() {
+  return true;
+}
+
+LabelPair HalfGatesGarbler::randomLabelPair(unsigned length) {
+  assert (length == this->offset.size());
+  auto zero = Label::random(length);
+  return { zero, zero ^ this->offset };
+}
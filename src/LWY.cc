@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 #include "LWY.hh"
@@ -10,6 +11,21 @@ unsigned P::ParameterSet::inputLength() {
   return this->monitorStateLength + this->systemStateLength;
 }
 
+unsigned P::ParameterSet::chunkCount() {
+  auto size = this->streamChunkSize;
+  if (size == 0 or this->gateCount == 0)
+    return 1;
+  return (this->gateCount + size - 1) / size;
+}
+
+DriverRange P::ParameterSet::chunk(unsigned k) {
+  if (this->streamChunkSize == 0)
+    return { 0, this->gateCount };
+  auto begin = std::min(k * this->streamChunkSize, this->gateCount);
+  auto end = std::min(begin + this->streamChunkSize, this->gateCount);
+  return { begin, end };
+}
+
 P::SystemState::SystemState(ParameterSet* parameters, SystemMemory* memory)
   : parameters(parameters), memory(memory) {}
 
@@ -94,17 +110,23 @@ void P::RecvLabels::parseLabels() {
   // Message is formatted as follows:
   // DriverLabel1 ... DriverLabelN InWireLabel1 ... InWireLabelM
   // (N = driverCount - 1, M = 2 * gateCount).
-  auto& message = this->memory->receivedMessage;
-  std::tie(this->memory->driverLabels, message) =
-    readBigInts(message, P::MSG_NUM_BASE, driverCount - 1);
-  std::tie(this->memory->inWireLabels, message) =
-    readBigInts(message, P::MSG_NUM_BASE, 2 * gateCount);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  auto elementByteLength = this->parameters->group->elementByteLength();
+  auto& driverLabels = this->memory->driverLabels;
+  auto& inWireLabels = this->memory->inWireLabels;
+  driverLabels.reserve(driverCount);
+  for (unsigned i = 0; i < driverCount - 1; i++)
+    driverLabels.push_back(reader.element(elementByteLength));
+  inWireLabels.reserve(2 * gateCount);
+  for (unsigned i = 0; i < 2 * gateCount; i++)
+    inWireLabels.push_back(reader.element(elementByteLength));
   assert (this->memory->driverLabels.size() == driverCount - 1);
   assert (this->memory->inWireLabels.size() == 2 * gateCount);
 }
 
 void P::RecvLabels::generateFlagBitLabel() {
-  auto flagBitLabel = this->parameters->group.randomGenerator();
+  auto flagBitLabel = this->parameters->group->randomGenerator();
   this->memory->driverLabels.push_back(flagBitLabel);
 }
 
@@ -133,7 +155,7 @@ StatePtr P::RecvLabels::next() {
 void P::GenerateGarbledGates::generateGarblingExponents() {
   auto& exponents = this->memory->garblingExponents;
   auto& nextRoundExponents = this->memory->nextRoundGarblingExponents;
-  auto& group = this->parameters->group;
+  auto& group = *this->parameters->group;
   if (this->memory->isFirstRound) {
     exponents[0] = group.randomExponent();
     exponents[1] = group.randomExponent();
@@ -146,71 +168,83 @@ void P::GenerateGarbledGates::generateGarblingExponents() {
   }
 }
 
-std::array<BigInt, 2> P::GenerateGarbledGates::expLabel(
-  BigInt label, std::array<BigInt, 2> exponents)
-{
-  auto group = this->parameters->group;
-  return {
-    group.exp(label, exponents[0]),
-    group.exp(label, exponents[1])
-  };
-}
-
 std::string P::GenerateGarbledGates::padLabel(BigInt label) {
   auto labelStr = toString(label, P::MSG_NUM_BASE);
-  auto targetLength = this->parameters->securityParameter / 4;
+  auto targetLength = this->parameters->group->elementHexLength();
   return std::string(targetLength - labelStr.size(), '0') + labelStr;
 }
 
-void P::GenerateGarbledGates::garble() {
-  auto group = this->parameters->group;
+void P::GenerateGarbledGates::garble(DriverRange gates) {
+  auto& group = *this->parameters->group;
   auto garbler = this->parameters->garbler;
+  auto pool = this->parameters->threadPool;
+  // Output labels are group elements, fixed before garbling.
+  assert (not garbler->derivesOutputLabels());
 
-  auto exponents = this->memory->garblingExponents;
+  auto& exponents = this->memory->garblingExponents;
+  auto& nextRoundExponents = this->memory->nextRoundGarblingExponents;
   auto& inWireLabels = this->memory->inWireLabels;
   auto& driverLabels = this->memory->driverLabels;
 
   auto& garbledGates = this->memory->garbledGates;
-  auto gateCount = this->parameters->gateCount;
+  auto gateCount = gates.size();
   auto offset =
     this->parameters->monitorStateLength
     + this->parameters->systemStateLength;
   garbledGates.resize(gateCount);
   auto outputLength = this->parameters->monitorStateLength + 1;
+
+  // All exponentiations of the chunk are independent,
+  // and every label is raised to both exponents of a pair;
+  // so, they are done together, in two batches (one for each pair).
   // For all output gates (including the one for the flag bit),
   // exponents picked for the next round are used.
-  for (unsigned i = 0; i < gateCount; i++) {
-    if (i % 10000 == 0 and i > 0) {
-      printf("D:   garbling gate %d\n", i);
-      fflush(stdout);
-    }
-    auto leftLabels = this->expLabel(
-      inWireLabels[2 * i], this->memory->garblingExponents);
-    auto rightLabels = this->expLabel(
-      inWireLabels[2 * i + 1], this->memory->garblingExponents);
-    auto outExponents = (i < gateCount - outputLength)
-      ? this->memory->garblingExponents
-      : this->memory->nextRoundGarblingExponents;
-    auto outLabels = this->expLabel(driverLabels[offset + i], outExponents);
-    // printf("D:   shuffled gate %d\n", i);
-    // printf("D:     left labels:  { %s, %s }\n",
-    //   this->padLabel(leftLabels[0]).c_str(),
-    //   this->padLabel(leftLabels[1]).c_str());
-    // printf("D:     right labels: { %s, %s }\n",
-    //   this->padLabel(rightLabels[0]).c_str(),
-    //   this->padLabel(rightLabels[1]).c_str());
-    // printf("D:     out labels:   { %s, %s }\n",
-    //   this->padLabel(outLabels[0]).c_str(),
-    //   this->padLabel(outLabels[1]).c_str());
-    garbledGates[i] = garbler->enc(
-      { this->padLabel(leftLabels[0]),
-        this->padLabel(leftLabels[1]) },
-      { this->padLabel(rightLabels[0]),
-        this->padLabel(rightLabels[1]) },
-      { this->padLabel(outLabels[0]),
-        this->padLabel(outLabels[1]) }
-    );
-  }
+  auto internalCount = this->parameters->gateCount - outputLength;
+  auto outputBegin = std::max(gates.begin, internalCount);
+  std::vector<const BigInt*> bases, nextRoundBases;
+  bases.reserve(3 * gateCount);
+  for (auto i = 2 * gates.begin; i < 2 * gates.end; i++)
+    bases.push_back(&inWireLabels[i]);
+  for (auto i = gates.begin; i < gates.end; i++)
+    (i < internalCount ? bases : nextRoundBases)
+      .push_back(&driverLabels[offset + i]);
+  assert (2 * (bases.size() + nextRoundBases.size())
+    == P::SYSTEM_EXPS_PER_GATE * gateCount);
+  auto powers = group.expPairBatch(bases, exponents, pool);
+  auto nextRoundPowers =
+    group.expPairBatch(nextRoundBases, nextRoundExponents, pool);
+
+  parallelFor(
+    pool, 0, gateCount, P::GARBLING_CHUNK_SIZE,
+    [&] (size_t begin, size_t end) {
+      for (auto i = begin; i < end; i++) {
+        auto& leftLabels = powers[2 * i];
+        auto& rightLabels = powers[2 * i + 1];
+        auto& outLabels = (gates.begin + i < internalCount)
+          ? powers[2 * gateCount + i]
+          : nextRoundPowers[gates.begin + i - outputBegin];
+        // printf("D:   shuffled gate %d\n", i);
+        // printf("D:     left labels:  { %s, %s }\n",
+        //   this->padLabel(leftLabels[0]).c_str(),
+        //   this->padLabel(leftLabels[1]).c_str());
+        // printf("D:     right labels: { %s, %s }\n",
+        //   this->padLabel(rightLabels[0]).c_str(),
+        //   this->padLabel(rightLabels[1]).c_str());
+        // printf("D:     out labels:   { %s, %s }\n",
+        //   this->padLabel(outLabels[0]).c_str(),
+        //   this->padLabel(outLabels[1]).c_str());
+        LabelPair paddedOutLabels = {
+          Label::fromHex(this->padLabel(outLabels[0])),
+          Label::fromHex(this->padLabel(outLabels[1])) };
+        garbledGates[i] = garbler->enc(
+          { Label::fromHex(this->padLabel(leftLabels[0])),
+            Label::fromHex(this->padLabel(leftLabels[1])) },
+          { Label::fromHex(this->padLabel(rightLabels[0])),
+            Label::fromHex(this->padLabel(rightLabels[1])) },
+          paddedOutLabels
+        );
+      }
+    });
 }
 
 StatePtr P::GenerateGarbledGates::next() {
@@ -224,29 +258,60 @@ StatePtr P::GenerateGarbledGates::next() {
   timer.reset();
   timer.start();
   this->generateGarblingExponents();
-  this->garble();
-  memory->garbledGates.resize(this->parameters->gateCount);
+  // Chunks are garbled while input labels and earlier chunks are sent.
+  this->garbleChunkInBackground(0);
   // A pause is required to exclude message passing time.
   timer.pause();
-  return std::make_unique<P::SendGarbledGates>(this->parameters, this->memory);
+  return std::make_unique<P::SendSystemInputLabels>(
+    this->parameters, this->memory);
+}
+
+std::string P::GenerateGarbledGates::garbleChunk(unsigned k) {
+  this->garble(this->parameters->chunk(k));
+  MessageWriter writer(this->parameters->wireFormat);
+  for (auto& gate : this->memory->garbledGates)
+    for (unsigned j = 0; j < gate.size(); j++)
+      writer.label(gate[j], j);
+  return writer.take();
+}
+
+void P::GenerateGarbledGates::garbleChunkInBackground(unsigned k) {
+  auto memory = this->memory;
+  memory->nextGarbledChunk = std::async(std::launch::async,
+    [generator = *this, memory, k] () mutable {
+      Timer timer;
+      timer.start();
+      auto message = generator.garbleChunk(k);
+      memory->nextGarblingTime = timer.display();
+      return message;
+    });
 }
 
+P::SendGarbledGates::SendGarbledGates(
+  ParameterSet* parameters, SystemMemory* memory, unsigned chunk)
+  : SystemState(parameters, memory), chunk(chunk) {}
+
 bool P::SendGarbledGates::isSend() {
   return true;
 }
 
 std::string P::SendGarbledGates::message() {
-  std::stringstream ss;
-  for (auto& gate : this->memory->garbledGates)
-    for (auto& label : gate)
-      ss << label << ' ';
-  return ss.str();
+  auto memory = this->memory;
+  auto message = memory->nextGarbledChunk.get();
+  // The timer does not see the thread that garbled the chunk.
+  memory->timer.add(memory->nextGarblingTime);
+  auto k = this->chunk + 1;
+  if (k < this->parameters->chunkCount())
+    GenerateGarbledGates(this->parameters, memory).garbleChunkInBackground(k);
+  return message;
 }
 
 StatePtr P::SendGarbledGates::next() {
   printf("I: SendGarbledGates::next\n");
-  return std::make_unique<P::SendSystemInputLabels>(
-    this->parameters, this->memory);
+  if (this->chunk + 1 < this->parameters->chunkCount())
+    return std::make_unique<P::SendGarbledGates>(
+      this->parameters, this->memory, this->chunk + 1);
+  return std::make_unique<P::RecvFlagBit>(this->parameters, this->memory);
 }
 
 bool P::SendSystemInputLabels::isSend() {
@@ -269,7 +334,7 @@ std::vector<BigInt> P::SendSystemInputLabels::systemInputLabels_Timed() {
   assert (systemData.size() == this->parameters->systemStateLength);
   labels.resize(systemData.size());
   auto offset = this->parameters->monitorStateLength;
-  auto group = this->parameters->group;
+  auto& group = *this->parameters->group;
   for (unsigned i = 0; i < systemData.size(); i++) {
     auto exponent = this->memory->garblingExponents[ systemData[i] ];
     auto driverLabel = this->memory->driverLabels[offset + i];
@@ -282,10 +347,11 @@ std::vector<BigInt> P::SendSystemInputLabels::systemInputLabels_Timed() {
 }
 
 std::string P::SendSystemInputLabels::message() {
-  std::stringstream ss;
+  MessageWriter writer(this->parameters->wireFormat);
+  auto elementByteLength = this->parameters->group->elementByteLength();
   for (auto& label : this->systemInputLabels_Timed())
-    ss << toString(label, P::MSG_NUM_BASE) << ' ';
-  return ss.str();
+    writer.element(label, elementByteLength);
+  return writer.take();
 }
 
 StatePtr P::SendSystemInputLabels::next() {
@@ -300,7 +366,7 @@ bool P::SendFlagBitLabels::isSend() {
 
 std::array<BigInt, 2> P::SendFlagBitLabels::flagBitLabels_Timed() {
   auto& timer = this->memory->timer;
-  auto& group = this->parameters->group;
+  auto& group = *this->parameters->group;
   auto& driverLabels = this->memory->driverLabels;
   auto flagBitLabel = driverLabels.back();
   // For all output gates (including the one for the flag bit),
@@ -316,9 +382,11 @@ std::array<BigInt, 2> P::SendFlagBitLabels::flagBitLabels_Timed() {
 }
 
 std::string P::SendFlagBitLabels::message() {
-  auto labels = this->flagBitLabels_Timed();
-  return toString(labels[0], P::MSG_NUM_BASE) + ' '
-    + toString(labels[1], P::MSG_NUM_BASE);
+  MessageWriter writer(this->parameters->wireFormat);
+  auto elementByteLength = this->parameters->group->elementByteLength();
+  for (auto& label : this->flagBitLabels_Timed())
+    writer.element(label, elementByteLength);
+  return writer.take();
 }
 
 StatePtr P::SendFlagBitLabels::next() {
@@ -328,7 +396,8 @@ StatePtr P::SendFlagBitLabels::next() {
     return std::make_unique<P::SystemObliviousTransfer>
       (this->parameters, this->memory);
   }
-  return std::make_unique<P::RecvFlagBit> (this->parameters, this->memory);
+  return std::make_unique<P::SendGarbledGates>(
+    this->parameters, this->memory, 0);
 }
 
 P::SystemObliviousTransfer::SystemObliviousTransfer(
@@ -339,7 +408,8 @@ P::SystemObliviousTransfer::SystemObliviousTransfer(
   this->OTParameters = std::make_unique<BM::ParameterSet>(
     BM::ParameterSet {
       .securityParameter= this->parameters->securityParameter,
-      .group = this->parameters->group
+      .group = this->parameters->group,
+      .wireFormat = this->parameters->wireFormat
     }
   );
   this->senderMemory = std::make_unique<BM::SenderMemory>();
@@ -353,7 +423,7 @@ void P::SystemObliviousTransfer::setOTMessages_Timed() {
   timer.resume();
   auto& memory = this->memory;
   auto& senderMemory = this->senderMemory;
-  auto& group = this->OTParameters->group;
+  auto& group = *this->OTParameters->group;
   for (unsigned i = 0; i < 2; i++)
     senderMemory->messages[i] = toString(
       group.exp(
@@ -383,7 +453,8 @@ StatePtr P::SystemObliviousTransfer::next() {
   printf("I: SystemObliviousTransfer::next\n");
   fflush(stdout);
   if (this->counter == this->parameters->monitorStateLength)
-    return std::make_unique<P::RecvFlagBit>(this->parameters, this->memory);
+    return std::make_unique<P::SendGarbledGates>(
+      this->parameters, this->memory, 0);
 
   if (not this->state) {
     this->counter++;
@@ -406,8 +477,9 @@ bool P::RecvFlagBit::isRecv() {
 
 StatePtr P::RecvFlagBit::next() {
   printf("I: RecvFlagBit::next\n");
-  auto& message = this->memory->receivedMessage;
-  bool flagBit = std::stoi(message);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  bool flagBit = reader.number();
   auto& timer = this->memory->timer;
   printf("D: ==== round duration: %f ms ====\n", timer.display());
   fflush(stdout);
@@ -446,7 +518,7 @@ StatePtr P::GenerateDriverLabels::next() {
   fflush(stdout);
   auto& timer = this->memory->timer;
   timer.start();
-  auto& group = this->parameters->group;
+  auto& group = *this->parameters->group;
   auto& driverLabels = this->memory->driverLabels;
   Circuit* circuit = this->memory->circuit;
   unsigned driverCount = circuit->size();
@@ -454,13 +526,23 @@ StatePtr P::GenerateDriverLabels::next() {
   driverLabels.resize(driverCount - 1);
   // Input and output monitor states receive the same labels.
   // First, all but the last (monitorStateLength) drivers are labelled.
-  for (unsigned i = 0; i < driverCount - monitorStateLength - 1; i++)
-    driverLabels[i] = group.randomGenerator();
+  // Each label is a random generator, i.e., a random power of
+  // the base generator; the powers are computed as a single batch.
+  auto labelCount = driverCount - monitorStateLength - 1;
+  std::vector<BigInt> exponents(labelCount);
+  std::vector<ExpJob> jobs(labelCount);
+  for (unsigned i = 0; i < labelCount; i++) {
+    exponents[i] = group.randomExponent();
+    jobs[i] = { &group.baseGenerator, &exponents[i] };
+  }
+  auto labels = group.expBatch(jobs, this->parameters->threadPool);
+  std::move(labels.begin(), labels.end(), driverLabels.begin());
   auto offset = driverCount - monitorStateLength - 1;
   for (unsigned i = 0; i < monitorStateLength; i++)
     driverLabels[offset + i] = driverLabels[i];
   timer.pause();
-  printf("D:   driver labels generated in %f ms\n", timer.display());
+  printf("D:   driver labels generated in %f ms (%.0f exp/s)\n",
+    timer.display(), labelCount / (timer.display() / 1000));
   fflush(stdout);
   return std::make_unique<P::GenerateInWireKeys>(
     this->parameters, this->memory);
@@ -474,7 +556,7 @@ StatePtr P::GenerateInWireKeys::next() {
   auto inWireCount = 2 * this->parameters->gateCount;
   this->memory->inWireKeys.resize(inWireCount);
   for (unsigned i = 0; i < inWireCount; i++)
-    this->memory->inWireKeys[i] = this->parameters->group.randomExponent();
+    this->memory->inWireKeys[i] = this->parameters->group->randomExponent();
   timer.pause();
   printf("D:   in-wire keys generated in %f ms\n", timer.display());
   return std::make_unique<P::SendLabels>(
@@ -495,40 +577,37 @@ std::vector<BigInt> P::SendLabels::generateInWireLabels_Timed() {
   timer.reset();
   timer.start();
 
-  std::vector<BigInt> inWireLabels;
   unsigned gateCount = this->parameters->gateCount;
-  inWireLabels.resize(2 * gateCount);
-  auto drivers = this->memory->circuit->get();
+  auto circuit = this->memory->circuit;
   auto offset = this->parameters->inputLength();
   // For gate G, ingoing wires are labelled as follows:
   // Left: (Driver label of G.leftInput) ^ (Key of G.leftInput)
   // Right: Same, but for G.rightInput.
   printf("D:   generating in-wire labels for %u gates\n", gateCount);
+  std::vector<ExpJob> jobs(2 * gateCount);
   for (unsigned i = 0; i < gateCount; i++) {
-    if (i % 10000 == 0 and i > 0) {
-      printf("D:   %u gates processed\n", i);
-      fflush(stdout);
-    }
-    auto gate = static_cast<Gate*>(drivers[offset + i]);
-    assert (gate != nullptr);
+    auto inputLeft = circuit->inputLeft(offset + i);
+    auto inputRight = circuit->inputRight(offset + i);
     auto indexLeft = 2 * i;
     auto indexRight = 2 * i + 1;
 
-    testIdx(this->memory->driverLabels, gate->inputLeft);
-    testIdx(this->memory->driverLabels, gate->inputRight);
+    testIdx(this->memory->driverLabels, inputLeft);
+    testIdx(this->memory->driverLabels, inputRight);
     testIdx(this->memory->inWireKeys, indexLeft);
     testIdx(this->memory->inWireKeys, indexRight);
 
-    inWireLabels[indexLeft] = this->parameters->group.exp(
-      this->memory->driverLabels[gate->inputLeft],
-      this->memory->inWireKeys[indexLeft]);
-
-    inWireLabels[indexRight] = this->parameters->group.exp(
-      this->memory->driverLabels[gate->inputRight],
-      this->memory->inWireKeys[indexRight]);
+    jobs[indexLeft] = {
+      &this->memory->driverLabels[inputLeft],
+      &this->memory->inWireKeys[indexLeft] };
+    jobs[indexRight] = {
+      &this->memory->driverLabels[inputRight],
+      &this->memory->inWireKeys[indexRight] };
   }
+  auto inWireLabels =
+    this->parameters->group->expBatch(jobs, this->parameters->threadPool);
   timer.pause();
-  printf("D:   in-wire labels generated in %f ms\n", timer.display());
+  printf("D:   in-wire labels generated in %f ms (%.0f exp/s)\n",
+    timer.display(), jobs.size() / (timer.display() / 1000));
   fflush(stdout);
   return inWireLabels;
 }
@@ -536,7 +615,8 @@ std::vector<BigInt> P::SendLabels::generateInWireLabels_Timed() {
 void P::SendLabels::shuffleCircuit_Timed() {
   auto& timer = this->memory->timer;
   timer.resume();
-  this->memory->shuffledCircuit = this->memory->circuit->shuffle();
+  this->memory->shuffledCircuit =
+    this->memory->circuit->shuffle(this->parameters->streamChunkSize);
   timer.pause();
 }
 
@@ -545,35 +625,40 @@ std::string P::SendLabels::message() {
   auto inWireLabels = this->generateInWireLabels_Timed();
   // printf("D:   in-wire labels generated\n");
   this->shuffleCircuit_Timed();
-  std::stringstream ss;
+  MessageWriter writer(this->parameters->wireFormat);
+  auto elementByteLength = this->parameters->group->elementByteLength();
   auto driverCount = this->memory->circuit->size();
   for (unsigned i = 0; i < driverCount - 1; i++) {
-    auto driver = this->memory->shuffledCircuit[i];
-    auto label = this->memory->driverLabels[driver->id];
-    ss << toString(label, P::MSG_NUM_BASE) << ' ';
+    auto id = this->memory->shuffledCircuit[i];
+    writer.element(this->memory->driverLabels[id], elementByteLength);
   }
   auto offset =
     this->parameters->monitorStateLength
     + this->parameters->systemStateLength;
   printf("D:  gateCount: %u\n", this->parameters->gateCount);
   for (unsigned i = 0; i < this->parameters->gateCount; i++) {
-    auto driver = this->memory->shuffledCircuit[offset + i];
-    auto index = 2 * (driver->id - offset);
+    auto id = this->memory->shuffledCircuit[offset + i];
+    auto index = 2 * (id - offset);
     testIdx(inWireLabels, index);
     testIdx(inWireLabels, index + 1);
-    auto labelLeft = inWireLabels[index];
-    auto labelRight = inWireLabels[index + 1];
-    ss << toString(labelLeft, P::MSG_NUM_BASE) << ' ';
-    ss << toString(labelRight, P::MSG_NUM_BASE) << ' ';
+    writer.element(inWireLabels[index], elementByteLength);
+    writer.element(inWireLabels[index + 1], elementByteLength);
   }
-  return ss.str();
+  return writer.take();
 }
 
 StatePtr P::SendLabels::next() {
   printf("I: SendLabels::next\n");
-  return std::make_unique<P::RecvGarbledGates>(this->parameters, this->memory);
+  // System holds the driver labels from now on.
+  std::vector<BigInt>().swap(this->memory->driverLabels);
+  return std::make_unique<P::RecvSystemInputLabels>(
+    this->parameters, this->memory);
 }
 
+P::RecvGarbledGates::RecvGarbledGates(
+  ParameterSet* parameters, MonitorMemory* memory, unsigned chunk)
+  : MonitorState(parameters, memory), chunk(chunk) {}
+
 bool P::RecvGarbledGates::isRecv() {
   return true;
 }
@@ -581,35 +666,57 @@ bool P::RecvGarbledGates::isRecv() {
 StatePtr P::RecvGarbledGates::next() {
   printf("I: RecvGarbledGates::next\n");
   auto& timer = this->memory->timer;
-  timer.reset();
-  timer.start();
-  auto message = this->memory->receivedMessage;
-  auto gateCount = this->parameters->gateCount;
+  timer.resume();
   auto& garbledGates = this->memory->garbledGates;
-  std::tie(garbledGates, message) = readGarbledGates(message, gateCount);
+  auto gateCount = this->parameters->chunk(this->chunk).size();
+  // Gates of earlier chunks are dropped once evaluated.
+  assert (garbledGates.empty());
+  garbledGates.reserve(gateCount);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  for (unsigned i = 0; i < gateCount; i++) {
+    auto& gate = garbledGates.emplace_back();
+    for (unsigned j = 0; j < gate.size(); j++)
+      gate[j] = reader.label(j);
+  }
   timer.pause();
-  return std::make_unique<P::RecvSystemInputLabels>(
-    this->parameters, this->memory);
+  return std::make_unique<P::EvaluateCircuit>(
+    this->parameters, this->memory, this->chunk);
 }
 
 bool P::RecvSystemInputLabels::isRecv() {
   return true;
 }
 
+void P::RecvSystemInputLabels::allocateSlots() {
+  auto memory = this->memory;
+  if (not memory->slotAllocation.slots.empty())
+    return;
+  if (memory->levelization.levels.empty())
+    memory->levelization =
+      memory->circuit->levelize(this->parameters->streamChunkSize);
+  memory->slotAllocation =
+    memory->circuit->allocateSlots(memory->levelization);
+  printf("D:   %u label slots for %u drivers\n",
+    memory->slotAllocation.slotCount, memory->circuit->size());
+}
+
 StatePtr P::RecvSystemInputLabels::next() {
   printf("I: RecvSystemInputLabels::next\n");
+  // The round starts with the system input labels.
   auto& timer = this->memory->timer;
-  timer.resume();
-  auto message = this->memory->receivedMessage;
-  std::vector <BigInt> systemInputLabels;
-  std::tie(systemInputLabels, message) =
-    readBigInts(message, P::MSG_NUM_BASE, this->parameters->systemStateLength);
-  // printf("D:   read system input labels\n");
+  timer.reset();
+  timer.start();
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  auto elementByteLength = this->parameters->group->elementByteLength();
+  // Inputs keep their ID's as slots.
+  this->allocateSlots();
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
   auto offset = this->parameters->monitorStateLength;
-  evaluatedDriverLabels.resize(this->memory->circuit->size());
-  for (unsigned i = 0; i < systemInputLabels.size(); i++)
-    evaluatedDriverLabels[offset + i] = systemInputLabels[i];
+  evaluatedDriverLabels.resize(this->memory->slotAllocation.slotCount);
+  for (unsigned i = 0; i < this->parameters->systemStateLength; i++)
+    evaluatedDriverLabels[offset + i] = reader.element(elementByteLength);
   timer.pause();
   return std::make_unique<P::RecvFlagBitLabels>(this->parameters, this->memory);
 }
@@ -622,18 +729,18 @@ StatePtr P::RecvFlagBitLabels::next() {
   printf("I: RecvFlagBitLabels::next\n");
   auto& timer = this->memory->timer;
   timer.resume();
-  auto message = this->memory->receivedMessage;
-  std::vector<BigInt> flagBitLabels;
-  std::tie(flagBitLabels, message) = readBigInts(message, P::MSG_NUM_BASE, 2);
-  this->memory->flagBitLabels[0] = flagBitLabels[0];
-  this->memory->flagBitLabels[1] = flagBitLabels[1];
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  auto elementByteLength = this->parameters->group->elementByteLength();
+  for (auto& label : this->memory->flagBitLabels)
+    label = reader.element(elementByteLength);
   timer.pause();
   if (this->memory->isFirstRound) {
     this->memory->isFirstRound = false;
     return std::make_unique<P::MonitorObliviousTransfer>
       (this->parameters, this->memory);
   }
-  return std::make_unique<P::EvaluateCircuit>(this->parameters, this->memory);
+  return std::make_unique<P::RecvGarbledGates>(this->parameters, this->memory);
 }
 
 P::MonitorObliviousTransfer::MonitorObliviousTransfer(
@@ -645,7 +752,8 @@ P::MonitorObliviousTransfer::MonitorObliviousTransfer(
   this->OTParameters = std::make_unique<BM::ParameterSet>
     (BM::ParameterSet {
       .securityParameter = this->parameters->securityParameter,
-      .group = parameters->group });
+      .group = parameters->group,
+      .wireFormat = parameters->wireFormat });
   this->chooserMemory = std::make_unique<BM::ChooserMemory>();
   this->state = std::make_unique<BM::InitChooser>
     (this->OTParameters.get(), this->chooserMemory.get());
@@ -675,7 +783,7 @@ std::string P::MonitorObliviousTransfer::message() {
 StatePtr P::MonitorObliviousTransfer::next() {
   printf("I: MonitorObliviousTransfer::next\n");
   if (this->counter == this->parameters->monitorStateLength)
-    return std::make_unique<P::EvaluateCircuit>
+    return std::make_unique<P::RecvGarbledGates>
       (this->parameters, this->memory);
   // printf("D:   counter: %d\n", this->counter);
   auto& timer = this->memory->timer;
@@ -695,9 +803,13 @@ StatePtr P::MonitorObliviousTransfer::next() {
   return std::make_unique<P::MonitorObliviousTransfer> (std::move(*this));
 }
 
+P::EvaluateCircuit::EvaluateCircuit(
+  ParameterSet* parameters, MonitorMemory* memory, unsigned chunk)
+  : MonitorState(parameters, memory), chunk(chunk) {}
+
 std::string P::EvaluateCircuit::padLabel(BigInt label) {
   auto labelStr = toString(label, P::MSG_NUM_BASE);
-  auto targetLength = this->parameters->securityParameter / 4;
+  auto targetLength = this->parameters->group->elementHexLength();
   return std::string(targetLength - labelStr.size(), '0') + labelStr;
 }
 
@@ -705,58 +817,90 @@ std::vector<unsigned> P::EvaluateCircuit::getUnshuffling_Timed() {
   auto& timer = this->memory->timer;
   timer.resume();
   auto& shuffledCircuit = this->memory->shuffledCircuit;
-  auto drivers = this->memory->circuit->get();
+  auto driverCount = this->memory->circuit->size();
   // Result[i] = j iff
   // Driver with ID i is at position j in the shuffled circuit.
   std::vector<unsigned> result;
-  result.resize(drivers.size());
-  for (unsigned i = 0; i < drivers.size(); i++) {
-    auto& driver = shuffledCircuit[i];
-    result[driver->id] = i;
-  }
+  result.resize(driverCount);
+  for (unsigned i = 0; i < driverCount; i++)
+    result[shuffledCircuit[i]] = i;
   timer.pause();
   return result;
 }
 
-void P::EvaluateCircuit::evaluateDriverLabels() {
-  auto drivers = this->memory->circuit->get();
+void P::EvaluateCircuit::evaluateGate(unsigned id, unsigned chunkBegin) {
+  auto circuit = this->memory->circuit;
+  auto& unshuffled = this->memory->unshuffledCircuit;
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
+  auto& slots = this->memory->slotAllocation.slots;
   auto& garbledGates = this->memory->garbledGates;
   auto& inWireKeys = this->memory->inWireKeys;
   auto offset = this->parameters->inputLength();
-  auto unshuffled = this->getUnshuffling_Timed();
+  auto i = id - offset;
+  auto leftLabel = this->parameters->group->exp(
+    evaluatedDriverLabels[slots[circuit->inputLeft(id)]],
+    inWireKeys[2 * i]);
+  auto rightLabel = this->parameters->group->exp(
+    evaluatedDriverLabels[slots[circuit->inputRight(id)]],
+    inWireKeys[2 * i + 1]);
+  // printf("D:   evaluating gate ID %d\n", id);
+  // printf("D:   unshuffled index:  %d\n", unshuffled[id]);
+  // printf("D:     left label:   %s\n", this->padLabel(leftLabel).c_str());
+  // printf("D:     right label:  %s\n", this->padLabel(rightLabel).c_str());
+  auto outLabel = this->parameters->garbler->dec(
+    Label::fromHex(this->padLabel(leftLabel)),
+    Label::fromHex(this->padLabel(rightLabel)),
+    garbledGates[unshuffled[id] - offset - chunkBegin]);
+  // printf("D:     output label: %s\n", outLabel.toHex().c_str());
+  evaluatedDriverLabels[slots[id]] =
+    BigInt(outLabel.toHex(), P::MSG_NUM_BASE);
+}
+
+void P::EvaluateCircuit::evaluateDriverLabels() {
+  if (this->memory->unshuffledCircuit.empty())
+    this->memory->unshuffledCircuit = this->getUnshuffling_Timed();
   // printf("D:   shuffled IDs:   [ ");
   // for (auto driver : this->memory->shuffledCircuit)
   //   printf("%d ", driver->id);
   // printf("]\n");
-  // printf("D:   unshuffled IDs: [ ");
-  // for (auto id : unshuffled)
-  //   printf("%d ", id);
-  // printf("]\n");
   auto& timer = this->memory->timer;
   timer.resume();
-  for (unsigned i = 0; i < this->parameters->gateCount; i++) {
-    if (i % 10000 == 0 and i > 0) {
-      printf("D:   evaluating gate %d\n", i);
-      fflush(stdout);
+  // Gates are only shuffled within their chunk, and levels of
+  // a chunk are above those of earlier chunks (see Circuit::levelize());
+  // so, its gates take the same positions in the level order.
+  auto gates = this->parameters->chunk(this->chunk);
+  auto begin = gates.begin, end = gates.end;
+  // Label slots are allocated for evaluation in level order;
+  // so, gates are evaluated in that order even on a single thread.
+  auto& levelization = this->memory->levelization;
+  auto pool = this->parameters->threadPool;
+  if (begin == end or pool == nullptr or pool->size() == 1) {
+    for (auto i = begin; i < end; i++) {
+      if (i % 10000 == 0 and i > 0) {
+        printf("D:   evaluating gate %d\n", i);
+        fflush(stdout);
+      }
+      this->evaluateGate(levelization.order[i], gates.begin);
     }
-    auto gate = static_cast<Gate*>(drivers[offset + i]);
-    auto leftLabel = this->parameters->group.exp(
-      evaluatedDriverLabels[gate->inputLeft],
-      inWireKeys[2 * i]);
-    auto rightLabel = this->parameters->group.exp(
-      evaluatedDriverLabels[gate->inputRight],
-      inWireKeys[2 * i + 1]);
-    // printf("D:   evaluating gate ID %d\n", gate->id);
-    // printf("D:   unshuffled index:  %d\n", unshuffled[gate->id]);
-    // printf("D:     left label:   %s\n", this->padLabel(leftLabel).c_str());
-    // printf("D:     right label:  %s\n", this->padLabel(rightLabel).c_str());
-    auto outLabel = this->parameters->garbler->dec(
-      this->padLabel(leftLabel),
-      this->padLabel(rightLabel),
-      garbledGates[unshuffled[gate->id] - offset]);
-    // printf("D:     output label: %s\n", outLabel.c_str());
-    evaluatedDriverLabels[gate->id] = BigInt(outLabel, P::MSG_NUM_BASE);
+    timer.pause();
+    return;
+  }
+
+  // Gates of the same level only depend on gates of lower levels;
+  // so, levels are evaluated one after another,
+  // and the gates of each level in parallel.
+  auto& levels = levelization.levels;
+  auto firstLevel = levels[levelization.order[begin]];
+  auto lastLevel = levels[levelization.order[end - 1]];
+  for (auto k = firstLevel; k <= lastLevel; k++) {
+    auto level = levelization.level(k);
+    assert (begin <= level.begin and level.end <= end);
+    pool->parallelFor(
+      level.begin, level.end, P::EVALUATION_CHUNK_SIZE,
+      [this, &levelization, &gates] (size_t begin, size_t end) {
+        for (auto j = begin; j < end; j++)
+          this->evaluateGate(levelization.order[j], gates.begin);
+      });
   }
   timer.pause();
 }
@@ -765,6 +909,10 @@ StatePtr P::EvaluateCircuit::next() {
   printf("I: EvaluateCircuit::next\n");
   fflush(stdout);
   this->evaluateDriverLabels();
+  this->memory->garbledGates.clear();
+  if (this->chunk + 1 < this->parameters->chunkCount())
+    return std::make_unique<P::RecvGarbledGates>(
+      this->parameters, this->memory, this->chunk + 1);
   return std::make_unique<P::SendFlagBit> (this->parameters, this->memory);
 }
 
@@ -775,7 +923,8 @@ bool P::SendFlagBit::isSend() {
 bool P::SendFlagBit::getFlagBit() {
   auto& flagBitLabels = this->memory->flagBitLabels;
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
-  auto flagBitLabel = evaluatedDriverLabels.back();
+  auto& slots = this->memory->slotAllocation.slots;
+  auto flagBitLabel = evaluatedDriverLabels[slots.back()];
   assert (
     flagBitLabel == flagBitLabels[0]
     or flagBitLabel == flagBitLabels[1]);
@@ -783,7 +932,9 @@ bool P::SendFlagBit::getFlagBit() {
 }
 
 std::string P::SendFlagBit::message() {
-  return std::to_string(this->getFlagBit());
+  MessageWriter writer(this->parameters->wireFormat);
+  writer.number(this->getFlagBit());
+  return writer.take();
 }
 
 StatePtr P::SendFlagBit::next() {
@@ -811,10 +962,16 @@ StatePtr P::CopyMonitorStateLabels::next() {
   auto monitorStateLength = this->parameters->monitorStateLength;
   auto offset =
     this->parameters->systemStateLength + this->parameters->gateCount - 1;
-  // printf("D: offset = %d, # eval. labels = %lu\n", offset, evaluatedDriverLabels.size());
+  // Output slots may be input slots of other monitor state bits;
+  // so, all outputs are read before any input is written.
+  auto& slots = this->memory->slotAllocation.slots;
+  std::vector<BigInt> nextState(monitorStateLength);
+  for (unsigned i = 0; i < monitorStateLength; i++)
+    nextState[i] = evaluatedDriverLabels[slots[offset + i]];
   for (unsigned i = 0; i < monitorStateLength; i++)
-    evaluatedDriverLabels[i] = evaluatedDriverLabels[offset + i];
-  return std::make_unique<P::RecvGarbledGates> (this->parameters, this->memory);
+    evaluatedDriverLabels[i] = std::move(nextState[i]);
+  return std::make_unique<P::RecvSystemInputLabels> (
+    this->parameters, this->memory);
 }
 
 StatePtr P::MonitorDone::next() {
@@ -0,0 +1,185 @@
+#include <cassert>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "Label.hh"
+#include "MathUtils.hh"
+#include "StringUtils.hh"
+
+Label::Label() {
+  this->allocate(0);
+}
+
+Label::Label(size_t length) {
+  this->allocate(length);
+}
+
+Label::Label(const Label& other) {
+  this->allocate(other.length);
+  std::memcpy(this->blocks(), other.blocks(), this->count * sizeof(Block));
+}
+
+Label::Label(Label&& other) noexcept {
+  this->length = other.length;
+  this->count = other.count;
+  if (other.heapBlocks)
+    this->heapBlocks = std::move(other.heapBlocks);
+  else
+    std::memcpy(this->inlineBlocks, other.inlineBlocks, sizeof(inlineBlocks));
+  other.allocate(0);
+}
+
+Label& Label::operator=(const Label& other) {
+  if (this == &other)
+    return *this;
+  if (this->count != other.count)
+    this->allocate(other.length);
+  this->length = other.length;
+  std::memcpy(this->blocks(), other.blocks(), this->count * sizeof(Block));
+  return *this;
+}
+
+Label& Label::operator=(Label&& other) noexcept {
+  if (this == &other)
+    return *this;
+  this->length = other.length;
+  this->count = other.count;
+  if (other.heapBlocks)
+    this->heapBlocks = std::move(other.heapBlocks);
+  else {
+    this->heapBlocks.reset();
+    std::memcpy(this->inlineBlocks, other.inlineBlocks, sizeof(inlineBlocks));
+  }
+  other.allocate(0);
+  return *this;
+}
+
+void Label::allocate(size_t length) {
+  this->length = length;
+  this->count = (length + sizeof(Block) - 1) / sizeof(Block);
+  if (this->count > INLINE_LABEL_BLOCKS)
+    this->heapBlocks = std::make_unique<Block[]>(this->count);
+  else
+    this->heapBlocks.reset();
+  std::memset(this->blocks(), 0, this->count * sizeof(Block));
+}
+
+Block* Label::blocks() {
+  return this->heapBlocks ? this->heapBlocks.get() : this->inlineBlocks;
+}
+
+const Block* Label::blocks() const {
+  return this->heapBlocks ? this->heapBlocks.get() : this->inlineBlocks;
+}
+
+Label Label::random(size_t length) {
+  Label label(length);
+  randomBytes(label.data(), length);
+  return label;
+}
+
+Label Label::fromHex(std::string_view hex) {
+  auto odd = hex.size() % 2;
+  Label label((hex.size() + 1) / 2);
+  auto bytes = label.data();
+  for (size_t i = 0; i < hex.size(); i++) {
+    auto position = i + odd;
+    bytes[position / 2] |= hexValue(hex[i]) << (position % 2 ? 0 : 4);
+  }
+  return label;
+}
+
+std::string Label::toHex() const {
+  std::string hex(2 * this->length, 0);
+  auto bytes = this->data();
+  for (size_t i = 0; i < this->length; i++) {
+    hex[2 * i] = HEX_ALPHABET[bytes[i] >> 4];
+    hex[2 * i + 1] = HEX_ALPHABET[bytes[i] & 0xf];
+  }
+  return hex;
+}
+
+size_t Label::size() const {
+  return this->length;
+}
+
+bool Label::empty() const {
+  return this->length == 0;
+}
+
+unsigned char* Label::data() {
+  return reinterpret_cast<unsigned char*>(this->blocks());
+}
+
+const unsigned char* Label::data() const {
+  return reinterpret_cast<const unsigned char*>(this->blocks());
+}
+
+unsigned Label::blockCount() const {
+  return this->count;
+}
+
+bool Label::lsb() const {
+  assert (not this->empty());
+  return this->data()[this->length - 1] & 1;
+}
+
+void Label::setLsb(bool bit) {
+  assert (not this->empty());
+  auto& last = this->data()[this->length - 1];
+  last = (last & ~1) | bit;
+}
+
+Label Label::slice(size_t begin, size_t length) const {
+  assert (begin + length <= this->length);
+  Label label(length);
+  std::memcpy(label.data(), this->data() + begin, length);
+  return label;
+}
+
+Label& Label::operator^=(const Label& other) {
+  assert (this->length == other.length);
+  auto a = this->blocks();
+  auto b = other.blocks();
+  for (unsigned i = 0; i < this->count; i++) {
+#ifdef __SSE2__
+    auto x = _mm_load_si128(reinterpret_cast<const __m128i*>(a + i));
+    auto y = _mm_load_si128(reinterpret_cast<const __m128i*>(b + i));
+    _mm_store_si128(reinterpret_cast<__m128i*>(a + i), _mm_xor_si128(x, y));
+#else
+    a[i].words[0] ^= b[i].words[0];
+    a[i].words[1] ^= b[i].words[1];
+#endif
+  }
+  return *this;
+}
+
+Label Label::operator^(const Label& other) const {
+  Label result(*this);
+  result ^= other;
+  return result;
+}
+
+bool Label::operator==(const Label& other) const {
+  if (this->length != other.length)
+    return false;
+  auto a = this->blocks();
+  auto b = other.blocks();
+  for (unsigned i = 0; i < this->count; i++) {
+#ifdef __SSE2__
+    auto x = _mm_load_si128(reinterpret_cast<const __m128i*>(a + i));
+    auto y = _mm_load_si128(reinterpret_cast<const __m128i*>(b + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff)
+      return false;
+#else
+    if (a[i].words[0] != b[i].words[0] or a[i].words[1] != b[i].words[1])
+      return false;
+#endif
+  }
+  return true;
+}
+
+bool Label::operator!=(const Label& other) const {
+  return not (*this == other);
+}
@@ -98,6 +98,48 @@ std::string hashShake256(const std::string& s, size_t len) {
   return outputStream.str();
 }
 
+// Binary hashes are on the hot path of garbling;
+// so, every thread reuses its own digest context.
+namespace {
+  EVP_MD_CTX* threadDigestContext() {
+    thread_local OpenSSLPointer context(EVP_MD_CTX_new());
+    return context.get();
+  }
+};
+
+void hashSha512(
+  std::initializer_list<HashInput> inputs, unsigned char* out)
+{
+  auto context = threadDigestContext();
+  if (context == nullptr)
+    throw Sha512Error();
+  if (!EVP_DigestInit_ex(context, EVP_sha512(), nullptr))
+    throw Sha512Error();
+  for (auto& input : inputs)
+    if (!EVP_DigestUpdate(context, input.data, input.length))
+      throw Sha512Error();
+  unsigned int hashLength;
+  if (!EVP_DigestFinal_ex(context, out, &hashLength))
+    throw Sha512Error();
+  assert (hashLength == SHA512_LENGTH);
+}
+
+void hashShake256(
+  std::initializer_list<HashInput> inputs,
+  unsigned char* out, size_t outLength)
+{
+  auto context = threadDigestContext();
+  if (context == nullptr)
+    throw Shake256Error();
+  if (!EVP_DigestInit_ex(context, EVP_shake256(), nullptr))
+    throw Shake256Error();
+  for (auto& input : inputs)
+    if (!EVP_DigestUpdate(context, input.data, input.length))
+      throw Shake256Error();
+  if (!EVP_DigestFinalXOF(context, out, outLength))
+    throw Shake256Error();
+}
+
 uint64_t timeBasedSeed() {
   // The following comments are quoted
   // from the CPlusPlus.com reference.
@@ -2,6 +2,42 @@
 #include "Module.hh"
 #include "Exceptions.hh"
 
+namespace {
+  // Combines `words` pairwise with gates of the given type,
+  // in a balanced tree of ceil(log2(words.size())) levels.
+  Word reduceTree(Circuit& circuit, WordVector words, GateType type) {
+    assert (not words.empty());
+    while (words.size() > 1) {
+      WordVector next;
+      for (unsigned i = 0; i + 1 < words.size(); i += 2) {
+        Word combined(words[i].size());
+        for (unsigned j = 0; j < combined.size(); j++)
+          combined[j] = circuit.addGate(words[i][j], words[i + 1][j], type);
+        next.push_back(combined);
+      }
+      if (words.size() % 2 == 1)
+        next.push_back(words.back());
+      words = next;
+    }
+    return words[0];
+  }
+
+  // One-hot decoding of `select`: the k-th wire is 1
+  // iff `select` (LSB first) is the binary representation of k.
+  Word decode(Circuit& circuit, Word select) {
+    if (select.size() == 1)
+      return { circuit.addNot(select[0]), select[0] };
+    auto half = select.size() / 2;
+    auto low = decode(circuit, Word(select.begin(), select.begin() + half));
+    auto high = decode(circuit, Word(select.begin() + half, select.end()));
+    Word result(low.size() * high.size());
+    for (unsigned k = 0; k < result.size(); k++)
+      result[k] = circuit.addGate(
+        high[k / low.size()], low[k % low.size()], GateType::AND);
+    return result;
+  }
+}
+
 void Module::build(Circuit& circuit) {
   if (this->outputWord.empty())
     this->buildImpl(circuit);
@@ -45,8 +81,7 @@ Inverter::Inverter(Word input) : input(input) {}
 void Inverter::buildImpl(Circuit& circuit) {
   this->outputWord.resize(this->input.size());
   for (unsigned i = 0; i < this->input.size(); i++) {
-    auto bit = this->input[i];
-    this->outputWord[i] = circuit.addGate(bit, bit);
+    this->outputWord[i] = circuit.addNot(this->input[i]);
   }
 }
 
@@ -71,65 +106,40 @@ void AndGate::buildImpl(Circuit& circuit) {
   auto length = this->inputLeft.size();
   this->outputWord.resize(length);
   for (unsigned i = 0; i < length; i++) {
-    auto left = this->inputLeft[i];
-    auto right = this->inputRight[i];
-    auto nandOut = circuit.addGate(left, right);
-    auto nandOutInv = circuit.addGate(nandOut, nandOut);
-    this->outputWord[i] = nandOutInv;
+    this->outputWord[i] = circuit.addGate(
+      this->inputLeft[i], this->inputRight[i], GateType::AND);
   }
 }
 
 void OrGate::buildImpl(Circuit& circuit) {
   auto length = this->inputLeft.size();
   this->outputWord.resize(length);
-  auto leftInv = Inverter(this->inputLeft);
-  auto rightInv = Inverter(this->inputRight);
-  leftInv.build(circuit);
-  rightInv.build(circuit);
-
-  auto leftInvOut = leftInv.output();
-  auto rightInvOut = rightInv.output();
-
   for (unsigned i = 0; i < length; i++) {
-    outputWord[i] =
-      circuit.addGate(leftInvOut[i], rightInvOut[i]);
+    this->outputWord[i] = circuit.addGate(
+      this->inputLeft[i], this->inputRight[i], GateType::OR);
   }
 }
 
 void XorGate::buildImpl(Circuit& circuit) {
   auto length = this->inputLeft.size();
   this->outputWord.resize(length);
-
-  // An expression of the form A + B can be written as ~((~A) (~B)).
-  // We use the same strategy to implement XOR ((~a)b + a(~b)).
   for (unsigned i = 0; i < length; i++) {
-    // Using the auxiliary NAND,
-    // we don't need to invert both input bits.
-    // ~(lr) = ~l + ~r
-    auto nandAux = circuit.addGate(inputLeft[i], inputRight[i]);
-    // ~(l (~l + ~r)) = ~(l(~l) + r(~r)) = ~(l(~r))
-    auto nandLAux = circuit.addGate(inputLeft[i], nandAux);
-    // ~(r(~l))
-    auto nandRAux = circuit.addGate(inputRight[i], nandAux);
-    // l(~r) + r(~l)
-    outputWord[i] = circuit.addGate(nandLAux, nandRAux);
+    this->outputWord[i] = circuit.addGate(
+      this->inputLeft[i], this->inputRight[i], GateType::XOR);
   }
 }
 
 void XnorGate::buildImpl(Circuit& circuit) {
-  // a xnor b = ~(a xor b)
   auto length = this->inputLeft.size();
   this->outputWord.resize(length);
-  // a xor b
-  auto xorLR = XorGate(this->inputLeft, this->inputRight);
-  xorLR.build(circuit);
-  auto inv = Inverter(xorLR);
-  inv.build(circuit);
-  this->outputWord = inv;
+  for (unsigned i = 0; i < length; i++) {
+    this->outputWord[i] = circuit.addGate(
+      this->inputLeft[i], this->inputRight[i], GateType::XNOR);
+  }
 }
 
-Selector::Selector(WordVector input, Word select)
-: input(input), select(select) {
+Selector::Selector(WordVector input, Word select, SelectorType type)
+: input(input), select(select), type(type) {
   assert (input.size() == (1U << select.size()));
 }
 
@@ -137,7 +147,20 @@ void Selector::buildImpl(Circuit& circuit) {
   auto selectLength = select.size();
   auto wordLength = input[0].size();
 
-  if (selectLength == 1) {
+  if (this->type == SelectorType::DECODER) {
+    this->buildDecoder(circuit);
+  } else if (selectLength == 1 and this->type == SelectorType::XOR_MUX) {
+    // in0 ^ (select & (in0 ^ in1)) needs a single AND gate per bit.
+    auto selectBC = Broadcaster(select[0], wordLength);
+    selectBC.buildImpl(circuit);
+    auto diff = XorGate(input[0], input[1]);
+    diff.buildImpl(circuit);
+    auto selectedDiff = AndGate(Word(diff), Word(selectBC));
+    selectedDiff.buildImpl(circuit);
+    auto sel = XorGate(input[0], selectedDiff);
+    sel.buildImpl(circuit);
+    this->outputWord = sel;
+  } else if (selectLength == 1) {
     // Base case: `select` is a single bit.
     // We can construct the 2-to-1 selector directly,
     // using simpler modules.
@@ -167,19 +190,37 @@ void Selector::buildImpl(Circuit& circuit) {
     auto mid = 1 << (selectLength - 1);
     auto input0 = WordVector(input.begin()      , input.begin() + mid);
     auto input1 = WordVector(input.begin() + mid, input.end()        );
-    auto selector0 = Selector(input0, halfSelect);
-    auto selector1 = Selector(input1, halfSelect);
+    auto selector0 = Selector(input0, halfSelect, this->type);
+    auto selector1 = Selector(input1, halfSelect, this->type);
     selector0.buildImpl(circuit);
     selector1.buildImpl(circuit);
 
     auto selector2to1 = Selector(
       { selector0, selector1 },
-      { select.back() } );
+      { select.back() },
+      this->type);
     selector2to1.buildImpl(circuit);
     this->outputWord = selector2to1;
   }
 }
 
+void Selector::buildDecoder(Circuit& circuit) {
+  // Every input word is masked by its decoded select bit.
+  // At most one masked word is non-zero; so, they can be
+  // combined with XOR gates instead of OR gates.
+  auto oneHot = decode(circuit, this->select);
+  auto wordLength = this->input[0].size();
+  WordVector masked;
+  for (unsigned k = 0; k < this->input.size(); k++) {
+    auto mask = Broadcaster(oneHot[k], wordLength);
+    mask.build(circuit);
+    auto maskedWord = AndGate(this->input[k], Word(mask));
+    maskedWord.build(circuit);
+    masked.push_back(maskedWord);
+  }
+  this->outputWord = reduceTree(circuit, masked, GateType::XOR);
+}
+
 HalfAdder::HalfAdder(unsigned inputLeft, unsigned inputRight)
 : inputLeft(inputLeft), inputRight(inputRight) {}
 
@@ -215,10 +256,19 @@ unsigned FullAdder::sum() { return (*this)[0]; }
 
 unsigned FullAdder::carry() { return (*this)[1]; }
 
-Adder::Adder(Word inputLeft, Word inputRight, unsigned carryIn)
-: inputLeft(inputLeft), inputRight(inputRight), carryIn(carryIn) {}
+Adder::Adder(
+  Word inputLeft, Word inputRight, unsigned carryIn, AdderType type)
+: inputLeft(inputLeft), inputRight(inputRight),
+  carryIn(carryIn), type(type) {}
 
 void Adder::buildImpl(Circuit& circuit) {
+  if (this->type == AdderType::RIPPLE)
+    this->buildRipple(circuit);
+  else
+    this->buildPrefix(circuit);
+}
+
+void Adder::buildRipple(Circuit& circuit) {
   auto length = this->inputLeft.size();
   this->outputWord.resize(length + 1);
   auto carryBit = this->carryIn;
@@ -231,6 +281,79 @@ void Adder::buildImpl(Circuit& circuit) {
   this->outputWord[length] = carryBit;
 }
 
+void Adder::buildPrefix(Circuit& circuit) {
+  auto length = this->inputLeft.size();
+  auto bitGenerate = AndGate(this->inputLeft, this->inputRight);
+  auto bitPropagate = XorGate(this->inputLeft, this->inputRight);
+  bitGenerate.build(circuit);
+  bitPropagate.build(circuit);
+  Word propagateOut = bitPropagate;
+
+  // Node 0 is the carry in, node i + 1 is bit i.
+  // Each node holds the (generate, propagate) pair of a group
+  // of consecutive nodes ending with itself; groups that contain
+  // the carry in never propagate, and NO_DRIVER stands for that.
+  // When the network is done, the group of every node i starts
+  // at node 0; so, generate[i] is the carry into bit i.
+  Word generate = { this->carryIn };
+  Word propagate = { NO_DRIVER };
+  Word generateOut = bitGenerate;
+  generate.insert(generate.end(), generateOut.begin(), generateOut.end());
+  propagate.insert(propagate.end(), propagateOut.begin(), propagateOut.end());
+
+  // Extends the group of node `hi` with the adjacent group of node `lo`.
+  // A group cannot both generate and propagate a carry;
+  // so, g_hi | (p_hi & g_lo) is computed with a XOR gate.
+  auto combine = [&](unsigned hi, unsigned lo) {
+    if (propagate[hi] != NO_DRIVER) {
+      auto carried = circuit.addGate(
+        propagate[hi], generate[lo], GateType::AND);
+      generate[hi] = circuit.addGate(generate[hi], carried, GateType::XOR);
+    }
+    propagate[hi] = propagate[lo] == NO_DRIVER
+      ? NO_DRIVER
+      : circuit.addGate(propagate[hi], propagate[lo], GateType::AND);
+  };
+  unsigned nodeCount = length + 1;
+  switch (this->type) {
+    case AdderType::KOGGE_STONE:
+      // Every node combines with the node at distance d, for d = 1, 2, 4...
+      // Nodes are visited downwards, so that `lo` is from the previous level.
+      for (unsigned d = 1; d < nodeCount; d *= 2)
+        for (unsigned i = nodeCount - 1; i >= d; i--)
+          combine(i, i - d);
+      break;
+    case AdderType::SKLANSKY:
+      // The upper half of every block of 2d nodes combines with
+      // the last node of the lower half.
+      for (unsigned d = 1; d < nodeCount; d *= 2)
+        for (unsigned i = 0; i < nodeCount; i++)
+          if (i & d)
+            combine(i, (i & ~(d - 1)) - 1);
+      break;
+    case AdderType::BRENT_KUNG: {
+      // A binary tree computes the groups of nodes 2^k - 1,
+      // then a reverse tree completes the other nodes.
+      unsigned d = 1;
+      for (; 2 * d <= nodeCount; d *= 2)
+        for (unsigned i = 2 * d - 1; i < nodeCount; i += 2 * d)
+          combine(i, i - d);
+      for (d /= 2; d >= 1; d /= 2)
+        for (unsigned i = 3 * d - 1; i < nodeCount; i += 2 * d)
+          combine(i, i - d);
+      break;
+    }
+    default:
+      assert (false);
+  }
+
+  this->outputWord.resize(length + 1);
+  for (unsigned i = 0; i < length; i++)
+    this->outputWord[i] = circuit.addGate(
+      propagateOut[i], generate[i], GateType::XOR);
+  this->outputWord[length] = generate[length];
+}
+
 Word Adder::sum() {
   // Last bit (MSB) is reserved for carry.
   auto out = this->output();
@@ -239,8 +362,9 @@ Word Adder::sum() {
 
 unsigned Adder::carry() { return this->output().back(); }
 
-EqChecker::EqChecker(Word inputLeft, Word inputRight)
-: inputLeft(inputLeft), inputRight(inputRight) {
+EqChecker::EqChecker(
+  Word inputLeft, Word inputRight, ComparatorType type)
+: inputLeft(inputLeft), inputRight(inputRight), type(type) {
   assert (inputLeft.size() == inputRight.size());
 }
 
@@ -250,6 +374,13 @@ void EqChecker::buildImpl(Circuit& circuit) {
   auto bitEq = XnorGate(this->inputLeft, this->inputRight);
   bitEq.build(circuit);
   auto bitEqOut = bitEq.output();
+  if (this->type == ComparatorType::TREE) {
+    WordVector bits;
+    for (auto bit : bitEqOut)
+      bits.push_back({ bit });
+    this->outputWord = reduceTree(circuit, bits, GateType::AND);
+    return;
+  }
 
   auto length = this->inputLeft.size();
   // partialEq[i] = bitEqOut[i] and partialEq[i + 1]
@@ -264,8 +395,9 @@ void EqChecker::buildImpl(Circuit& circuit) {
   outputWord = { partialEq[0] };
 }
 
-LtChecker::LtChecker(Word inputLeft, Word inputRight)
-: inputLeft(inputLeft), inputRight(inputRight) {
+LtChecker::LtChecker(
+  Word inputLeft, Word inputRight, ComparatorType type)
+: inputLeft(inputLeft), inputRight(inputRight), type(type) {
   assert (inputLeft.size() == inputRight.size());
 }
 
@@ -284,6 +416,33 @@ void LtChecker::buildImpl(Circuit& circuit) {
   auto bitLtOut = bitLt.output();
 
   auto length = this->inputLeft.size();
+  if (this->type == ComparatorType::TREE) {
+    // Adjacent groups of bits are combined pairwise:
+    // lt = lt_hi | (eq_hi & lt_lo), eq = eq_hi & eq_lo.
+    // lt_hi and eq_hi exclude each other, so OR can be XOR.
+    // The last level does not need its `eq`.
+    Word lt = bitLtOut;
+    Word eq = bitEqOut;
+    while (lt.size() > 1) {
+      Word nextLt, nextEq;
+      for (unsigned i = 0; i + 1 < lt.size(); i += 2) {
+        auto extended = circuit.addGate(eq[i + 1], lt[i], GateType::AND);
+        nextLt.push_back(
+          circuit.addGate(lt[i + 1], extended, GateType::XOR));
+        if (lt.size() > 2)
+          nextEq.push_back(
+            circuit.addGate(eq[i + 1], eq[i], GateType::AND));
+      }
+      if (lt.size() % 2 == 1) {
+        nextLt.push_back(lt.back());
+        nextEq.push_back(eq.back());
+      }
+      lt = nextLt;
+      eq = nextEq;
+    }
+    this->outputWord = { lt[0] };
+    return;
+  }
   auto partialEq = Word(length, -1);
   auto partialLt = Word(length, -1);
   partialEq[length - 1] = bitEqOut[length - 1];
@@ -5,9 +5,13 @@
 #include "LWY.hh"
 #include "Y.hh"
 #include "Circuit.hh"
+#include "CircuitCache.hh"
+#include "QuadraticResidueGroup.hh"
+#include "EllipticCurveGroup.hh"
 #include "Shake256YaoGarbler.hh"
+#include "HalfGatesGarbler.hh"
+#include "PointAndPermuteGarbler.hh"
 #include "CommandLineInterface.hh"
-#include "SpecToCircuitConverter.hh"
 
 class SetUp {
 public:
@@ -22,8 +26,31 @@ int main (int argc, char *argv[]) {
   auto cli = CommandLineInterface(argc, argv);
   cli.parse();
 
-  YosysConverter converter(cli.specFileName);
-  auto circuit = converter.convert();
+  CircuitCache cache(cli.parameters.circuitCacheDirectory);
+  Circuit circuit(0, 0);
+  try {
+    circuit = cache.compile(cli.specFileName,
+      cli.parameters.monitorStateLength, cli.parameters.systemStateLength);
+  } catch (const std::invalid_argument& e) {
+    printf("Error: %s\n", e.what());
+    exit(EXIT_FAILURE);
+  }
+  // In LWY, System garbles gates without seeing the circuit;
+  // so, all gates must be of the same type.
+  if (cli.parameters.protocol == ProtocolType::LWY)
+    circuit = circuit.toNand();
+  // With free XOR, copies of outputs are free as XOR gates.
+  else if (cli.parameters.garbling == GarblingScheme::HALF_GATES)
+    circuit = circuit.withXorCopies();
+  // Gates are evaluated chunk by chunk, as they are streamed.
+  auto levelization = circuit.levelize(cli.parameters.streamChunkSize);
+  printf(
+    "I: circuit has %u gates in %u levels "
+    "(max. width %u, avg. width %.1f)\n",
+    circuit.gateCount(), levelization.depth(),
+    levelization.maxWidth(), levelization.averageWidth());
+  auto slotAllocation = circuit.allocateSlots(levelization);
+  printf("I: evaluation needs %u label slots\n", slotAllocation.slotCount);
 
   SetUp();
   auto messageHandler = MessageHandler(L::SYSTEM_PORT, L::MONITOR_PORT);
@@ -36,38 +63,68 @@ int main (int argc, char *argv[]) {
     circuit.size() - (params.monitorStateLength + params.systemStateLength);
 
   // ONE-TIME MESSAGE:
-  // Monitor sends gateCount to System.
-  messageHandler.send(std::to_string(gateCount));
+  // Monitor sends gateCount to System, along with the wire format
+  // of all later messages, and the number of gates per message
+  // of garbled gates; both sides must split them alike.
+  messageHandler.send(
+    std::to_string(gateCount) + ' ' + wireFormatName(params.wireFormat)
+    + ' ' + std::to_string(params.streamChunkSize));
 
-  auto garbler = Shake256YaoGarbler();
+  std::unique_ptr<YaoGarbler> garbler;
+  if (params.garbling == GarblingScheme::HALF_GATES)
+    garbler = std::make_unique<HalfGatesGarbler>(
+      params.securityParameter >> 2);
+  else if (params.garbling == GarblingScheme::POINT_AND_PERMUTE)
+    garbler = std::make_unique<PointAndPermuteGarbler>();
+  else
+    garbler = std::make_unique<Shake256YaoGarbler>();
+  auto threadPool = ThreadPool(params.threadCount);
+  printf("I: using %u threads\n", threadPool.size());
 
   switch (params.protocol) {
     case ProtocolType::YAO: {
       auto monitorMemory = Y::MonitorMemory {
-        .circuit = &circuit
+        .circuit        = &circuit,
+        .levelization   = levelization,
+        .slotAllocation = slotAllocation
       };
       auto parameters = Y::ParameterSet {
         .gateCount          = gateCount,
         .monitorStateLength = params.monitorStateLength,
         .systemStateLength  = params.systemStateLength,
-        .garbler            = &garbler,
-        .securityParameter  = params.securityParameter
+        .garbler            = garbler.get(),
+        .securityParameter  = params.securityParameter,
+        .threadPool         = &threadPool,
+        .streamChunkSize    = params.streamChunkSize,
+        .wireFormat         = params.wireFormat
       };
       auto interface = Y::MonitorInterface(
         &parameters, &monitorMemory, &messageHandler);
       interface.run();
       break;
     } case ProtocolType::LWY: {
+      GroupPtr group;
+      if (params.group == GroupType::EC)
+        group = std::make_shared<EllipticCurveGroup>(
+          EllipticCurveGroup::curveFor(params.securityParameter));
+      else
+        group = std::make_shared<QuadraticResidueGroup>(primeModulus);
+      group->precomputeBaseGenerator(params.tableFileName);
       auto monitorMemory = L::MonitorMemory {
-        .circuit = &circuit
+        .circuit        = &circuit,
+        .levelization   = levelization,
+        .slotAllocation = slotAllocation
       };
       auto parameters = L::ParameterSet {
         .gateCount          = gateCount,
         .monitorStateLength = params.monitorStateLength,
         .systemStateLength  = params.systemStateLength,
-        .group              = QuadraticResidueGroup(primeModulus),
-        .garbler            = &garbler,
-        .securityParameter  = params.securityParameter
+        .group              = group,
+        .garbler            = garbler.get(),
+        .securityParameter  = params.securityParameter,
+        .threadPool         = &threadPool,
+        .streamChunkSize    = params.streamChunkSize,
+        .wireFormat         = params.wireFormat
       };
       auto interface = L::MonitorInterface(
         &parameters, &monitorMemory, &messageHandler);
@@ -1,3 +1,5 @@
+#include <cassert>
+#include <fstream>
 #include "MonitorableSystem.hh"
 
 void SweepSystem::next() {
@@ -137,3 +139,35 @@ const std::vector<bool>& Locks::data() {
   dataVec = flatten(locks);
   return dataVec;
 }
+
+TraceSystem::TraceSystem(std::string traceFileName) {
+  std::ifstream traceFile(traceFileName);
+  if (not traceFile)
+    throw std::runtime_error("Failed to open trace " + traceFileName);
+  std::string line;
+  while (std::getline(traceFile, line)) {
+    if (line.empty() or line[0] == '#')
+      continue;
+    std::vector<bool> state(line.size());
+    for (unsigned i = 0; i < line.size(); i++) {
+      assert (line[i] == '0' or line[i] == '1');
+      state[i] = line[i] == '1';
+    }
+    assert (states.empty() or state.size() == states[0].size());
+    states.push_back(state);
+  }
+  assert (not states.empty());
+}
+
+unsigned TraceSystem::length() {
+  return states.size();
+}
+
+void TraceSystem::next() {
+  if (cntr + 1 < states.size())
+    cntr++;
+}
+
+const std::vector<bool>& TraceSystem::data() {
+  return states[cntr];
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cassert>
+#include "PointAndPermuteGarbler.hh"
+#include "MathUtils.hh"
+#include "Exceptions.hh"
+
+unsigned PointAndPermuteGarbler::colourPosition(
+  const Label& a, const Label& b)
+{
+  assert (a.size() == b.size());
+  for (size_t i = a.size(); i-- > 0;) {
+    auto diff = a.data()[i] ^ b.data()[i];
+    if (diff == 0)
+      continue;
+    unsigned bit = 0;
+    while (not ((diff >> bit) & 1))
+      bit++;
+    return 8 * (a.size() - 1 - i) + bit;
+  }
+  // The two labels of a pair must differ.
+  throw InvalidLabels();
+}
+
+bool PointAndPermuteGarbler::colour(const Label& label, unsigned position) {
+  auto byte = position / 8;
+  if (byte >= label.size())
+    throw InvalidCipher();
+  return (label.data()[label.size() - 1 - byte] >> (position % 8)) & 1;
+}
+
+Label PointAndPermuteGarbler::rowPad(
+  const Label& left, const Label& right, uint64_t tweak, size_t length)
+{
+  Label pad(length);
+  hashShake256(
+    { { left.data(), left.size() },
+      { right.data(), right.size() },
+      { &tweak, sizeof(tweak) } },
+    pad.data(), length);
+  return pad;
+}
+
+GarbledGate PointAndPermuteGarbler::enc(
+  const LabelPair& left,
+  const LabelPair& right,
+  LabelPair& out,
+  uint64_t tweak,
+  GateType type)
+{
+  auto size = out[0].size();
+  if (out[1].size() != size)
+    throw InvalidLabels();
+  // Positions are sent as 16-bit numbers.
+  auto leftPosition = colourPosition(left[0], left[1]);
+  auto rightPosition = colourPosition(right[0], right[1]);
+  assert (leftPosition <= UINT16_MAX and rightPosition <= UINT16_MAX);
+
+  GarbledGate gate;
+  for (unsigned a = 0; a < 2; a++)
+    for (unsigned b = 0; b < 2; b++) {
+      auto row =
+        2 * colour(left[a], leftPosition) + colour(right[b], rightPosition);
+      gate[row] = out[evaluateGate(type, a, b)] ^
+        rowPad(left[a], right[b], tweak, size);
+    }
+
+  Label header(COLOUR_HEADER_SIZE + size);
+  auto bytes = header.data();
+  bytes[0] = leftPosition >> 8;
+  bytes[1] = leftPosition & 0xff;
+  bytes[2] = rightPosition >> 8;
+  bytes[3] = rightPosition & 0xff;
+  std::copy_n(gate[0].data(), size, bytes + COLOUR_HEADER_SIZE);
+  gate[0] = std::move(header);
+  return gate;
+}
+
+Label PointAndPermuteGarbler::dec(
+  const Label& left,
+  const Label& right,
+  const GarbledGate& gate,
+  uint64_t tweak,
+  GateType type)
+{
+  if (gate[0].size() < COLOUR_HEADER_SIZE)
+    throw InvalidCipher();
+  auto bytes = gate[0].data();
+  unsigned leftPosition = (bytes[0] << 8) | bytes[1];
+  unsigned rightPosition = (bytes[2] << 8) | bytes[3];
+  auto row = 2 * colour(left, leftPosition) + colour(right, rightPosition);
+  auto cipher = row == 0
+    ? gate[0].slice(COLOUR_HEADER_SIZE, gate[0].size() - COLOUR_HEADER_SIZE)
+    : gate[row];
+  cipher ^= rowPad(left, right, tweak, cipher.size());
+  return cipher;
+}
+
+unsigned PointAndPermuteGarbler::evaluationHashCount(GateType type) {
+  return 1;
+}
+
+LabelPair PointAndPermuteGarbler::randomLabelPair(unsigned length) {
+  auto pair = YaoGarbler::randomLabelPair(length);
+  pair[1].setLsb(not pair[0].lsb());
+  return pair;
+}
@@ -0,0 +1,49 @@
+#include "PrimeOrderGroup.hh"
+
+PrimeOrderGroup::PrimeOrderGroup(BigInt baseGenerator)
+  : baseGenerator(baseGenerator) {}
+
+BigInt PrimeOrderGroup::randomGenerator() {
+  // In a group of prime order, every element but the identity
+  // is a generator; a random exponent is never 0.
+  return this->expFixedBase(this->baseGenerator, this->randomExponent());
+}
+
+unsigned PrimeOrderGroup::elementByteLength() {
+  return (this->elementHexLength() + 1) / 2;
+}
+
+BigInt PrimeOrderGroup::expFixedBase(const BigInt& base, const BigInt& n) {
+  return this->exp(base, n);
+}
+
+std::vector<BigInt> PrimeOrderGroup::expBatch(
+  const std::vector<ExpJob>& jobs, ThreadPool* pool)
+{
+  std::vector<BigInt> results(jobs.size());
+  parallelFor(
+    pool, 0, jobs.size(), EXP_BATCH_CHUNK_SIZE,
+    [&] (size_t begin, size_t end) {
+      for (auto i = begin; i < end; i++)
+        results[i] = this->expFixedBase(*jobs[i].base, *jobs[i].exponent);
+    });
+  return results;
+}
+
+std::vector<std::array<BigInt, 2>> PrimeOrderGroup::expPairBatch(
+  const std::vector<const BigInt*>& bases,
+  const std::array<BigInt, 2>& exponents,
+  ThreadPool* pool)
+{
+  std::vector<std::array<BigInt, 2>> results(bases.size());
+  parallelFor(
+    pool, 0, bases.size(), EXP_BATCH_CHUNK_SIZE,
+    [&] (size_t begin, size_t end) {
+      for (auto i = begin; i < end; i++)
+        for (unsigned e = 0; e < 2; e++)
+          results[i][e] = this->exp(*bases[i], exponents[e]);
+    });
+  return results;
+}
+
+void PrimeOrderGroup::precomputeBaseGenerator(const std::string&) {}
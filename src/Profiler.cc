@@ -0,0 +1,63 @@
+#include <memory>
+#include "Circuit.hh"
+#include "CircuitCache.hh"
+#include "CircuitProfiler.hh"
+#include "CommandLineInterface.hh"
+#include "CostEstimator.hh"
+#include "EllipticCurveGroup.hh"
+#include "HalfGatesGarbler.hh"
+#include "MathUtils.hh"
+#include "PointAndPermuteGarbler.hh"
+#include "QuadraticResidueGroup.hh"
+#include "Shake256YaoGarbler.hh"
+
+// Profiler reports the shape of a compiled spec and, given `-security`,
+// estimates what a round of each protocol and garbling scheme costs,
+// so that they can be compared without running them.
+
+int main(int argc, char* argv[]) {
+  auto cli = CommandLineInterface(argc, argv, false);
+  cli.parse();
+  auto args = cli.argMap();
+  auto params = cli.parameters;
+  CircuitCache cache(params.circuitCacheDirectory);
+  Circuit circuit(0, 0);
+  try {
+    circuit = cache.compile(cli.specFileName,
+      params.monitorStateLength, params.systemStateLength);
+  } catch (const std::invalid_argument& e) {
+    printf("Error: %s\n", e.what());
+    exit(EXIT_FAILURE);
+  }
+  CircuitProfiler(circuit, params.monitorStateLength).profile().print();
+  if (not args.contains("-security"))
+    exit(EXIT_SUCCESS);
+
+  initPrimes();
+  auto security = params.securityParameter;
+  GroupPtr group;
+  if (params.group == GroupType::EC)
+    group = std::make_shared<EllipticCurveGroup>(
+      EllipticCurveGroup::curveFor(security));
+  else
+    group = std::make_shared<QuadraticResidueGroup>(getSafePrime(security));
+  auto classic = Shake256YaoGarbler();
+  auto permute = PointAndPermuteGarbler();
+  auto halfGates = HalfGatesGarbler(security >> 2);
+
+  printf("I: estimated costs per round at security %u, %s wire format "
+    "(S: system, M: monitor)\n", security,
+    wireFormatName(params.wireFormat));
+  auto estimator = CostEstimator(
+    circuit, params.monitorStateLength, security, params.wireFormat);
+  CostEstimate::printHeader();
+  estimator.estimateYao(classic, "yao/classic").print();
+  estimator.estimateYao(permute, "yao/permute").print();
+  // As in Monitor, copies of outputs are XOR gates with free XOR.
+  auto xorCircuit = circuit.withXorCopies();
+  CostEstimator(xorCircuit, params.monitorStateLength, security,
+    params.wireFormat).estimateYao(halfGates, "yao/halfgates").print();
+  estimator.estimateLwy(*group, classic, "lwy/classic").print();
+  estimator.estimateLwy(*group, permute, "lwy/permute").print();
+  exit(EXIT_SUCCESS);
+}
@@ -1,3 +1,8 @@
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include "MathUtils.hh"
 #include "QuadraticResidueGroup.hh"
@@ -5,35 +10,26 @@
 
 using QRGroup = QuadraticResidueGroup;
 
+namespace {
+  // Last line of a table file; a file cut off before it is rejected.
+  const std::string TABLE_FILE_END = "end";
+}
+
+// For any safe prime p,
+// 4 is a generator of the group of quadratic residues modulo p.
 QRGroup::QuadraticResidueGroup(BigInt p)
-  : primeModulus(p), smallPrime((p - 1) / 2) {}
+  : PrimeOrderGroup(BigInt(4)),
+    context(std::make_shared<const GroupContext>(p)) {}
 
 QRGroup::~QuadraticResidueGroup() {}
 
-BigInt QRGroup::randomGenerator() {
-  // For any safe prime p,
-  // 4 is a generator of the group of quadratic residues modulo p.
-  // So, to get a random generator,
-  // we can return a random exponentiation of 4 modulo p.
-  BigInt g(4);
-
-  gmp_randstate_t state;
-  // TODO: use a better initialization;
-  // Mersenne Twister is not cryptographically secure.
-  gmp_randinit_mt(state);
-  gmp_randseed_ui(state, timeBasedSeed());
-
-  auto exp = this->randomExponent();
-  mpz_powm(
-    g.get_mpz_t(),
-    g.get_mpz_t(),
-    exp.get_mpz_t(),
-    this->primeModulus.get_mpz_t());
-  return g;
-}
-
 BigInt QRGroup::mul(const BigInt& a, const BigInt& b) {
-  return (a * b) % this->primeModulus;
+  BigInt rop;
+  mpz_mul(rop.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+  mpz_mod(
+    rop.get_mpz_t(), rop.get_mpz_t(),
+    this->context->primeModulus.get_mpz_t());
+  return rop;
 }
 
 BigInt QRGroup::exp(const BigInt& a, const BigInt& n) {
@@ -42,16 +38,311 @@ BigInt QRGroup::exp(const BigInt& a, const BigInt& n) {
     rop.get_mpz_t(),
     a.get_mpz_t(),
     n.get_mpz_t(),
-    this->primeModulus.get_mpz_t());
+    this->context->primeModulus.get_mpz_t());
   return rop;
 }
 
+std::vector<BigInt> QRGroup::expBatch(
+  const std::vector<ExpJob>& jobs, ThreadPool* pool)
+{
+  std::vector<BigInt> results(jobs.size());
+  // mpz_powm keeps its temporaries on the stack of the calling thread,
+  // and every job writes to its own result;
+  // so, threads do not share anything but the (read-only) operands.
+  parallelFor(
+    pool, 0, jobs.size(), EXP_BATCH_CHUNK_SIZE,
+    [&] (size_t begin, size_t end) {
+      for (auto i = begin; i < end; i++) {
+        auto table = this->fixedBaseTable(*jobs[i].base);
+        if (table)
+          results[i] = this->expWithTable(*table, *jobs[i].exponent);
+        else
+          mpz_powm(
+            results[i].get_mpz_t(),
+            jobs[i].base->get_mpz_t(),
+            jobs[i].exponent->get_mpz_t(),
+            this->context->primeModulus.get_mpz_t());
+      }
+    });
+  return results;
+}
+
+RecodedExponent QRGroup::recode(const BigInt& n) {
+  RecodedExponent result;
+  auto w = FIXED_EXPONENT_WINDOW_BITS;
+  result.windowBits = w;
+  auto& order = this->context->smallPrime;
+  BigInt exponent = n % order;
+  if (exponent < 0)
+    exponent += order;
+  auto bitCount =
+    exponent == 0 ? 0 : mpz_sizeinbase(exponent.get_mpz_t(), 2);
+  for (size_t bit = 0; bit < bitCount; bit += w) {
+    uint8_t digit = 0;
+    for (unsigned i = 0; i < w; i++)
+      digit |= mpz_tstbit(exponent.get_mpz_t(), bit + i) << i;
+    result.digits.push_back(digit);
+  }
+  return result;
+}
+
+std::vector<std::array<BigInt, 2>> QRGroup::expPairBatch(
+  const std::vector<const BigInt*>& bases,
+  const std::array<BigInt, 2>& exponents,
+  ThreadPool* pool)
+{
+  std::array<RecodedExponent, 2> recoded = {
+    this->recode(exponents[0]), this->recode(exponents[1]) };
+  auto w = FIXED_EXPONENT_WINDOW_BITS;
+  unsigned digitCount = 1u << w;
+  auto windowCount =
+    std::max(recoded[0].digits.size(), recoded[1].digits.size());
+  for (auto& r : recoded)
+    r.digits.resize(windowCount, 0);
+  auto& context = *this->context;
+  auto n = context.limbCount();
+
+  std::vector<std::array<BigInt, 2>> results(bases.size());
+  // Right-to-left k-ary exponentiation (Yao's method):
+  // for each exponent e and digit d, bucket[d] collects the product of
+  // base ^ (2^(w * j)) over all windows j where e has the digit d.
+  // Then, base ^ e is the product of bucket[d] ^ d over all digits d.
+  // The powers base ^ (2^(w * j)) are shared by both exponents.
+  // All of this is done in Montgomery form.
+  parallelFor(
+    pool, 0, bases.size(), EXP_BATCH_CHUNK_SIZE,
+    [&] (size_t begin, size_t end) {
+      // Scratch space, reused for all bases of this chunk;
+      // bucket k is buckets[k * n .. (k + 1) * n).
+      std::vector<mp_limb_t> buckets(2 * digitCount * n);
+      std::vector<bool> isUsed(2 * digitCount);
+      std::vector<mp_limb_t> scratch(2 * n);
+      MontgomeryElement result(n), suffix(n);
+      for (auto i = begin; i < end; i++) {
+        auto power = context.toMontgomery(*bases[i]);
+        std::fill(isUsed.begin(), isUsed.end(), false);
+        for (size_t j = 0; j < windowCount; j++) {
+          for (unsigned e = 0; e < 2; e++) {
+            auto d = recoded[e].digits[j];
+            if (d == 0)
+              continue;
+            auto k = e * digitCount + d;
+            auto bucket = &buckets[k * n];
+            if (isUsed[k])
+              context.mul(bucket, bucket, power.data(), scratch.data());
+            else
+              std::copy(power.begin(), power.end(), bucket);
+            isUsed[k] = true;
+          }
+          if (j + 1 < windowCount)
+            for (unsigned s = 0; s < w; s++)
+              context.mul(
+                power.data(), power.data(), power.data(), scratch.data());
+        }
+        // prod bucket[d] ^ d = prod over d of (prod over d' >= d of
+        // bucket[d']); the inner products are the running `suffix`.
+        for (unsigned e = 0; e < 2; e++) {
+          bool isResultSet = false, isSuffixSet = false;
+          for (unsigned d = digitCount - 1; d >= 1; d--) {
+            auto k = e * digitCount + d;
+            auto bucket = &buckets[k * n];
+            if (isUsed[k] and isSuffixSet)
+              context.mul(
+                suffix.data(), suffix.data(), bucket, scratch.data());
+            else if (isUsed[k])
+              std::copy(bucket, bucket + n, suffix.begin());
+            isSuffixSet = isSuffixSet or isUsed[k];
+            if (isSuffixSet and isResultSet)
+              context.mul(
+                result.data(), result.data(), suffix.data(), scratch.data());
+            else if (isSuffixSet)
+              result = suffix;
+            isResultSet = isSuffixSet;
+          }
+          results[i][e] = isResultSet ? context.fromMontgomery(result) : 1;
+        }
+      }
+    });
+  return results;
+}
+
+void QRGroup::precomputeFixedBase(const BigInt& base) {
+  auto& context = *this->context;
+  auto n = context.limbCount();
+  auto table = std::make_shared<FixedBaseTable>();
+  auto w = FIXED_BASE_WINDOW_BITS;
+  unsigned digitCount = (1u << w) - 1;
+  auto windowCount = this->fixedBaseWindowCount(w);
+  table->windowBits = w;
+  table->powers.resize(windowCount * digitCount * n);
+  // `power` is base ^ (2^(w * j)) for the current window j.
+  auto power = context.toMontgomery(base);
+  std::vector<mp_limb_t> scratch(2 * n);
+  for (unsigned j = 0; j < windowCount; j++) {
+    auto row = &table->powers[j * digitCount * n];
+    std::copy(power.begin(), power.end(), row);
+    for (unsigned d = 1; d < digitCount; d++)
+      context.mul(row + d * n, row + (d - 1) * n, power.data(), scratch.data());
+    context.mul(
+      power.data(), row + (digitCount - 1) * n, power.data(), scratch.data());
+  }
+  this->fixedBaseTables[base] = table;
+}
+
+unsigned QRGroup::fixedBaseWindowCount(unsigned windowBits) {
+  // Exponents are reduced modulo the order before use;
+  // so, windows only need to cover the bits of the order.
+  auto orderBits = mpz_sizeinbase(this->context->smallPrime.get_mpz_t(), 2);
+  return (orderBits + windowBits - 1) / windowBits;
+}
+
+const FixedBaseTable* QRGroup::fixedBaseTable(const BigInt& base) {
+  auto it = this->fixedBaseTables.find(base);
+  if (it == this->fixedBaseTables.end())
+    return nullptr;
+  return it->second.get();
+}
+
+BigInt QRGroup::expWithTable(const FixedBaseTable& table, const BigInt& n) {
+  auto& context = *this->context;
+  auto limbCount = context.limbCount();
+  auto w = table.windowBits;
+  mp_limb_t digitMask = (mp_limb_t(1) << w) - 1;
+  unsigned digitCount = digitMask;
+  auto& order = context.smallPrime;
+  BigInt exponent = n % order;
+  if (exponent < 0)
+    exponent += order;
+  auto exponentLimbs = mpz_limbs_read(exponent.get_mpz_t());
+  size_t exponentSize = mpz_size(exponent.get_mpz_t());
+  size_t bitCount =
+    exponentSize == 0 ? 0 : mpz_sizeinbase(exponent.get_mpz_t(), 2);
+  assert (bitCount <= table.powers.size() / limbCount / digitCount * w);
+
+  auto result = context.one();
+  std::vector<mp_limb_t> scratch(2 * limbCount);
+  for (size_t bit = 0; bit < bitCount; bit += w) {
+    // The digit of this window may span two limbs.
+    auto limb = bit / GMP_NUMB_BITS;
+    auto shift = bit % GMP_NUMB_BITS;
+    mp_limb_t digit = exponentLimbs[limb] >> shift;
+    if (shift + w > GMP_NUMB_BITS and limb + 1 < exponentSize)
+      digit |= exponentLimbs[limb + 1] << (GMP_NUMB_BITS - shift);
+    digit &= digitMask;
+    if (digit == 0)
+      continue;
+    auto power =
+      &table.powers[(bit / w * digitCount + digit - 1) * limbCount];
+    context.mul(result.data(), result.data(), power, scratch.data());
+  }
+  return context.fromMontgomery(result);
+}
+
+BigInt QRGroup::expFixedBase(const BigInt& base, const BigInt& n) {
+  auto table = this->fixedBaseTable(base);
+  if (not table)
+    return this->exp(base, n);
+  return this->expWithTable(*table, n);
+}
+
+void QRGroup::precomputeBaseGenerator(const std::string& cacheFileName) {
+  if (not cacheFileName.empty()
+    and this->loadFixedBaseTables(cacheFileName)
+    and this->fixedBaseTable(this->baseGenerator))
+  {
+    printf("I: fixed-base tables loaded from %s\n", cacheFileName.c_str());
+    return;
+  }
+  this->precomputeFixedBase(this->baseGenerator);
+  if (cacheFileName.empty())
+    return;
+  if (this->saveFixedBaseTables(cacheFileName))
+    printf("I: fixed-base tables saved to %s\n", cacheFileName.c_str());
+  else
+    printf("I: could not write fixed-base tables to %s\n",
+      cacheFileName.c_str());
+}
+
+bool QRGroup::saveFixedBaseTables(const std::string& fileName) {
+  auto& context = *this->context;
+  auto n = context.limbCount();
+  // Monitor and System may share a file; so, it is written aside,
+  // then renamed.
+  auto tempFileName = fileName + "." + std::to_string(getpid());
+  std::ofstream file(tempFileName);
+  // Powers are stored in canonical form,
+  // independent of the Montgomery parameters.
+  file << std::hex << context.primeModulus << '\n';
+  file << std::dec << this->fixedBaseTables.size() << '\n';
+  for (auto& [base, table] : this->fixedBaseTables) {
+    file << std::hex << base << std::dec << ' '
+      << table->windowBits << ' ' << table->powers.size() / n << '\n';
+    file << std::hex;
+    for (size_t i = 0; i < table->powers.size(); i += n) {
+      MontgomeryElement power(
+        table->powers.begin() + i, table->powers.begin() + i + n);
+      file << context.fromMontgomery(power) << '\n';
+    }
+  }
+  file << TABLE_FILE_END << '\n';
+  file.close();
+  if (not file or rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+    remove(tempFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool QRGroup::loadFixedBaseTables(const std::string& fileName) {
+  auto& context = *this->context;
+  std::ifstream file(fileName);
+  BigInt modulus;
+  if (not (file >> std::hex >> modulus) or modulus != context.primeModulus)
+    return false;
+  size_t tableCount;
+  if (not (file >> std::dec >> tableCount))
+    return false;
+  // Tables are only kept once the whole file has been checked.
+  std::map<BigInt, std::shared_ptr<const FixedBaseTable>> tables;
+  for (size_t i = 0; i < tableCount; i++) {
+    BigInt base;
+    size_t powerCount;
+    auto table = std::make_shared<FixedBaseTable>();
+    file >> std::hex >> base >> std::dec
+      >> table->windowBits >> powerCount;
+    if (not file or table->windowBits == 0 or table->windowBits > 16)
+      return false;
+    auto digitCount = (1u << table->windowBits) - 1;
+    if (powerCount
+      != this->fixedBaseWindowCount(table->windowBits) * digitCount)
+      return false;
+    table->powers.reserve(powerCount * context.limbCount());
+    file >> std::hex;
+    for (size_t j = 0; j < powerCount; j++) {
+      BigInt power;
+      // Powers are nonzero residues.
+      if (not (file >> power) or power <= 0 or power >= modulus)
+        return false;
+      auto montgomery = context.toMontgomery(power);
+      table->powers.insert(
+        table->powers.end(), montgomery.begin(), montgomery.end());
+    }
+    tables[base] = table;
+  }
+  std::string end;
+  if (not (file >> end) or end != TABLE_FILE_END)
+    return false;
+  for (auto& [base, table] : tables)
+    this->fixedBaseTables[base] = table;
+  return true;
+}
+
 BigInt QuadraticResidueGroup::inv(const BigInt& a) {
   BigInt rop;
   mpz_invert(
     rop.get_mpz_t(),
     a.get_mpz_t(),
-    this->primeModulus.get_mpz_t());
+    this->context->primeModulus.get_mpz_t());
   return rop;
 }
 
@@ -62,7 +353,7 @@ BigInt QuadraticResidueGroup::randomExponent() {
 
   BigInt exp;
   // Exponent must be in {1, ..., p1 - 1}.
-  BigInt upperBound = this->smallPrime;
+  BigInt upperBound = this->context->smallPrime;
   mpz_urandomm(
     exp.get_mpz_t(), state, upperBound.get_mpz_t());
   while (exp == 0)
@@ -71,6 +362,10 @@ BigInt QuadraticResidueGroup::randomExponent() {
   return exp;
 }
 
+unsigned QuadraticResidueGroup::elementHexLength() {
+  return (mpz_sizeinbase(this->context->primeModulus.get_mpz_t(), 2) + 3) / 4;
+}
+
 BigInt QuadraticResidueGroup::order() {
-  return this->smallPrime;
+  return this->context->smallPrime;
 }
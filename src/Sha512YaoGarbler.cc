@@ -1,58 +1,71 @@
+#include <algorithm>
 #include <cassert>
-#include <openssl/evp.h>
 #include "Exceptions.hh"
 #include "MathUtils.hh"
 #include "Sha512YaoGarbler.hh"
 
-// Output of SHA-512 is 128 characters long,
-// when represented in hexadecimal.
-const size_t SHA512_HEX_SIZE = EVP_MAX_MD_SIZE * 2;
-// The last character is an XOR checksum.
-const size_t CHECK_HEX_SIZE = 16;
+// The last bytes of a ciphertext are a checksum of the label,
+// taken from the SHA-512 hash of the label.
+const size_t CHECK_SIZE = 8;
 
-bool Sha512YaoGarbler::checkLabels(std::vector<Label> labels) {
+bool Sha512YaoGarbler::checkLabels(const std::vector<const Label*>& labels) {
   bool valid = true;
   assert (labels.size() == 3 * 2);
-  auto size = labels[0].size();
+  auto size = labels[0]->size();
   for (auto label : labels)
-    valid &= label.size() == size;
-  valid &= size <= SHA512_HEX_SIZE - CHECK_HEX_SIZE;
+    valid &= label->size() == size;
+  valid &= size <= SHA512_LENGTH - CHECK_SIZE;
   return valid;
 }
 
-Ciphertext Sha512YaoGarbler::encImpl(
-  Label left, Label right, Label out)
+// The first `length` bytes of the SHA-512 hash of the given labels.
+static Label hashPrefix(
+  std::initializer_list<HashInput> inputs, size_t length)
 {
-  auto s = left + right;
-  auto h = hashSha512(s);
-
-  auto check = hashSha512(out);
-  check = check.substr(0, CHECK_HEX_SIZE);
-  auto out1 = out + check;
+  assert (length <= SHA512_LENGTH);
+  Label hash(SHA512_LENGTH);
+  hashSha512(inputs, hash.data());
+  return hash.slice(0, length);
+}
 
-  Ciphertext cipher(out1.size(), 0);
-  for (size_t i = 0; i < out1.size(); i++)
-    cipher[i] = HEX_ALPHABET[hexValue(out1[i]) ^ hexValue(h[i])];
+Ciphertext Sha512YaoGarbler::encImpl(
+  const Label& left, const Label& right, const Label& out)
+{
+  auto size = out.size() + CHECK_SIZE;
+  auto check = hashPrefix({ { out.data(), out.size() } }, CHECK_SIZE);
+  Ciphertext cipher(size);
+  std::copy_n(out.data(), out.size(), cipher.data());
+  std::copy_n(check.data(), CHECK_SIZE, cipher.data() + out.size());
+  cipher ^= hashPrefix(
+    { { left.data(), left.size() }, { right.data(), right.size() } }, size);
   return cipher;
 }
 
 Label Sha512YaoGarbler::decImpl(
-  Label left, Label right, Ciphertext cipher)
+  const Label& left, const Label& right, const Ciphertext& cipher)
 {
-  auto s = left + right;
-  auto h = hashSha512(s);
   auto size = cipher.size();
-  Label label(size, 0);
-  for (size_t i = 0; i < size; i++)
-    label[i] = HEX_ALPHABET[hexValue(cipher[i]) ^ hexValue(h[i])];
-
-  auto check = hashSha512(label.substr(0, size - CHECK_HEX_SIZE));
-  check = check.substr(0, CHECK_HEX_SIZE);
+  if (size < CHECK_SIZE or size > SHA512_LENGTH)
+    throw InvalidCipher();
+  auto label = cipher ^ hashPrefix(
+    { { left.data(), left.size() }, { right.data(), right.size() } }, size);
+  auto labelSize = size - CHECK_SIZE;
+  auto check = hashPrefix({ { label.data(), labelSize } }, CHECK_SIZE);
   // printf(
   //   "D: Sha512YaoGarbler::decImpl: label %s, check: %s\n",
-  //   label.c_str(),
-  //   check.c_str());
-  if (label.substr(size - CHECK_HEX_SIZE) != check)
+  //   label.toHex().c_str(),
+  //   check.toHex().c_str());
+  if (not std::equal(
+      check.data(), check.data() + CHECK_SIZE, label.data() + labelSize))
     throw InvalidCipher();
-  return label.substr(0, size - CHECK_HEX_SIZE);
+  return label.slice(0, labelSize);
+}
+
+// Every row also hashes the checksum of its label.
+unsigned Sha512YaoGarbler::garblingHashCount(GateType type) {
+  return 8;
+}
+
+unsigned Sha512YaoGarbler::evaluationHashCount(GateType type) {
+  return 8;
 }
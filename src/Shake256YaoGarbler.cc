@@ -1,53 +1,58 @@
+#include <algorithm>
 #include <cassert>
 #include "Shake256YaoGarbler.hh"
 #include "MathUtils.hh"
 #include "Exceptions.hh"
 
-const unsigned CHECK_HEX_SIZE = 25;
+// 104 bits of 1's are appended to a label before encryption.
+const size_t CHECK_SIZE = 13;
+const unsigned char CHECK_BYTE = 0xff;
 
-bool Shake256YaoGarbler::checkLabels(std::vector<Label> labels) {
+bool Shake256YaoGarbler::checkLabels(
+  const std::vector<const Label*>& labels)
+{
   bool valid = true;
   assert (labels.size() == 3 * 2);
-  auto size = labels[0].size();
+  auto size = labels[0]->size();
   for (auto label : labels)
-    valid &= label.size() == size;
+    valid &= label->size() == size;
   return valid;
 }
 
+// Pad of `length` bytes for the gate row of `left` and `right`.
+static Label rowPad(const Label& left, const Label& right, size_t length) {
+  Label pad(length);
+  hashShake256(
+    { { left.data(), left.size() }, { right.data(), right.size() } },
+    pad.data(), length);
+  return pad;
+}
+
 Ciphertext
 Shake256YaoGarbler::encImpl(
-  Label left, Label right, Label out
+  const Label& left, const Label& right, const Label& out
 ) {
-  // 1 ^ {4 * CHECK_HEX_SIZE} in binary.
-  auto check = std::string(CHECK_HEX_SIZE, 'f');
-  auto out1 = out + check;
-
-  auto s = left + right;
-  auto h = hashShake256(s, out1.size());
-
-  Ciphertext cipher(out1.size(), 0);
-  for (size_t i = 0; i < out1.size(); i++)
-    cipher[i] = HEX_ALPHABET[hexValue(out1[i]) ^ hexValue(h[i])];
+  Ciphertext cipher(out.size() + CHECK_SIZE);
+  std::copy_n(out.data(), out.size(), cipher.data());
+  std::fill_n(cipher.data() + out.size(), CHECK_SIZE, CHECK_BYTE);
+  cipher ^= rowPad(left, right, cipher.size());
   return cipher;
 }
 
 Label
 Shake256YaoGarbler::decImpl(
-  Label left, Label right, Ciphertext cipher
+  const Label& left, const Label& right, const Ciphertext& cipher
 ) {
-  auto s = left + right;
   auto size = cipher.size();
-  auto h = hashShake256(s, size);
-  auto label = Label(size, 0);
-  for (size_t i = 0; i < size; i++)
-    label[i] = HEX_ALPHABET[hexValue(cipher[i]) ^ hexValue(h[i])];
-
-  auto check = std::string(CHECK_HEX_SIZE, 'f');
+  if (size < CHECK_SIZE)
+    throw InvalidCipher();
+  auto label = cipher ^ rowPad(left, right, size);
+  auto check = label.data() + size - CHECK_SIZE;
   // printf(
-  //   "D: Sha512YaoGarbler::decImpl: label %s, check: %s\n",
-  //   label.c_str(),
-  //   check.c_str());
-  if (label.substr(size - CHECK_HEX_SIZE) != check)
+  //   "D: Shake256YaoGarbler::decImpl: label %s\n",
+  //   label.toHex().c_str());
+  if (not std::all_of(check, check + CHECK_SIZE,
+      [] (unsigned char c) { return c == CHECK_BYTE; }))
     throw InvalidCipher();
-  return label.substr(0, size - CHECK_HEX_SIZE);
+  return label.slice(0, size - CHECK_SIZE);
 }
@@ -0,0 +1,66 @@
+#include <fstream>
+#include <iostream>
+#include "Circuit.hh"
+#include "CircuitCache.hh"
+#include "CommandLineInterface.hh"
+#include "SpecToCircuitConverter.hh"
+#include "TraceSimulator.hh"
+#include "Timer.hh"
+
+// Simulator runs a spec against a system (or a recorded trace)
+// in plaintext, and reports when the flag bit is raised.
+// It is meant as a fast oracle for the garbled protocols.
+
+int main(int argc, char* argv[]) {
+  auto cli = CommandLineInterface(argc, argv, false);
+  cli.parse();
+  auto args = cli.argMap();
+  auto params = cli.parameters;
+  CircuitCache cache(params.circuitCacheDirectory);
+  Circuit circuit(0, 0);
+  try {
+    circuit = cache.compile(cli.specFileName,
+      params.monitorStateLength, params.systemStateLength);
+  } catch (const std::invalid_argument& e) {
+    printf("Error: %s\n", e.what());
+    exit(EXIT_FAILURE);
+  }
+  printf("I: circuit has %u gates\n", circuit.gateCount());
+  if (args.contains("-export")) {
+    BristolConverter::write(
+      circuit, params.monitorStateLength, args["-export"]);
+    return 0;
+  }
+  if (not cli.system) {
+    printf("Error: no system given; use -sys\n");
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned rounds = args.contains("-rounds")
+    ? std::stoul(args["-rounds"])
+    : 1000000;
+  auto traceSystem = dynamic_cast<TraceSystem*>(cli.system.get());
+  if (traceSystem and not args.contains("-rounds"))
+    rounds = traceSystem->length();
+  std::unique_ptr<std::ofstream> recordFile;
+  if (args.contains("-record"))
+    recordFile = std::make_unique<std::ofstream>(args["-record"]);
+
+  auto simulator = TraceSimulator(
+    circuit, params.monitorStateLength, params.systemStateLength);
+  Timer timer;
+  timer.start();
+  auto flagRound = simulator.run(*cli.system, rounds, recordFile.get());
+  auto duration = timer.display();
+
+  auto roundCount = simulator.roundCount();
+  if (flagRound)
+    printf("I: flag raised in round %u\n", *flagRound);
+  else
+    printf("I: flag not raised in %u rounds\n", roundCount);
+  printf("I: simulated %u rounds in %f ms (%.0f rounds/s, %.3g gates/s)\n",
+    roundCount, duration,
+    roundCount / (duration / 1e3),
+    (double) roundCount * circuit.gateCount() / (duration / 1e3));
+  exit(EXIT_SUCCESS);
+}
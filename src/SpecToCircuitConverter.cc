@@ -241,6 +241,15 @@ Word BaseConverter::readExpression(std::vector<std::string> expr) {
   return result;
 }
 
+namespace {
+  const std::map<std::string, AdderType> adderTypes = {
+    { "Adder", AdderType::RIPPLE },
+    { "KoggeStoneAdder", AdderType::KOGGE_STONE },
+    { "BrentKungAdder", AdderType::BRENT_KUNG },
+    { "SklanskyAdder", AdderType::SKLANSKY },
+  };
+}
+
 Word BaseConverter::buildOperator(std::string op, std::vector<Word> operands) {
   auto isBinary = (op != "Inverter" and op != "Negator");
   assert (not isBinary or operands.size() == 2);
@@ -256,16 +265,24 @@ Word BaseConverter::buildOperator(std::string op, std::vector<Word> operands) {
     auto xorGate = XorGate(operands[0], operands[1]);
     xorGate.build(this->circuit);
     return xorGate;
-  } else if (op == "EqChecker") {
-    auto eqChecker = EqChecker(operands[0], operands[1]);
+  } else if (op == "EqChecker" or op == "TreeEqChecker") {
+    auto type = op == "EqChecker"
+      ? ComparatorType::LINEAR
+      : ComparatorType::TREE;
+    auto eqChecker = EqChecker(operands[0], operands[1], type);
     eqChecker.build(this->circuit);
     return eqChecker;
-  } else if (op == "LtChecker") {
-    auto ltChecker = LtChecker(operands[0], operands[1]);
+  } else if (op == "LtChecker" or op == "TreeLtChecker") {
+    auto type = op == "LtChecker"
+      ? ComparatorType::LINEAR
+      : ComparatorType::TREE;
+    auto ltChecker = LtChecker(operands[0], operands[1], type);
     ltChecker.build(this->circuit);
     return ltChecker;
-  } else if (op == "Adder") {
-    auto adder = Adder(operands[0], operands[1], this->circuitConstants[0]);
+  } else if (adderTypes.contains(op)) {
+    auto adder = Adder(
+      operands[0], operands[1], this->circuitConstants[0],
+      adderTypes.at(op));
     adder.build(this->circuit);
     return adder.sum();
   } else if (op == "Inverter") {
@@ -294,6 +311,192 @@ Word BaseConverter::readNumber(std::string number, unsigned length) {
   return word;
 }
 
+BristolConverter::BristolConverter(std::string specFileName)
+  : SpecToCircuitConverter(specFileName) {}
+
+void BristolConverter::readHeader() {
+  std::ifstream file(this->specFileName);
+  if (not file)
+    throw std::invalid_argument("Cannot read " + this->specFileName);
+  this->readHeader(file);
+}
+
+void BristolConverter::readHeader(std::istream& file) {
+  // Header: gate and wire counts, then the bit lengths
+  // of input values and of output values.
+  auto readValueLengths = [&] () {
+    size_t valueCount, total = 0;
+    std::vector<size_t> lengths;
+    file >> valueCount;
+    if (file)
+      lengths.resize(valueCount);
+    for (auto& length : lengths) {
+      file >> length;
+      total += length;
+    }
+    return std::make_pair(lengths, total);
+  };
+  file >> this->gateCount >> this->wireCount;
+  auto [inputLengths, inputLength] = readValueLengths();
+  auto [outputLengths, outputLength] = readValueLengths();
+  if (not file or inputLength + outputLength > this->wireCount)
+    throw std::invalid_argument("Invalid Bristol Fashion header");
+  this->monitorStateLength = inputLengths.empty() ? 0 : inputLengths[0];
+  this->systemStateLength = inputLength - this->monitorStateLength;
+  this->outputLength = outputLength;
+}
+
+Circuit BristolConverter::convert() {
+  printf("I: parsing Bristol Fashion file %s...\n", this->specFileName.c_str());
+  fflush(stdout);
+  std::ifstream file(this->specFileName);
+  if (not file)
+    throw std::invalid_argument("Cannot read " + this->specFileName);
+  this->readHeader(file);
+  auto gateCount = this->gateCount, wireCount = this->wireCount;
+  auto inputLength = this->monitorStateLength + this->systemStateLength;
+  auto outputLength = this->outputLength;
+
+  auto& circuit = this->circuit;
+  circuit = Circuit(inputLength, outputLength);
+  // driverIds[wire] is the circuit driver of `wire`.
+  std::vector<uint32_t> driverIds(wireCount, NO_DRIVER);
+  for (unsigned i = 0; i < inputLength; i++)
+    driverIds[i] = i;
+  std::array<uint32_t, 2> constants = { NO_DRIVER, NO_DRIVER };
+  auto driverOf = [&] (size_t wire) {
+    if (wire >= wireCount or driverIds[wire] == NO_DRIVER)
+      throw std::invalid_argument(
+        "Bristol wire used before it is set: " + std::to_string(wire));
+    return driverIds[wire];
+  };
+  for (size_t i = 0; i < gateCount; i++) {
+    size_t inCount, outCount;
+    file >> inCount >> outCount;
+    std::vector<size_t> wires(inCount + outCount);
+    for (auto& wire : wires)
+      file >> wire;
+    std::string op;
+    file >> op;
+    if (not file or outCount != 1 or wires.back() >= wireCount)
+      throw std::invalid_argument(
+        "Invalid Bristol gate #" + std::to_string(i));
+    auto& out = driverIds[wires.back()];
+    if (op == "AND" and inCount == 2) {
+      out = circuit.addGate(
+        driverOf(wires[0]), driverOf(wires[1]), GateType::AND);
+    } else if (op == "XOR" and inCount == 2) {
+      out = circuit.addGate(
+        driverOf(wires[0]), driverOf(wires[1]), GateType::XOR);
+    } else if (op == "INV" and inCount == 1) {
+      out = circuit.addNot(driverOf(wires[0]));
+    } else if (op == "EQW" and inCount == 1) {
+      out = driverOf(wires[0]);
+    } else if (op == "EQ" and inCount == 1 and wires[0] <= 1) {
+      // The input is a constant; constants are derived
+      // from the first input, when needed.
+      auto value = wires[0];
+      if (constants[value] == NO_DRIVER and value) {
+        auto one = One(0);
+        one.build(circuit);
+        constants[1] = one;
+      } else if (constants[value] == NO_DRIVER) {
+        auto zero = Zero(0);
+        zero.build(circuit);
+        constants[0] = zero;
+      }
+      out = constants[value];
+    } else {
+      throw std::invalid_argument("Unsupported Bristol gate: " + op);
+    }
+  }
+  // Outputs are the last wires.
+  Word outputs(outputLength);
+  for (unsigned i = 0; i < outputLength; i++)
+    outputs[i] = driverOf(wireCount - outputLength + i);
+  circuit.updateOutputs(outputs);
+  printf("I: %zu Bristol gates read into %u gates\n",
+    gateCount, circuit.gateCount());
+  return std::move(this->circuit);
+}
+
+void BristolConverter::write(
+  Circuit& circuit, unsigned monitorStateLength, const std::string& fileName)
+{
+  struct BristolGate {
+    const char* op;
+    unsigned inCount;
+    uint32_t in[2];
+    uint32_t out;
+  };
+  auto inputLength = circuit.inputs().size();
+  auto outputRange = circuit.outputs();
+  auto outputLength = outputRange.size();
+  assert (monitorStateLength <= inputLength);
+  // Gates are kept in memory, as the header needs the gate count.
+  std::vector<BristolGate> gates;
+  // wires[id] is the wire carrying driver `id`.
+  std::vector<uint32_t> wires(circuit.size());
+  uint32_t wireCount = inputLength;
+  for (unsigned id = 0; id < inputLength; id++)
+    wires[id] = id;
+  auto add = [&] (const char* op, uint32_t a, uint32_t b) {
+    gates.push_back({ op, 2, { a, b }, wireCount });
+    return wireCount++;
+  };
+  auto inv = [&] (uint32_t a) {
+    gates.push_back({ "INV", 1, { a, a }, wireCount });
+    return wireCount++;
+  };
+  auto gateRange = circuit.gates();
+  for (auto id = gateRange.begin; id < gateRange.end; id++) {
+    auto a = wires[circuit.inputLeft(id)];
+    auto b = wires[circuit.inputRight(id)];
+    switch (circuit.gateType(id)) {
+      case GateType::AND:  wires[id] = add("AND", a, b); break;
+      case GateType::NAND: wires[id] = inv(add("AND", a, b)); break;
+      case GateType::OR:
+        wires[id] = add("XOR", add("XOR", a, b), add("AND", a, b));
+        break;
+      case GateType::XOR:  wires[id] = add("XOR", a, b); break;
+      case GateType::XNOR: wires[id] = inv(add("XOR", a, b)); break;
+      case GateType::NOT:  wires[id] = inv(a); break;
+    }
+  }
+  // Output wires must be the last wires. As outputs drive no gates
+  // (see Circuit::updateOutputs), their wires can be moved
+  // to the end, and other wires shifted down, keeping gates in order.
+  std::vector<uint32_t> outputIndex(wireCount, NO_DRIVER);
+  for (unsigned i = 0; i < outputLength; i++)
+    outputIndex[wires[outputRange.begin + i]] = i;
+  std::vector<uint32_t> renumbered(wireCount);
+  uint32_t next = 0, outputBase = wireCount - outputLength;
+  for (uint32_t wire = 0; wire < wireCount; wire++)
+    renumbered[wire] = outputIndex[wire] == NO_DRIVER
+      ? next++
+      : outputBase + outputIndex[wire];
+
+  std::ofstream file(fileName);
+  file << gates.size() << ' ' << wireCount << '\n';
+  // A single input value would be taken for the monitor state.
+  if (monitorStateLength == inputLength)
+    file << "1 " << inputLength << '\n';
+  else
+    file << "2 " << monitorStateLength << ' '
+         << inputLength - monitorStateLength << '\n';
+  if (outputLength > 1)
+    file << "2 " << outputLength - 1 << " 1\n\n";
+  else
+    file << "1 " << outputLength << "\n\n";
+  for (auto& gate : gates) {
+    file << gate.inCount << " 1";
+    for (unsigned i = 0; i < gate.inCount; i++)
+      file << ' ' << renumbered[gate.in[i]];
+    file << ' ' << renumbered[gate.out] << ' ' << gate.op << '\n';
+  }
+  printf("I: wrote %zu Bristol gates to %s\n", gates.size(), fileName.c_str());
+}
+
 YosysConverter::YosysConverter(std::string specFileName)
   : SpecToCircuitConverter(specFileName) {}
 
@@ -342,175 +545,230 @@ BlifParser::BlifParser(std::string blifFileName)
   : blifFileName(blifFileName) {}
 
 void BlifParser::parse(Circuit& circuit) {
-  std::ifstream blifFile(blifFileName);
-  std::vector<std::string> lines;
-  std::string line;
-  while (std::getline(blifFile, line))
-    lines.push_back(line);
+  std::ifstream blifFile(this->blifFileName);
+  if (not blifFile)
+    throw std::invalid_argument("Cannot read BLIF file " + this->blifFileName);
+  // Constants come first, so that their ID's are known.
+  this->defineWire(this->internWire("$false"), WireKind::CONSTANT, 0);
+  this->defineWire(this->internWire("$true"), WireKind::CONSTANT, 1);
 
-  // First, we parse inputs and outputs.
-  for (auto& line : lines) {
-    if (line.starts_with(".inputs")) parseInputs(line);
-    if (line.starts_with(".outputs")) parseOutputs(line);
+  // Lines are read one at a time;
+  // a trailing backslash continues a line.
+  std::string line;
+  std::vector<std::string> tokens;
+  unsigned lineCount = 0;
+  while (std::getline(blifFile, line)) {
+    lineCount++;
+    bool continued = not line.empty() and line.back() == '\\';
+    if (continued)
+      line.pop_back();
+    std::istringstream iss(line);
+    std::string token;
+    while (iss >> token)
+      tokens.push_back(token);
+    if (continued)
+      continue;
+    if (not tokens.empty())
+      this->parseLine(tokens);
+    tokens.clear();
   }
-  printf("D: inputs and outputs parsed.\n");
+  if (not tokens.empty())
+    this->parseLine(tokens);
+  printf("D: %u lines, %zu wires parsed.\n", lineCount, this->wireKinds.size());
   fflush(stdout);
 
-  // Now we should reshape the circuit to be of proper size.
   circuit = Circuit(
     this->monitorStateLength + this->systemStateLength,
     this->outputLength);
-  auto zero = Zero(0);
-  auto one = One(0);
-  zero.build(circuit);
-  one.build(circuit);
-  this->wireIndices["$false"] = zero;
-  this->wireIndices["$true"] = one;
-  printf("D: circuit initialized.\n");
-  fflush(stdout);
-  // Second, we parse connections.
-  unsigned connCounter = 0;
-  for (auto& line : lines) {
-    if (line.starts_with(".conn")) { parseConnection(line); connCounter++; }
-  }
-  printf("D: connections (#%u) parsed.\n", connCounter);
-  fflush(stdout);
-  // Lastly, we parse gates.
-  unsigned gateCounter = 0;
-  for (auto& line : lines) {
-    if (line.starts_with(".subckt")) { parseGate(line); gateCounter++; };
-  }
-  printf("D: gates (#%u) parsed.\n", gateCounter);
-  fflush(stdout);
-  // Now we can build the circuit.
-  buildCircuit(circuit);
-  // Now we update the circuit outputs.
-  for (auto& key : this->graph)
-    assert (this->wireIndices.find(key.first) != this->wireIndices.end());
-
-  Word outputs(this->outputLength);
+  // All outputs are named out[i], for some i.
+  std::vector<uint32_t> outputWires(this->outputLength);
   for (unsigned i = 0; i < this->outputLength; i++) {
     auto wire = "out[" + std::to_string(i) + "]";
-    assert (wireIndices.find(wire) != wireIndices.end());
-    outputs[i] = wireIndices[wire];
+    auto found = this->wireIds.find(wire);
+    if (found == this->wireIds.end())
+      throw std::invalid_argument("Missing BLIF output: " + wire);
+    outputWires[i] = found->second;
   }
-  // Outputs might be in any order,
-  // since some of them also drive other wires.
-  // To fix this, we add 'identity' gates to the circuit.
-  printf("D: outputs: ");
-  for (auto& out : outputs)
-    printf("%d ", out);
-  printf("\n");
+  std::vector<uint32_t> driverIds(this->wireKinds.size(), NO_DRIVER);
+  this->buildWires(outputWires, circuit, driverIds);
+
+  Word outputs(this->outputLength);
+  for (unsigned i = 0; i < this->outputLength; i++)
+    outputs[i] = driverIds[outputWires[i]];
+  // Outputs might be in any order, and some of them
+  // also drive other wires; updateOutputs() copies such outputs.
   printf("D: circuit size: %d\n", circuit.size());
-  printf("D: adding identity gates for outputs...\n");
-  auto id = Identity(outputs);
-  id.build(circuit);
-  printf("D: outputs after identity: ");
-  for (auto& out : Word(id))
-    printf("%d ", out);
-  printf("\n");
-  printf("D: circuit size after identity: %d\n", circuit.size());
   fflush(stdout);
-  circuit.updateOutputs(id);
+  circuit.updateOutputs(outputs);
 }
 
-void BlifParser::parseInputs(const std::string& line) {
-  std::istringstream iss(line.substr(7));  // skip ".inputs "
-  std::string input;
-  unsigned inputIdx = 0;
-  this->monitorStateLength = 0;
-  this->systemStateLength = 0;
-  while (iss >> input) {
-    assert (input.starts_with("monitor[") or input.starts_with("system["));
-    // Inputs are indexed manually.
-    // ASSUMPTION: Monitor inputs always come before system inputs.
-    // So, line looks like:
-    // .inputs monitor[0] ... monitor[n] system[0] ... system[m]
-    monitorStateLength += input.starts_with("monitor[");
-    systemStateLength += input.starts_with("system[");
-    this->graph[input] = {};
-    this->wireIndices[input] = inputIdx++;
+uint32_t BlifParser::internWire(const std::string& name) {
+  auto [it, inserted] = this->wireIds.try_emplace(name, this->wireKinds.size());
+  if (inserted) {
+    this->wireNames.push_back(&it->first);
+    this->wireKinds.push_back(WireKind::UNDEFINED);
+    this->wireLeft.push_back(NO_DRIVER);
+    this->wireRight.push_back(NO_DRIVER);
+    this->wireTypes.push_back(GateType::NAND);
   }
+  return it->second;
 }
 
-void BlifParser::parseOutputs(const std::string& line) {
-  std::istringstream iss(line.substr(8));  // skip ".outputs "
-  std::string output;
-  this->outputLength = 0;
-  // At this stage, we can't do anything special with the outputs.
-  // We only know that all output signals are named out[i], for some i.
-  while (iss >> output) {
-    assert (output.starts_with("out["));
-    this->graph[output] = {};
-    outputLength++;
-  }
-}
-
-void BlifParser::parseConnection(const std::string& line) {
-  // Every connection is a forward edge.
-  std::istringstream iss(line.substr(5)); // skip ".conn "
-  std::string first, second;
-  iss >> first >> second;
-  this->graph[second].push_back(first);
+void BlifParser::defineWire(
+  uint32_t wire, WireKind kind, uint32_t left, uint32_t right, GateType type)
+{
+  if (this->wireKinds[wire] != WireKind::UNDEFINED)
+    throw std::invalid_argument(
+      "BLIF wire driven twice: " + *this->wireNames[wire]);
+  this->wireKinds[wire] = kind;
+  this->wireLeft[wire] = left;
+  this->wireRight[wire] = right;
+  this->wireTypes[wire] = type;
 }
 
-void BlifParser::parseGate(const std::string& line) {
-  if (line.starts_with(".subckt $_NOT_")) {
-    // Parse "A=input Y=output"
-    size_t aPos = line.find("A=") + 2;
-    size_t yPos = line.find("Y=") + 2;
-    std::string input = line.substr(aPos, line.find(" ", aPos) - aPos);
-    std::string output = line.substr(yPos);
-
-    // NOT(x) = NAND(x,x)
-    this->graph[output] = {input, input};
-  } else if (line.starts_with(".subckt $_NAND_")) {
-    // Parse "A=in1 B=in2 Y=output"
-    size_t aPos = line.find("A=") + 2;
-    size_t bPos = line.find("B=") + 2;
-    size_t yPos = line.find("Y=") + 2;
-    std::string in1 = line.substr(aPos, line.find(" ", aPos) - aPos);
-    std::string in2 = line.substr(bPos, line.find(" ", bPos) - bPos);
-    std::string output = line.substr(yPos);
-    this->graph[output] = {in1, in2};
+void BlifParser::parseLine(const std::vector<std::string>& tokens) {
+  auto& keyword = tokens[0];
+  if (keyword == ".inputs") {
+    for (size_t i = 1; i < tokens.size(); i++) {
+      auto& input = tokens[i];
+      if (not input.starts_with("monitor[") and not input.starts_with("system["))
+        throw std::invalid_argument("Unexpected BLIF input: " + input);
+      // Inputs are indexed manually.
+      // ASSUMPTION: Monitor inputs always come before system inputs.
+      // So, line looks like:
+      // .inputs monitor[0] ... monitor[n] system[0] ... system[m]
+      bool isMonitor = input.starts_with("monitor[");
+      if (isMonitor and this->systemStateLength > 0)
+        throw std::invalid_argument(
+          "BLIF monitor input after system inputs: " + input);
+      auto index = this->monitorStateLength + this->systemStateLength;
+      this->monitorStateLength += isMonitor;
+      this->systemStateLength += not isMonitor;
+      this->defineWire(this->internWire(input), WireKind::INPUT, index);
+    }
+  } else if (keyword == ".outputs") {
+    // At this stage, we can't do anything special with the outputs.
+    // We only know that all output signals are named out[i], for some i.
+    for (size_t i = 1; i < tokens.size(); i++) {
+      if (not tokens[i].starts_with("out["))
+        throw std::invalid_argument("Unexpected BLIF output: " + tokens[i]);
+      this->outputLength++;
+    }
+  } else if (keyword == ".conn") {
+    // ".conn first second" drives `second` with `first`.
+    if (tokens.size() != 3)
+      throw std::invalid_argument("BLIF .conn takes two wires");
+    auto first = this->internWire(tokens[1]);
+    this->defineWire(this->internWire(tokens[2]), WireKind::ALIAS, first);
+  } else if (keyword == ".subckt") {
+    this->parseGate(tokens);
   }
+  // Other lines (.model, .end, comments) carry no wires.
 }
 
-void BlifParser::buildCircuit(Circuit& circuit) {
-  // The goal is to build all output wires;
-  // so we start from the outputs and traverse backwards.
-  for (unsigned i = 0; i < this->outputLength; i++) {
-    std::string output = "out[" + std::to_string(i) + "]";
-    buildWire(output, circuit);
+void BlifParser::parseGate(const std::vector<std::string>& tokens) {
+  // Lines look like ".subckt $_NAND_ A=in1 B=in2 Y=output";
+  // NOT gates have no B input.
+  static const std::unordered_map<std::string, GateType> cellTypes = {
+    {"$_NAND_", GateType::NAND}, {"$_AND_", GateType::AND},
+    {"$_OR_", GateType::OR}, {"$_XOR_", GateType::XOR},
+    {"$_XNOR_", GateType::XNOR}, {"$_NOT_", GateType::NOT},
+  };
+  if (tokens.size() < 2)
+    throw std::invalid_argument("Missing BLIF cell name");
+  auto& cell = tokens[1];
+  auto cellType = cellTypes.find(cell);
+  if (cellType == cellTypes.end())
+    throw std::invalid_argument("Unsupported BLIF cell: " + cell);
+  auto type = cellType->second;
+  uint32_t pins[3] = { NO_DRIVER, NO_DRIVER, NO_DRIVER };
+  for (size_t i = 2; i < tokens.size(); i++) {
+    auto& pin = tokens[i];
+    if (pin.size() < 2 or pin[1] != '=')
+      throw std::invalid_argument("Invalid BLIF pin: " + pin);
+    auto wire = this->internWire(pin.substr(2));
+    switch (pin[0]) {
+      case 'A': pins[0] = wire; break;
+      case 'B': pins[1] = wire; break;
+      case 'Y': pins[2] = wire; break;
+      default: throw std::invalid_argument("Invalid BLIF pin: " + pin);
+    }
   }
+  // NOT(x) is stored as a gate with x as both of its inputs.
+  if (type == GateType::NOT)
+    pins[1] = pins[0];
+  if (pins[0] == NO_DRIVER or pins[1] == NO_DRIVER or pins[2] == NO_DRIVER)
+    throw std::invalid_argument("Missing pin of BLIF cell: " + cell);
+  this->defineWire(pins[2], WireKind::GATE, pins[0], pins[1], type);
 }
 
-void BlifParser::buildWire(std::string wire, Circuit& circuit) {
-  if (wireIndices.find(wire) != wireIndices.end()) return;
-  // If wire is not in the circuit, we should build it.
-  // First, we build all the wires connected to this wire.
-  for (auto& connected : this->graph[wire])
-    buildWire(connected, circuit);
-  // Now, we can build the wire.
-  // Alias wires always have one incoming wire,
-  // so we can distinguish them from other wires.
-  if (this->graph[wire].size() == 1) {
-    auto driver = graph[wire][0];
-    wireIndices[wire] = wireIndices[driver];
-  } else {
-    // printf("D: building gate for %s, ", wire.c_str());
-    // printf("inputs: ");
-    // for (auto& in : this->graph[wire])
-    //   printf("%s ", in.c_str());
-    // printf("\n");
-    assert (this->graph[wire].size() == 2);
-    auto in1 = this->graph[wire][0];
-    auto in2 = this->graph[wire][1];
-    auto in1Idx = wireIndices[in1];
-    auto in2Idx = wireIndices[in2];
-    auto wireIdx = circuit.addGate(in1Idx, in2Idx);
-    // printf("D: in1Idx = %d, in2Idx = %d, wireIdx = %d\n",
-    // in1Idx, in2Idx, wireIdx);
-    wireIndices[wire] = wireIdx;
+void BlifParser::buildWires(
+  const std::vector<uint32_t>& wires,
+  Circuit& circuit, std::vector<uint32_t>& driverIds)
+{
+  // A wire is visited (pushed) before its inputs,
+  // and built once all of its inputs are built.
+  // Wires being visited are ancestors of the top of the stack;
+  // so, reaching one again means a combinational loop.
+  enum class State : uint8_t { NEW, VISITING, BUILT };
+  std::vector<State> states(this->wireKinds.size(), State::NEW);
+  std::array<uint32_t, 2> constants = { NO_DRIVER, NO_DRIVER };
+  std::vector<uint32_t> stack(wires.rbegin(), wires.rend());
+  while (not stack.empty()) {
+    auto wire = stack.back();
+    if (states[wire] == State::BUILT) {
+      stack.pop_back();
+      continue;
+    }
+    states[wire] = State::VISITING;
+    auto kind = this->wireKinds[wire];
+    bool ready = true;
+    if (kind == WireKind::ALIAS or kind == WireKind::GATE) {
+      auto inputs = { this->wireLeft[wire], this->wireRight[wire] };
+      for (auto input : inputs) {
+        if (input == NO_DRIVER or states[input] == State::BUILT)
+          continue;
+        if (states[input] == State::VISITING)
+          throw std::invalid_argument(
+            "Combinational loop at BLIF wire " + *this->wireNames[input]);
+        stack.push_back(input);
+        ready = false;
+      }
+    }
+    if (not ready)
+      continue;
+
+    auto left = this->wireLeft[wire];
+    switch (kind) {
+      case WireKind::UNDEFINED:
+        throw std::invalid_argument(
+          "Undriven BLIF wire: " + *this->wireNames[wire]);
+      case WireKind::INPUT:
+        driverIds[wire] = left;
+        break;
+      case WireKind::CONSTANT:
+        // Constants are derived from the first input, when needed.
+        if (constants[left] == NO_DRIVER and left) {
+          auto one = One(0);
+          one.build(circuit);
+          constants[1] = one;
+        } else if (constants[left] == NO_DRIVER) {
+          auto zero = Zero(0);
+          zero.build(circuit);
+          constants[0] = zero;
+        }
+        driverIds[wire] = constants[left];
+        break;
+      case WireKind::ALIAS:
+        driverIds[wire] = driverIds[left];
+        break;
+      case WireKind::GATE:
+        driverIds[wire] = circuit.addGate(
+          driverIds[left], driverIds[this->wireRight[wire]],
+          this->wireTypes[wire]);
+        break;
+    }
+    states[wire] = State::BUILT;
+    stack.pop_back();
   }
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include "StringUtils.hh"
@@ -24,7 +25,7 @@ std::string toString(const BigInt& n, int base) {
 std::string toString(const QuadraticResidueGroup& g) {
   return
     "QuadraticResidueGroup("
-    + toString(g.primeModulus) + ")";
+    + toString(g.context->primeModulus) + ")";
 }
 
 std::tuple<std::vector<BigInt>, std::string>
@@ -43,13 +44,23 @@ readBigInts(const std::string& message, int base, int count) {
 }
 
 std::tuple<std::vector<GarbledGate>, std::string>
-readGarbledGates(const std::string& message, int count) {
+readGarbledGates(const std::string& message, int count, int width) {
+  return readGarbledGates(message, std::vector<unsigned>(count, width));
+}
+
+std::tuple<std::vector<GarbledGate>, std::string>
+readGarbledGates(
+  const std::string& message, const std::vector<unsigned>& widths)
+{
   std::vector<GarbledGate> garbledGates;
   std::stringstream ss(message);
-  for (auto i = 0; i < count; i++) {
+  for (auto width : widths) {
     GarbledGate gate;
-    for (auto j = 0; j < 4; j++)
-      ss >> gate[j];
+    std::string hex;
+    for (unsigned j = 0; j < width; j++) {
+      ss >> hex;
+      gate[j] = Label::fromHex(hex);
+    }
     garbledGates.push_back(gate);
   }
   auto remaining = ss.str().substr(ss.tellg());
@@ -67,6 +78,19 @@ readStrings(const std::string& message, int count) {
   return { strings, remaining };
 }
 
+std::tuple<std::vector<Label>, std::string>
+readLabels(const std::string& message, int count) {
+  std::vector<Label> labels(count);
+  std::stringstream ss(message);
+  std::string hex;
+  for (auto i = 0; i < count; i++) {
+    ss >> hex;
+    labels[i] = Label::fromHex(hex);
+  }
+  auto remaining = ss.str().substr(ss.tellg());
+  return { labels, remaining };
+}
+
 HexGeneratorState::HexGeneratorState() {
   urandom.open("/dev/urandom", std::ios::in | std::ios::binary);
   if (!urandom)
@@ -81,13 +105,10 @@ HexGeneratorState::~HexGeneratorState() {
 
 HexGeneratorState SingletonHexGeneratorState;
 
-std::string randomHexString(unsigned size) {
-  std::ostringstream hexStream;
-  hexStream << std::hex << std::setfill('0');
-
+void randomBytes(unsigned char* out, size_t length) {
   HexGeneratorState& state = SingletonHexGeneratorState;
 
-  size_t remaining = size;
+  size_t remaining = length;
   while (remaining > 0) {
     if (state.bufferPos == state.buffer.size()) {
       Timer timer;
@@ -101,15 +122,19 @@ std::string randomHexString(unsigned size) {
 
     size_t bytesToRead =
       std::min(remaining, state.buffer.size() - state.bufferPos);
-    for (size_t i = 0; i < bytesToRead; ++i) {
-      hexStream
-        << std::setw(2)
-        << static_cast<int>(state.buffer[state.bufferPos + i]);
-    }
-
+    std::copy_n(state.buffer.data() + state.bufferPos, bytesToRead, out);
+    out += bytesToRead;
     state.bufferPos += bytesToRead;
     remaining -= bytesToRead;
   }
+}
 
+std::string randomHexString(unsigned size) {
+  std::vector<unsigned char> bytes(size);
+  randomBytes(bytes.data(), size);
+  std::ostringstream hexStream;
+  hexStream << std::hex << std::setfill('0');
+  for (auto byte : bytes)
+    hexStream << std::setw(2) << static_cast<int>(byte);
   return hexStream.str();
 }
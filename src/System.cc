@@ -5,8 +5,14 @@
 #include "Y.hh"
 #include "MathUtils.hh"
 #include "MonitorableSystem.hh"
+#include "QuadraticResidueGroup.hh"
+#include "EllipticCurveGroup.hh"
 #include "Shake256YaoGarbler.hh"
+#include "HalfGatesGarbler.hh"
+#include "PointAndPermuteGarbler.hh"
 #include "CommandLineInterface.hh"
+#include "StringUtils.hh"
+#include "WireFormat.hh"
 
 namespace L = LWY;
 
@@ -32,11 +38,32 @@ int main(int argc, char* argv[]) {
 
   // ONE-TIME MESSAGE:
   // System receives gateCount from Monitor,
-  // formatted as a decimal number.
-  unsigned gateCount = std::stoul(messageHandler.recv());
-  printf("I: received gate count %d\n", gateCount);
+  // formatted as a decimal number, and followed by
+  // the name of the wire format of all later messages
+  // (if missing, text), and by the number of gates
+  // per message of garbled gates (if missing, 0).
+  auto handshake = split(messageHandler.recv());
+  assert (not handshake.empty());
+  unsigned gateCount = std::stoul(handshake[0]);
+  auto wireFormat = handshake.size() > 1
+    ? parseWireFormat(handshake[1])
+    : WireFormat::TEXT;
+  unsigned streamChunkSize = handshake.size() > 2
+    ? std::stoul(handshake[2])
+    : 0;
+  printf("I: received gate count %d (%s wire format, %u gates per message)\n",
+    gateCount, wireFormatName(wireFormat), streamChunkSize);
 
-  auto garbler = Shake256YaoGarbler();
+  std::unique_ptr<YaoGarbler> garbler;
+  if (params.garbling == GarblingScheme::HALF_GATES)
+    garbler = std::make_unique<HalfGatesGarbler>(
+      params.securityParameter >> 2);
+  else if (params.garbling == GarblingScheme::POINT_AND_PERMUTE)
+    garbler = std::make_unique<PointAndPermuteGarbler>();
+  else
+    garbler = std::make_unique<Shake256YaoGarbler>();
+  auto threadPool = ThreadPool(params.threadCount);
+  printf("I: using %u threads\n", threadPool.size());
 
   switch (params.protocol) {
     case ProtocolType::YAO: {
@@ -52,14 +79,24 @@ int main(int argc, char* argv[]) {
         .gateCount          = gateCount,
         .monitorStateLength = params.monitorStateLength,
         .systemStateLength  = params.systemStateLength,
-        .garbler            = &garbler,
-        .securityParameter  = params.securityParameter
+        .garbler            = garbler.get(),
+        .securityParameter  = params.securityParameter,
+        .threadPool         = &threadPool,
+        .streamChunkSize    = streamChunkSize,
+        .wireFormat         = wireFormat
       };
       auto interface = Y::SystemInterface(
         &parameters, &monitorMemory, &messageHandler);
       interface.run();
       break;
     } case ProtocolType::LWY: {
+      GroupPtr group;
+      if (params.group == GroupType::EC)
+        group = std::make_shared<EllipticCurveGroup>(
+          EllipticCurveGroup::curveFor(params.securityParameter));
+      else
+        group = std::make_shared<QuadraticResidueGroup>(primeModulus);
+      group->precomputeBaseGenerator(params.tableFileName);
       auto monitorMemory = L::SystemMemory {
         .system = cli.system.get(),
       };
@@ -67,9 +104,12 @@ int main(int argc, char* argv[]) {
         .gateCount          = gateCount,
         .monitorStateLength = params.monitorStateLength,
         .systemStateLength  = params.systemStateLength,
-        .group              = QuadraticResidueGroup(primeModulus),
-        .garbler            = &garbler,
-        .securityParameter  = params.securityParameter
+        .group              = group,
+        .garbler            = garbler.get(),
+        .securityParameter  = params.securityParameter,
+        .threadPool         = &threadPool,
+        .streamChunkSize    = streamChunkSize,
+        .wireFormat         = wireFormat
       };
       auto interface = L::SystemInterface(
         &parameters, &monitorMemory, &messageHandler);
@@ -1,16 +1,44 @@
+#include <unistd.h>
 #include <cassert>
+#include <deque>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
 #include "QuadraticResidueGroup.hh"
+#include "EllipticCurveGroup.hh"
 #include "BigInt.hh"
 #include "Sha512YaoGarbler.hh"
 #include "Shake256YaoGarbler.hh"
+#include "HalfGatesGarbler.hh"
+#include "PointAndPermuteGarbler.hh"
 #include "MathUtils.hh"
 #include "StringUtils.hh"
 #include "Module.hh"
+#include "BitSlicedEvaluator.hh"
+#include "CircuitCache.hh"
+#include "CircuitOptimizer.hh"
+#include "CircuitProfiler.hh"
+#include "CostEstimator.hh"
+#include "BM.hh"
+#include "LWY.hh"
+#include "Y.hh"
+#include "TraceSimulator.hh"
+#include "ThreadPool.hh"
+#include "WireFormat.hh"
+#include "Exceptions.hh"
 #include "SpecToCircuitConverter.hh"
 
 using namespace std;
 
+// Files of a test run are named after its process,
+// so that concurrent runs do not overwrite each other's.
+string tempFileName(const string& suffix) {
+  return "/tmp/ppm-test-" + to_string(getpid()) + suffix;
+}
+
 // TODO: integrate a testing framework.
 void testQR() {
   BigInt p(11);
@@ -32,33 +60,148 @@ void testQR() {
   printf(
     "Using a=9, b=3, a*b = %s\n",
     toString(result).c_str());
+
+  // Batched exponentiation agrees with exp(), on any thread count.
+  std::vector<BigInt> exponents;
+  std::vector<ExpJob> jobs;
+  for (int i = 1; i <= 100; i++)
+    exponents.push_back(BigInt(i));
+  for (auto& e : exponents)
+    jobs.push_back({ &g, &e });
+  auto pool = ThreadPool(3);
+  for (auto batchPool : { (ThreadPool*) nullptr, &pool }) {
+    auto results = group.expBatch(jobs, batchPool);
+    for (unsigned i = 0; i < jobs.size(); i++)
+      assert (results[i] == group.exp(g, exponents[i]));
+  }
+  printf("%zu batched exponentiations OK\n", jobs.size());
+
+  // Pairs of fixed exponents agree with exp() as well.
+  auto bigGroup = QuadraticResidueGroup(getSafePrime(1024));
+  std::array<BigInt, 2> pair = {
+    bigGroup.randomExponent(), bigGroup.randomExponent() };
+  std::vector<BigInt> bases;
+  for (int i = 0; i < 20; i++)
+    bases.push_back(bigGroup.randomGenerator());
+  std::vector<const BigInt*> basePointers;
+  for (auto& base : bases)
+    basePointers.push_back(&base);
+  for (auto exponents : { pair, std::array<BigInt, 2>{ 0, 1 } }) {
+    auto powers = bigGroup.expPairBatch(basePointers, exponents, &pool);
+    for (unsigned i = 0; i < bases.size(); i++)
+      for (unsigned e = 0; e < 2; e++)
+        assert (powers[i][e] == bigGroup.exp(bases[i], exponents[e]));
+  }
+  printf("%zu exponentiation pairs OK\n", bases.size());
+}
+
+void testFixedBase() {
+  printf("==== Testing fixed-base exponentiation ====\n");
+  auto group = QuadraticResidueGroup(getSafePrime(1024));
+  auto g = group.baseGenerator;
+  std::vector<BigInt> exponents = {
+    BigInt(0), BigInt(1), BigInt(63), BigInt(64), group.order() - 1 };
+  for (int i = 0; i < 20; i++)
+    exponents.push_back(group.randomExponent());
+  group.precomputeFixedBase(g);
+  for (auto& e : exponents)
+    assert (group.expFixedBase(g, e) == group.exp(g, e));
+
+  // Saved tables can be loaded by a copy of the same group only.
+  auto tableFileName = tempFileName(".tables");
+  assert (group.saveFixedBaseTables(tableFileName));
+  auto loaded = QuadraticResidueGroup(getSafePrime(1024));
+  assert (loaded.loadFixedBaseTables(tableFileName));
+  for (auto& e : exponents)
+    assert (loaded.expFixedBase(g, e) == group.exp(g, e));
+  auto other = QuadraticResidueGroup(getSafePrime(768));
+  assert (not other.loadFixedBaseTables(tableFileName));
+  // Files cut off anywhere, even within a number, are rejected.
+  std::ifstream tableFile(tableFileName);
+  std::string contents(
+    (std::istreambuf_iterator<char>(tableFile)),
+    std::istreambuf_iterator<char>());
+  for (auto length : { contents.size() / 2, contents.size() - 6 }) {
+    std::ofstream(tableFileName) << contents.substr(0, length);
+    auto truncated = QuadraticResidueGroup(getSafePrime(1024));
+    assert (not truncated.loadFixedBaseTables(tableFileName));
+  }
+  remove(tableFileName.c_str());
+  printf("%zu fixed-base exponentiations OK\n", exponents.size());
+}
+
+void testEllipticCurve() {
+  printf("==== Testing elliptic-curve group ====\n");
+  auto group = EllipticCurveGroup(EllipticCurveGroup::curveFor(3072));
+  auto g = group.baseGenerator;
+  auto a = group.randomExponent();
+  auto b = group.randomExponent();
+  auto ga = group.exp(g, a);
+  auto gb = group.expFixedBase(g, b);
+  assert (gb == group.exp(g, b));
+  assert (group.mul(ga, gb) == group.exp(g, a + b));
+  assert (group.exp(ga, b) == group.exp(gb, a));
+  assert (group.mul(ga, group.inv(ga)) == 0);
+  assert (group.exp(g, group.order()) == 0);
+  assert (toString(ga, 16).size() <= group.elementHexLength());
+
+  auto pool = ThreadPool(2);
+  std::vector<ExpJob> jobs = { { &g, &a }, { &ga, &b } };
+  auto results = group.expBatch(jobs, &pool);
+  assert (results[0] == ga and results[1] == group.exp(ga, b));
+  auto pairs = group.expPairBatch({ &g, &ga }, { a, b }, &pool);
+  assert (pairs[0][0] == ga and pairs[0][1] == gb);
+  assert (pairs[1][1] == group.exp(ga, b));
+  printf("P-256 elements take %u hex digits\n", group.elementHexLength());
+}
+
+void testLabel() {
+  printf("==== Testing binary labels ====\n");
+  auto a = Label::fromHex("0123456789abcdef0123456789abcdef");
+  assert (a.size() == 16 and a.blockCount() == 1);
+  assert (a.toHex() == "0123456789abcdef0123456789abcdef");
+  // Odd-length hex strings get a leading zero.
+  assert (Label::fromHex("abc").toHex() == "0abc");
+  auto b = Label::random(16);
+  assert ((a ^ b ^ b) == a);
+  assert ((a ^ a) == Label(16));
+  assert (a != b);
+  // Long labels (e.g., group elements) are stored on the heap.
+  auto c = Label::random(100);
+  auto d = c;
+  assert (c.blockCount() == 7 and d == c);
+  d.setLsb(not d.lsb());
+  assert (d != c and (c ^ d).slice(0, 99) == Label(99));
+  auto e = std::move(d);
+  assert (d.empty() and e.size() == 100);
+  printf("- %s\n", b.toHex().c_str());
 }
 
 void testGarblerSha512() {
   auto garbler = Sha512YaoGarbler();
-  LabelPair leftp = {"012", "345"};
-  LabelPair rightp = {"678", "9ab"};
-  LabelPair outp = {"cde", "f01"};
+  LabelPair leftp = {Label::fromHex("012"), Label::fromHex("345")};
+  LabelPair rightp = {Label::fromHex("678"), Label::fromHex("9ab")};
+  LabelPair outp = {Label::fromHex("cde"), Label::fromHex("f01")};
 
   printf(
     "Using leftp=[%s,%s], rightp=[%s,%s], outp=[%s,%s]:\n",
-    leftp[0].c_str(), leftp[1].c_str(),
-    rightp[0].c_str(), rightp[1].c_str(),
-    outp[0].c_str(), outp[1].c_str()
+    leftp[0].toHex().c_str(), leftp[1].toHex().c_str(),
+    rightp[0].toHex().c_str(), rightp[1].toHex().c_str(),
+    outp[0].toHex().c_str(), outp[1].toHex().c_str()
   );
 
   auto gate =
     garbler.enc(leftp, rightp, outp);
   printf(
     "- gate=[%s,%s,%s,%s]\n",
-    gate[0].c_str(), gate[1].c_str(),
-    gate[2].c_str(), gate[3].c_str()
+    gate[0].toHex().c_str(), gate[1].toHex().c_str(),
+    gate[2].toHex().c_str(), gate[3].toHex().c_str()
   );
 
   auto label =
     garbler.dec(leftp[1], rightp[0], gate);
   assert(label == outp[1]);
-  printf("- label=%s\n", label.c_str());
+  printf("- label=%s\n", label.toHex().c_str());
 }
 
 struct IncGenerator {
@@ -69,33 +212,87 @@ struct IncGenerator {
 
 void testGarblerShake256() {
   auto garbler = Shake256YaoGarbler();
-  LabelPair leftp = {"012", "345"};
-  LabelPair rightp = {"678", "9ab"};
-  LabelPair outp = {"cde", "f01"};
+  LabelPair leftp = {Label::fromHex("012"), Label::fromHex("345")};
+  LabelPair rightp = {Label::fromHex("678"), Label::fromHex("9ab")};
+  LabelPair outp = {Label::fromHex("cde"), Label::fromHex("f01")};
 
   printf(
     "Using leftp=[%s,%s], rightp=[%s,%s], outp=[%s,%s]:\n",
-    leftp[0].c_str(), leftp[1].c_str(),
-    rightp[0].c_str(), rightp[1].c_str(),
-    outp[0].c_str(), outp[1].c_str()
+    leftp[0].toHex().c_str(), leftp[1].toHex().c_str(),
+    rightp[0].toHex().c_str(), rightp[1].toHex().c_str(),
+    outp[0].toHex().c_str(), outp[1].toHex().c_str()
   );
 
   auto gate =
     garbler.enc(leftp, rightp, outp);
   printf(
     "- gate=[%s,%s,%s,%s]\n",
-    gate[0].c_str(), gate[1].c_str(),
-    gate[2].c_str(), gate[3].c_str()
+    gate[0].toHex().c_str(), gate[1].toHex().c_str(),
+    gate[2].toHex().c_str(), gate[3].toHex().c_str()
   );
 
   auto label =
     garbler.dec(leftp[1], rightp[0], gate);
   assert(label == outp[1]);
-  printf("- label=%s\n", label.c_str());
+  printf("- label=%s\n", label.toHex().c_str());
 }
 
 unsigned IncGenerator::current_ = 0;
 
+void testGarblerPointAndPermute() {
+  printf("==== Testing point-and-permute garbler ====\n");
+  auto garbler = PointAndPermuteGarbler();
+  // Labels of the garbler itself, and labels from elsewhere
+  // (e.g., group elements), which only differ in a higher bit.
+  auto other = Label::random(40);
+  auto otherFlipped = other;
+  otherFlipped.data()[20] ^= 0x10;
+  std::vector<LabelPair> pairs = {
+    garbler.randomLabelPair(32), { other, otherFlipped } };
+  for (auto& leftp : pairs)
+    for (auto& rightp : pairs) {
+      auto outp = garbler.randomLabelPair(16);
+      auto gate = garbler.enc(leftp, rightp, outp, 3);
+      for (unsigned a = 0; a < 2; a++)
+        for (unsigned b = 0; b < 2; b++) {
+          auto label = garbler.dec(leftp[a], rightp[b], gate, 3);
+          assert (label == outp[not (a and b)]);
+        }
+    }
+  printf("- all input combinations decode correctly\n");
+}
+
+void testGarblerHalfGates() {
+  printf("==== Testing half-gates garbler ====\n");
+  auto garbler = HalfGatesGarbler(32);
+  auto leftp = garbler.randomLabelPair(32);
+  auto rightp = garbler.randomLabelPair(32);
+  LabelPair outp;
+  auto gate = garbler.enc(leftp, rightp, outp, 7);
+  printf("- gate=[%s,%s]\n", gate[0].toHex().c_str(), gate[1].toHex().c_str());
+  // Output labels share the global offset of the input labels.
+  auto offset = leftp[0] ^ leftp[1];
+  assert ((outp[0] ^ outp[1]) == offset);
+  assert ((rightp[0] ^ rightp[1]) == offset);
+  for (unsigned a = 0; a < 2; a++)
+    for (unsigned b = 0; b < 2; b++) {
+      auto label = garbler.dec(leftp[a], rightp[b], gate, 7);
+      assert (label == outp[not (a and b)]);
+    }
+
+  // Gates are chained: the output of one is the input of the next.
+  LabelPair nextp;
+  auto next = garbler.enc(outp, leftp, nextp, 8);
+  for (unsigned a = 0; a < 2; a++)
+    for (unsigned b = 0; b < 2; b++) {
+      auto nand = not (a and b);
+      auto label = garbler.dec(
+        garbler.dec(leftp[a], rightp[b], gate, 7), leftp[a], next, 8);
+      assert (label == nextp[not (nand and a)]);
+    }
+  printf("- all input combinations decode correctly\n");
+}
+
 void testModule() {
   printf("==== Testing add+compare circuit ====\n");
   vector<bool> valA = {0, 1, 0, 1, 0, 1, 1, 0}; // 106
@@ -139,6 +336,20 @@ void testModule() {
   cout << "}\n";
   assert (output == (vector<bool> {0, 1}));
   cout << "circuit size: " << circuit.size() << '\n';
+  auto levelization = circuit.levelize();
+  for (unsigned k = 1; k <= levelization.depth(); k++) {
+    auto level = levelization.level(k);
+    for (auto i = level.begin; i < level.end; i++) {
+      auto id = levelization.order[i];
+      auto& levels = levelization.levels;
+      assert (levels[id] == k);
+      assert (levels[circuit.inputLeft(id)] < k);
+      assert (levels[circuit.inputRight(id)] < k);
+    }
+  }
+  assert (levelization.order.size() == circuit.gateCount());
+  printf("circuit depth: %u, max. width: %u\n",
+    levelization.depth(), levelization.maxWidth());
 
   printf("==== Testing select circuit ====\n");
   IncGenerator::current_ = 0;
@@ -178,6 +389,1156 @@ void testModule() {
   cout << "circuit size: " << circuit.size() << '\n';
 }
 
+// Builds `build` on a circuit whose inputs are `inputLength` bits,
+// and prints its gate count and depth.
+template <typename Build>
+Circuit buildVariant(
+  const char* name, unsigned inputLength, unsigned outputLength, Build build)
+{
+  auto circuit = Circuit(inputLength, outputLength);
+  IncGenerator::current_ = 0;
+  circuit.updateOutputs(build(circuit));
+  printf("- %-26s %5u gates, depth %3u\n",
+    name, circuit.gateCount(), circuit.levelize().depth());
+  return circuit;
+}
+
+ValueWord toBits(uint64_t value, unsigned length) {
+  ValueWord bits(length);
+  for (unsigned i = 0; i < length; i++)
+    bits[i] = (value >> i) & 1;
+  return bits;
+}
+
+uint64_t fromBits(ValueWord bits) {
+  uint64_t value = 0;
+  for (unsigned i = 0; i < bits.size(); i++)
+    value |= uint64_t(bits[i]) << i;
+  return value;
+}
+
+void testModuleVariants() {
+  printf("==== Testing adder, comparator and selector variants ====\n");
+  std::vector<std::pair<const char*, AdderType>> adderTypes = {
+    { "ripple", AdderType::RIPPLE },
+    { "Kogge-Stone", AdderType::KOGGE_STONE },
+    { "Brent-Kung", AdderType::BRENT_KUNG },
+    { "Sklansky", AdderType::SKLANSKY },
+  };
+  std::vector<std::pair<const char*, ComparatorType>> comparatorTypes = {
+    { "linear", ComparatorType::LINEAR },
+    { "tree", ComparatorType::TREE },
+  };
+  std::vector<std::pair<const char*, SelectorType>> selectorTypes = {
+    { "mux", SelectorType::MUX },
+    { "XOR mux", SelectorType::XOR_MUX },
+    { "decoder", SelectorType::DECODER },
+  };
+  srand(timeBasedSeed());
+  // rand() draws 31 bits only; words of 32 bits need all of theirs
+  // to reach the top carries and the most significant comparisons.
+  std::mt19937_64 random(timeBasedSeed());
+  // Inputs: left word, right word, carry in.
+  for (unsigned length : { 1, 2, 3, 5, 7, 8, 32 }) {
+    uint64_t mask = (uint64_t(1) << length) - 1;
+    printf("%u-bit words:\n", length);
+    for (auto [name, type] : adderTypes) {
+      auto label = std::string(name) + " adder";
+      auto circuit = buildVariant(
+        label.c_str(), 2 * length + 1, length + 1, [&](Circuit& circuit) {
+          Word inA(length), inB(length);
+          IncGenerator gen;
+          generate(inA.begin(), inA.end(), gen);
+          generate(inB.begin(), inB.end(), gen);
+          auto adder = Adder(inA, inB, 2 * length, type);
+          adder.build(circuit);
+          return Word(adder);
+        });
+      bool exhaustive = length <= 7;
+      unsigned count = exhaustive ? 1U << (2 * length + 1) : 1000;
+      for (unsigned k = 0; k < count; k++) {
+        uint64_t a = (exhaustive ? k : random()) & mask;
+        uint64_t b = (exhaustive ? k >> length : random()) & mask;
+        bool c = (exhaustive ? k >> (2 * length) : random()) & 1;
+        auto input = toBits(a, length);
+        auto bitsB = toBits(b, length);
+        input.insert(input.end(), bitsB.begin(), bitsB.end());
+        input.push_back(c);
+        assert (fromBits(circuit.evaluate(input)) == a + b + c);
+      }
+    }
+    for (auto [name, type] : comparatorTypes) {
+      auto label = std::string(name) + " eq/lt checkers";
+      auto circuit = buildVariant(
+        label.c_str(), 2 * length, 2, [&](Circuit& circuit) {
+          Word inA(length), inB(length);
+          IncGenerator gen;
+          generate(inA.begin(), inA.end(), gen);
+          generate(inB.begin(), inB.end(), gen);
+          auto eq = EqChecker(inA, inB, type);
+          auto lt = LtChecker(inA, inB, type);
+          eq.build(circuit);
+          lt.build(circuit);
+          return Word { eq, lt };
+        });
+      for (unsigned k = 0; k < 1000; k++) {
+        uint64_t a = random() & mask;
+        // Equal words, and words that differ in a single bit,
+        // are frequent enough to be tested.
+        uint64_t b = random() & mask;
+        if (k % 4 == 0)
+          b = a;
+        else if (k % 4 == 1)
+          b = a ^ (uint64_t(1) << (random() % length));
+        auto input = toBits(a, length);
+        auto bitsB = toBits(b, length);
+        input.insert(input.end(), bitsB.begin(), bitsB.end());
+        auto output = circuit.evaluate(input);
+        assert (output[0] == (a == b));
+        assert (output[1] == (a < b));
+      }
+    }
+  }
+  // Inputs: 2^s words of 8 bits, then s select bits.
+  for (unsigned selectLength : { 1, 2, 3, 5 }) {
+    unsigned wordLength = 8;
+    unsigned wordCount = 1U << selectLength;
+    printf("%u words of %u bits:\n", wordCount, wordLength);
+    for (auto [name, type] : selectorTypes) {
+      auto label = std::string(name) + " selector";
+      auto circuit = buildVariant(
+        label.c_str(), wordCount * wordLength + selectLength, wordLength,
+        [&](Circuit& circuit) {
+          IncGenerator gen;
+          WordVector words(wordCount, Word(wordLength));
+          for (auto& word : words)
+            generate(word.begin(), word.end(), gen);
+          Word select(selectLength);
+          generate(select.begin(), select.end(), gen);
+          auto selector = Selector(words, select, type);
+          selector.build(circuit);
+          return Word(selector);
+        });
+      for (unsigned k = 0; k < 100; k++) {
+        std::vector<uint64_t> values(wordCount);
+        ValueWord input;
+        for (auto& value : values) {
+          value = rand() & 0xff;
+          auto bits = toBits(value, wordLength);
+          input.insert(input.end(), bits.begin(), bits.end());
+        }
+        auto index = rand() % wordCount;
+        auto bits = toBits(index, selectLength);
+        input.insert(input.end(), bits.begin(), bits.end());
+        assert (fromBits(circuit.evaluate(input)) == values[index]);
+      }
+    }
+  }
+}
+
+void testBitSliced() {
+  printf("==== Testing bit-sliced evaluation ====\n");
+  unsigned wordLength = 8;
+  auto circuit = Circuit(3 * wordLength, 2);
+  Word inA(wordLength);
+  Word inB(wordLength);
+  Word inC(wordLength);
+  IncGenerator::current_ = 0;
+  IncGenerator gen;
+  generate(inA.begin(), inA.end(), gen);
+  generate(inB.begin(), inB.end(), gen);
+  generate(inC.begin(), inC.end(), gen);
+  auto zero = Zero(0);
+  zero.build(circuit);
+  auto adder = Adder(inA, inB, zero);
+  adder.build(circuit);
+  auto eq = EqChecker(adder.sum(), inC);
+  auto lt = LtChecker(adder.sum(), inC);
+  eq.build(circuit);
+  lt.build(circuit);
+  circuit.updateOutputs({eq, lt});
+
+  // More inputs than lanes, to also cover a partial last batch.
+  unsigned inputCount = 1000;
+  vector<ValueWord> inputs(inputCount, ValueWord(3 * wordLength));
+  srand(timeBasedSeed());
+  for (auto& input : inputs)
+    for (unsigned i = 0; i < input.size(); i++)
+      input[i] = rand() & 1;
+  auto evaluator = BitSlicedEvaluator(circuit);
+  auto outputs = evaluator.evaluate(inputs);
+  printf("native slice width: %u bits\n",
+    64 * BitSlicedEvaluator::nativeWords());
+  for (unsigned k = 0; k < inputCount; k++)
+    assert (outputs[k] == circuit.evaluate(inputs[k]));
+  // Every slice width gives the same result.
+  for (unsigned words : {1, 4, 8}) {
+    vector<uint64_t> sliced(3 * wordLength * words, 0);
+    for (unsigned k = 0; k < 64 * words; k++)
+      for (unsigned i = 0; i < 3 * wordLength; i++)
+        sliced[i * words + k / 64] |= uint64_t(inputs[k][i]) << (k % 64);
+    vector<uint64_t> out(2 * words);
+    evaluator.evaluateSliced(sliced.data(), out.data(), words);
+    for (unsigned k = 0; k < 64 * words; k++)
+      for (unsigned o = 0; o < 2; o++)
+        assert (((out[o * words + k / 64] >> (k % 64)) & 1) == outputs[k][o]);
+  }
+  printf("%u inputs evaluated\n", inputCount);
+}
+
+void testGateTypes() {
+  printf("==== Testing gate types ====\n");
+  // Every garbler garbles every gate type.
+  auto shake = Shake256YaoGarbler();
+  auto permute = PointAndPermuteGarbler();
+  auto halfGates = HalfGatesGarbler(16);
+  vector<YaoGarbler*> garblers = { &shake, &permute, &halfGates };
+  for (auto garbler : garblers)
+    for (unsigned t = 0; t < GATE_TYPE_COUNT; t++) {
+      auto type = static_cast<GateType>(t);
+      auto leftp = garbler->randomLabelPair(16);
+      auto rightp = type == GateType::NOT
+        ? leftp : garbler->randomLabelPair(16);
+      auto outp = garbler->randomLabelPair(16);
+      auto gate = garbler->enc(leftp, rightp, outp, 5, type);
+      for (unsigned a = 0; a < 2; a++)
+        for (unsigned b = 0; b < 2; b++) {
+          if (type == GateType::NOT and a != b)
+            continue;
+          auto label = garbler->dec(leftp[a], rightp[b], gate, 5, type);
+          assert (label == outp[evaluateGate(type, a, b)]);
+        }
+    }
+  assert (halfGates.ciphertextCount(GateType::XOR) == 0);
+  assert (halfGates.ciphertextCount(GateType::AND) == 2);
+  printf("- all garblers decode all gate types\n");
+
+  // Lowering to NAND gates keeps the function of a circuit.
+  unsigned wordLength = 8;
+  auto circuit = Circuit(2 * wordLength, wordLength + 1);
+  Word inA(wordLength);
+  Word inB(wordLength);
+  IncGenerator::current_ = 0;
+  IncGenerator gen;
+  generate(inA.begin(), inA.end(), gen);
+  generate(inB.begin(), inB.end(), gen);
+  auto zero = Zero(0);
+  zero.build(circuit);
+  auto adder = Adder(inA, inB, zero);
+  adder.build(circuit);
+  auto out = Identity(adder);
+  out.build(circuit);
+  circuit.updateOutputs(out);
+  auto nand = circuit.toNand();
+  assert (nand.gateCount(GateType::NAND) == nand.gateCount());
+  for (unsigned t = 0; t < GATE_TYPE_COUNT; t++) {
+    auto type = static_cast<GateType>(t);
+    printf("%s: %u ", gateTypeName(type), circuit.gateCount(type));
+  }
+  printf("\n%u gates, %u after lowering to NAND\n",
+    circuit.gateCount(), nand.gateCount());
+  srand(timeBasedSeed());
+  for (unsigned k = 0; k < 100; k++) {
+    ValueWord input(2 * wordLength);
+    for (unsigned i = 0; i < input.size(); i++)
+      input[i] = rand() & 1;
+    assert (nand.evaluate(input) == circuit.evaluate(input));
+  }
+  printf("- lowered circuit is equivalent\n");
+}
+
+void testOptimizer() {
+  printf("==== Testing circuit optimizer ====\n");
+  unsigned wordLength = 8;
+  auto circuit = Circuit(2 * wordLength, wordLength + 4);
+  Word inA(wordLength);
+  Word inB(wordLength);
+  IncGenerator::current_ = 0;
+  IncGenerator gen;
+  generate(inA.begin(), inA.end(), gen);
+  generate(inB.begin(), inB.end(), gen);
+  // A constant carry, a duplicate sum, a double negation,
+  // and a comparison that no output depends on.
+  auto zero = Zero(0);
+  zero.build(circuit);
+  auto adder = Adder(inA, inB, zero);
+  adder.build(circuit);
+  auto again = XorGate(inA, inB);
+  again.build(circuit);
+  auto inv = Inverter(again);
+  inv.build(circuit);
+  auto invInv = Inverter(Word(inv));
+  invInv.build(circuit);
+  auto unused = LtChecker(inA, inB);
+  unused.build(circuit);
+  Word outputs = adder.sum();
+  // An input, a repeated output, and a gate driving other gates.
+  outputs.push_back(inA[0]);
+  outputs.push_back(invInv[1]);
+  outputs.push_back(invInv[1]);
+  outputs.push_back(again[2]);
+  circuit.updateOutputs(outputs);
+
+  auto optimizer = CircuitOptimizer(circuit);
+  auto optimized = optimizer.optimize();
+  auto& stats = optimizer.stats;
+  assert (stats.gatesBefore == circuit.gateCount());
+  assert (stats.gatesAfter == optimized.gateCount());
+  assert (stats.gatesAfter < stats.gatesBefore);
+  assert (stats.folded > 0 and stats.merged > 0);
+  assert (stats.doubleNegations > 0 and stats.dead > 0);
+  srand(timeBasedSeed());
+  for (unsigned k = 0; k < 100; k++) {
+    ValueWord input(2 * wordLength);
+    for (unsigned i = 0; i < input.size(); i++)
+      input[i] = rand() & 1;
+    auto output = circuit.evaluate(input);
+    assert (optimized.evaluate(input) == output);
+    assert (output[wordLength] == input[0]);
+  }
+  printf("- optimized circuit is equivalent\n");
+}
+
+void testOutputCopies() {
+  printf("==== Testing output copies ====\n");
+  // g = a & b drives h = g ^ a; outputs are g, h, a and h again;
+  // so, g, a and one h are copied.
+  auto circuit = Circuit(2, 4);
+  auto g = circuit.addGate(0, 1, GateType::AND);
+  auto h = circuit.addGate(g, 0, GateType::XOR);
+  circuit.updateOutputs({ g, h, 0, h });
+  assert (circuit.gateCount() == 2 + 3);
+  // Copies of gates are duplicates; a copy of an input is AND(x, x).
+  assert (circuit.gateCount(GateType::AND) == 3);
+  assert (circuit.gateCount(GateType::XOR) == 2);
+
+  // A NAND copy of a gate takes one NAND gate; an input takes two.
+  auto nand = circuit.toNand();
+  unsigned nandsOfGates = 2 + 4;
+  assert (nand.gateCount() == nandsOfGates + 1 + 2 + 1);
+  // With free XOR, the only AND gate is g itself.
+  auto xorCopies = circuit.withXorCopies();
+  assert (xorCopies.gateCount(GateType::AND) == 1);
+  for (unsigned k = 0; k < 4; k++) {
+    ValueWord input = { bool(k & 1), bool(k & 2) };
+    auto output = circuit.evaluate(input);
+    assert (output[0] == (input[0] and input[1]));
+    assert (output[1] == (output[0] != input[0]));
+    assert (output[2] == input[0] and output[3] == output[1]);
+    assert (nand.evaluate(input) == output);
+    assert (xorCopies.evaluate(input) == output);
+  }
+  printf("- %u NAND gates, %u AND gate with free XOR\n",
+    nand.gateCount(), xorCopies.gateCount(GateType::AND));
+}
+
+void testCircuitCache() {
+  printf("==== Testing circuit cache ====\n");
+  unsigned wordLength = 8;
+  auto circuit = Circuit(2 * wordLength, 1);
+  Word inA(wordLength);
+  Word inB(wordLength);
+  IncGenerator::current_ = 0;
+  IncGenerator gen;
+  generate(inA.begin(), inA.end(), gen);
+  generate(inB.begin(), inB.end(), gen);
+  auto lt = LtChecker(inA, inB);
+  lt.build(circuit);
+  circuit.updateOutputs(lt);
+
+  // Keys depend on the contents of both files.
+  auto specFileName = tempFileName("-cache.v");
+  auto scriptFileName = tempFileName("-cache.ys");
+  ofstream(specFileName) << "module Spec(); endmodule\n";
+  ofstream(scriptFileName) << "abc -g NAND\n";
+  auto key = CircuitCache::key(specFileName, scriptFileName);
+  ofstream(scriptFileName, ios::app) << "opt\n";
+  auto otherKey = CircuitCache::key(specFileName, scriptFileName);
+  assert (not key.empty() and key != otherKey);
+  assert (CircuitCache::key(tempFileName("-none"), scriptFileName).empty());
+
+  auto cacheDirectory = tempFileName("-cache");
+  auto cache = CircuitCache(cacheDirectory);
+  cache.store(key, circuit);
+  auto loaded = Circuit(0, 0);
+  assert (not cache.load(otherKey, loaded));
+  assert (cache.load(key, loaded));
+  assert (loaded.size() == circuit.size());
+  assert (loaded.outputs().begin == circuit.outputs().begin);
+  for (unsigned id = 0; id < circuit.size(); id++) {
+    assert (loaded.inputLeft(id) == circuit.inputLeft(id));
+    assert (loaded.inputRight(id) == circuit.inputRight(id));
+    assert (loaded.gateType(id) == circuit.gateType(id));
+    assert (loaded.fanoutCount(id) == circuit.fanoutCount(id));
+  }
+  srand(timeBasedSeed());
+  for (unsigned k = 0; k < 100; k++) {
+    ValueWord input(2 * wordLength);
+    for (unsigned i = 0; i < input.size(); i++)
+      input[i] = rand() & 1;
+    assert (loaded.evaluate(input) == circuit.evaluate(input));
+  }
+  // Truncated files are ignored.
+  auto fileName = cache.fileName(key);
+  truncate(fileName.c_str(), 30);
+  assert (not cache.load(key, loaded));
+  remove(fileName.c_str());
+  rmdir(cacheDirectory.c_str());
+  remove(specFileName.c_str());
+  remove(scriptFileName.c_str());
+  printf("- %u drivers stored and loaded\n", circuit.size());
+}
+
+void testBlifParser() {
+  printf("==== Testing BLIF parser ====\n");
+  // Gates are listed from the outputs back to the inputs,
+  // and a long chain checks that no recursion is involved.
+  unsigned chainLength = 500000;
+  auto blifFileName = tempFileName(".blif");
+  {
+    ofstream blif(blifFileName);
+    blif << ".model SpecSyn\n";
+    blif << ".inputs monitor[0] monitor[1] \\\n system[0]\n";
+    blif << ".outputs out[0] out[1] out[2] out[3]\n";
+    blif << ".subckt $_NOT_ A=c" << chainLength << " Y=out[3]\n";
+    for (unsigned i = chainLength; i > 0; i--)
+      blif << ".subckt $_XOR_ A=c" << i - 1 << " B=system[0] Y=c" << i << '\n';
+    blif << ".conn monitor[0] c0\n";
+    blif << ".subckt $_NAND_ A=monitor[0] B=system[0] Y=n1\n";
+    blif << ".conn n1 out[0]\n";
+    blif << ".conn monitor[1] out[1]\n";
+    blif << ".conn $true out[2]\n";
+    blif << ".end\n";
+  }
+  auto circuit = Circuit(0, 0);
+  BlifParser(blifFileName).parse(circuit);
+  assert (circuit.inputs().size() == 3 and circuit.outputs().size() == 4);
+  for (unsigned k = 0; k < 8; k++) {
+    ValueWord input = { bool(k & 1), bool(k & 2), bool(k & 4) };
+    auto output = circuit.evaluate(input);
+    assert (output[0] == not (input[0] and input[2]));
+    assert (output[1] == input[1]);
+    assert (output[2] == true);
+    // An even number of XORs with system[0] cancel out.
+    assert (output[3] == not input[0]);
+  }
+  printf("- %u gates parsed\n", circuit.gateCount());
+
+  // Undriven wires, unknown cells, unexpected names
+  // and lines of the wrong length are errors.
+  vector<string> invalid = {
+    ".subckt $_NOT_ A=nowhere Y=out[0]\n",
+    ".subckt $_MUX_ A=monitor[0] B=monitor[0] S=monitor[0] Y=out[0]\n",
+    ".subckt $_AND_ A=monitor[0] B=loop Y=loop\n.conn loop out[0]\n",
+    ".inputs clock\n",
+    ".inputs system[0] monitor[1]\n",
+    ".outputs flag\n",
+    ".conn monitor[0]\n",
+    ".conn monitor[0] out[0] out[1]\n",
+    ".subckt\n",
+  };
+  for (auto& body : invalid) {
+    ofstream(blifFileName)
+      << ".inputs monitor[0]\n.outputs out[0]\n" << body << ".end\n";
+    bool thrown = false;
+    try {
+      BlifParser(blifFileName).parse(circuit);
+    } catch (const invalid_argument& e) {
+      printf("- rejected: %s\n", e.what());
+      thrown = true;
+    }
+    assert (thrown);
+  }
+  remove(blifFileName.c_str());
+}
+
+void testBristol() {
+  printf("==== Testing Bristol Fashion import/export ====\n");
+  // A circuit with every gate type, written and read back.
+  unsigned wordLength = 8;
+  auto circuit = Circuit(2 * wordLength, wordLength + 1);
+  Word inA(wordLength);
+  Word inB(wordLength);
+  IncGenerator::current_ = 0;
+  IncGenerator gen;
+  generate(inA.begin(), inA.end(), gen);
+  generate(inB.begin(), inB.end(), gen);
+  auto zero = Zero(0);
+  zero.build(circuit);
+  auto adder = Adder(inA, inB, zero);
+  adder.build(circuit);
+  auto eq = EqChecker(inA, inB);
+  eq.build(circuit);
+  Word outputs = adder.sum();
+  outputs.push_back(eq);
+  circuit.updateOutputs(outputs);
+  auto fileName = tempFileName(".bristol");
+  BristolConverter::write(circuit, wordLength, fileName);
+  auto converter = BristolConverter(fileName);
+  auto loaded = converter.convert();
+  assert (converter.monitorStateLength == wordLength);
+  assert (converter.systemStateLength == wordLength);
+  assert (loaded.outputs().size() == wordLength + 1);
+  srand(timeBasedSeed());
+  for (unsigned k = 0; k < 100; k++) {
+    ValueWord input(2 * wordLength);
+    for (unsigned i = 0; i < input.size(); i++)
+      input[i] = rand() & 1;
+    assert (loaded.evaluate(input) == circuit.evaluate(input));
+  }
+  printf("- %u gates written, %u gates read back\n",
+    circuit.gateCount(), loaded.gateCount());
+
+  // Compiling checks the input split and the output count,
+  // whether the circuit is cached or not.
+  auto cacheDirectory = tempFileName("-cache");
+  auto cache = CircuitCache(cacheDirectory);
+  for (unsigned k = 0; k < 2; k++) {
+    auto compiled = cache.compile(fileName, wordLength, wordLength);
+    assert (compiled.size() <= loaded.size());
+    std::vector<std::pair<unsigned, unsigned>> mismatches = {
+      { wordLength - 1, wordLength + 1 }, { wordLength, wordLength + 1 }
+    };
+    for (auto [monitorStateLength, systemStateLength] : mismatches) {
+      bool thrown = false;
+      try {
+        cache.compile(fileName, monitorStateLength, systemStateLength);
+      } catch (const invalid_argument& e) {
+        printf("- rejected: %s\n", e.what());
+        thrown = true;
+      }
+      assert (thrown);
+    }
+  }
+  auto key = CircuitCache::key(fileName, CircuitCache::SCRIPT_FILE_NAME);
+  remove(cache.fileName(key).c_str());
+  rmdir(cacheDirectory.c_str());
+
+  // Without monitor state, all inputs stay system state.
+  BristolConverter::write(circuit, 0, fileName);
+  auto noMonitor = BristolConverter(fileName);
+  noMonitor.readHeader();
+  assert (noMonitor.monitorStateLength == 0);
+  assert (noMonitor.systemStateLength == 2 * wordLength);
+
+  // Wire copies and constants of hand-written circuits.
+  ofstream(fileName)
+    << "5 8\n2 1 1\n1 3\n\n"
+    << "2 1 0 1 3 AND\n"
+    << "1 1 3 4 INV\n"
+    << "1 1 1 5 EQ\n"
+    << "1 1 4 6 EQW\n"
+    << "2 1 0 1 7 XOR\n";
+  auto small = BristolConverter(fileName).convert();
+  for (unsigned k = 0; k < 4; k++) {
+    ValueWord input = { bool(k & 1), bool(k & 2) };
+    auto output = small.evaluate(input);
+    assert (output[0] == true);
+    assert (output[1] == not (input[0] and input[1]));
+    assert (output[2] == (input[0] != input[1]));
+  }
+  // Three outputs do not make a 1-bit monitor state and a flag bit.
+  bool thrown = false;
+  try {
+    CircuitCache("").compile(fileName, 1, 1);
+  } catch (const invalid_argument& e) {
+    printf("- rejected: %s\n", e.what());
+    thrown = true;
+  }
+  assert (thrown);
+  remove(fileName.c_str());
+  printf("- hand-written circuit read\n");
+}
+
+void testCircuitProfiler() {
+  printf("==== Testing circuit profiler and cost estimates ====\n");
+  // Monitor state m, system state s0 s1:
+  // m' = ~((m & s0) ^ s1), flag = s0 & s1.
+  auto circuit = Circuit(3, 2);
+  auto a = circuit.addGate(0, 1, GateType::AND);
+  auto b = circuit.addGate(a, 2, GateType::XOR);
+  auto next = circuit.addNot(b);
+  auto flag = circuit.addGate(1, 2, GateType::AND);
+  circuit.updateOutputs({ next, flag });
+  auto profile = CircuitProfiler(circuit, 1).profile();
+  profile.print();
+  assert (profile.monitorStateLength == 1);
+  assert (profile.systemStateLength == 2);
+  assert (profile.gateCount == 4);
+  assert (profile.gateCounts[static_cast<unsigned>(GateType::AND)] == 2);
+  assert (profile.gateCounts[static_cast<unsigned>(GateType::NOT)] == 1);
+  assert (profile.depth == 3);
+  assert (profile.maxFanout == 2);
+  // Inputs 1 and 2 are read by the last gate; so, at most three
+  // labels (e.g., s0, s1 and m & s0) are held at once.
+  assert (profile.peakLiveLabels == 3);
+
+  unsigned security = 1024;
+  auto estimator = CostEstimator(circuit, 1, security);
+  auto halfGates = HalfGatesGarbler(security >> 2);
+  auto classic = Shake256YaoGarbler();
+  auto yao = estimator.estimateYao(halfGates, "yao/halfgates");
+  auto group = QuadraticResidueGroup(getSafePrime(security));
+  auto lwy = estimator.estimateLwy(group, classic, "lwy/classic");
+  CostEstimate::printHeader();
+  yao.print();
+  lwy.print();
+  // Two AND gates of two rows; two system input and two flag labels.
+  unsigned labelBytes = 2 * (security >> 2) + 1;
+  assert (yao.systemBytes == (2 * 2 + 2 + 2) * labelBytes);
+  assert (yao.systemHashes == 2 * 4 and yao.monitorHashes == 2 * 2);
+  assert (yao.systemExps == 0 and yao.monitorExps == 0);
+  assert (yao.setupExps == BM::SENDER_EXP_COUNT + BM::CHOOSER_EXP_COUNT);
+  auto nandCount = circuit.toNand().gateCount();
+  assert (lwy.systemExps == LWY::SYSTEM_EXPS_PER_GATE * nandCount + 2 + 2);
+  assert (lwy.monitorExps == LWY::MONITOR_EXPS_PER_GATE * nandCount);
+  assert (lwy.monitorHashes == 4 * nandCount);
+  // Binary labels are raw bytes.
+  auto binaryEstimator =
+    CostEstimator(circuit, 1, security, WireFormat::BINARY);
+  auto binaryYao = binaryEstimator.estimateYao(halfGates, "yao/halfgates");
+  assert (binaryYao.systemBytes == (2 * 2 + 2 + 2) * (security >> 2));
+}
+
+// Evaluates a circuit the way evaluators do: level by level,
+// through label slots. Gates of a level are all evaluated
+// before any of them is stored, as if in parallel.
+ValueWord evaluateBySlots(
+  Circuit& circuit, Levelization& levelization,
+  SlotAllocation& allocation, ValueWord input)
+{
+  ValueWord values(allocation.slotCount, false);
+  for (unsigned id = 0; id < input.size(); id++)
+    values[allocation.slots[id]] = input[id];
+  for (unsigned k = 1; k <= levelization.depth(); k++) {
+    auto level = levelization.level(k);
+    ValueWord levelValues;
+    for (auto i = level.begin; i < level.end; i++) {
+      auto id = levelization.order[i];
+      levelValues.push_back(evaluateGate(circuit.gateType(id),
+        values[allocation.slots[circuit.inputLeft(id)]],
+        values[allocation.slots[circuit.inputRight(id)]]));
+    }
+    for (auto i = level.begin; i < level.end; i++)
+      values[allocation.slots[levelization.order[i]]] =
+        levelValues[i - level.begin];
+  }
+  ValueWord output;
+  auto outputRange = circuit.outputs();
+  for (auto id = outputRange.begin; id < outputRange.end; id++)
+    output.push_back(values[allocation.slots[id]]);
+  return output;
+}
+
+void testSlotAllocation() {
+  printf("==== Testing label slot allocation ====\n");
+  unsigned length = 32;
+  for (auto type : { AdderType::RIPPLE, AdderType::KOGGE_STONE }) {
+    auto circuit = buildVariant(
+      type == AdderType::RIPPLE ? "ripple adder" : "Kogge-Stone adder",
+      2 * length + 1, length + 1, [&](Circuit& circuit) {
+        Word inA(length), inB(length);
+        IncGenerator gen;
+        generate(inA.begin(), inA.end(), gen);
+        generate(inB.begin(), inB.end(), gen);
+        auto adder = Adder(inA, inB, 2 * length, type);
+        adder.build(circuit);
+        return Word(adder);
+      });
+    // Without a chunk size, and with gates streamed in chunks.
+    for (unsigned chunkSize : { 0, 7 }) {
+      auto levelization = circuit.levelize(chunkSize);
+      auto allocation = circuit.allocateSlots(levelization);
+      printf("- chunk size %u: %u slots for %u drivers in %u levels\n",
+        chunkSize, allocation.slotCount, circuit.size(),
+        levelization.depth());
+      assert (allocation.slots.size() == circuit.size());
+      // Level 1 computes the generate and propagate bits of all inputs;
+      // later on, their slots are reused.
+      assert (allocation.slotCount < circuit.size());
+      // Gates of a chunk come after those of earlier chunks.
+      for (unsigned i = 0; chunkSize > 0 and i < circuit.gateCount(); i++)
+        assert ((levelization.order[i] - circuit.inputs().size()) / chunkSize
+          == i / chunkSize);
+      for (unsigned k = 0; k < 100; k++) {
+        ValueWord input(2 * length + 1);
+        for (unsigned i = 0; i < input.size(); i++)
+          input[i] = rand() & 1;
+        assert (evaluateBySlots(circuit, levelization, allocation, input)
+          == circuit.evaluate(input));
+      }
+    }
+  }
+}
+
+void testStreamChunks() {
+  printf("==== Testing chunks of streamed garbled gates ====\n");
+  for (unsigned chunkSize : { 0, 1, 7, 10, 100 }) {
+    auto yao = Y::ParameterSet {
+      .gateCount          = 10,
+      .monitorStateLength = 2,
+      .systemStateLength  = 3,
+      .streamChunkSize    = chunkSize
+    };
+    auto lwy = LWY::ParameterSet {
+      .gateCount          = 10,
+      .monitorStateLength = 2,
+      .systemStateLength  = 3,
+      .streamChunkSize    = chunkSize
+    };
+    assert (yao.chunkCount() == lwy.chunkCount());
+    printf("- chunk size %3u: %2u messages\n", chunkSize, yao.chunkCount());
+    // Chunks cover all gates, in order, without gaps.
+    unsigned next = 0;
+    for (unsigned k = 0; k < yao.chunkCount(); k++) {
+      auto gates = lwy.chunk(k);
+      assert (gates.begin == next and gates.size() > 0);
+      assert (chunkSize == 0 or gates.size() <= chunkSize);
+      assert (yao.chunk(k).begin == gates.begin + yao.inputLength());
+      assert (yao.chunk(k).size() == gates.size());
+      next = gates.end;
+    }
+    assert (next == 10);
+  }
+}
+
+void testWireFormat() {
+  printf("==== Testing wire formats ====\n");
+  auto group = QuadraticResidueGroup(getSafePrime(1024));
+  auto byteLength = group.elementByteLength();
+  auto label = Label::random(32);
+  // An element with leading zero bytes, and zero itself.
+  BigInt small = 0x1234;
+  BigInt large = group.randomGenerator();
+  std::string oddHex = "abc", evenHex = "0f1e";
+  for (auto format : { WireFormat::TEXT, WireFormat::BINARY }) {
+    MessageWriter writer(format);
+    writer.number(0);
+    writer.number(4000000000U);
+    writer.label(label);
+    writer.element(small, byteLength);
+    writer.element(large, byteLength);
+    writer.element(0, byteLength);
+    writer.hex(oddHex);
+    writer.hex(evenHex);
+    auto message = writer.take();
+    printf("- %s: %zu bytes\n", wireFormatName(format), message.size());
+    // Elements are padded in binary, but not in text.
+    if (format == WireFormat::BINARY)
+      assert (message.size()
+        == 4 + 4 + (2 + 32) + 3 * byteLength + (2 + 2) + (2 + 2));
+
+    MessageReader reader(format, message);
+    assert (reader.number() == 0);
+    assert (reader.number() == 4000000000U);
+    assert (reader.label() == label);
+    assert (reader.element(byteLength) == small);
+    assert (reader.element(byteLength) == large);
+    assert (reader.element(byteLength) == 0);
+    assert (reader.hex() == oddHex);
+    assert (reader.hex() == evenHex);
+    assert (reader.atEnd());
+    bool caught = false;
+    try {
+      reader.number();
+    } catch (const MalformedMessage& e) {
+      caught = true;
+    }
+    assert (caught);
+    assert (parseWireFormat(wireFormatName(format)) == format);
+  }
+  // Garbled gates take half the bytes of text.
+  MessageWriter text(WireFormat::TEXT), binary(WireFormat::BINARY);
+  for (unsigned i = 0; i < 4; i++) {
+    text.label(label);
+    binary.label(label);
+  }
+  auto textSize = text.take().size(), binarySize = binary.take().size();
+  printf("- garbled gate: %zu bytes (text), %zu bytes (binary)\n",
+    textSize, binarySize);
+  assert (2 * binarySize <= textSize);
+
+  // Truncated binary fields are rejected.
+  MessageWriter writer(WireFormat::BINARY);
+  writer.label(label);
+  auto message = writer.take();
+  message.pop_back();
+  MessageReader reader(WireFormat::BINARY, message);
+  bool caught = false;
+  try {
+    reader.label();
+  } catch (const MalformedMessage& e) {
+    caught = true;
+  }
+  assert (caught);
+}
+
+// Monitor state copies the system state of the previous round;
+// the flag bit is raised once the monitor state is all ones.
+Circuit copyStateCircuit(unsigned stateLength) {
+  auto circuit = Circuit(2 * stateLength, stateLength + 1);
+  Word monitor(stateLength);
+  Word system(stateLength);
+  IncGenerator::current_ = 0;
+  IncGenerator gen;
+  generate(monitor.begin(), monitor.end(), gen);
+  generate(system.begin(), system.end(), gen);
+  unsigned allOnes = monitor[0];
+  for (unsigned i = 1; i < stateLength; i++) {
+    auto aggregator = AndGate(allOnes, monitor[i]);
+    aggregator.build(circuit);
+    allOnes = aggregator;
+  }
+  Word outputs = system;
+  outputs.push_back(allOnes);
+  auto id = Identity(outputs);
+  id.build(circuit);
+  circuit.updateOutputs(id);
+  return circuit;
+}
+
+void testTraceSimulator() {
+  printf("==== Testing trace simulator ====\n");
+  unsigned stateLength = 4;
+  auto circuit = copyStateCircuit(stateLength);
+
+  // SweepSystem sets one more bit in each round;
+  // all bits are set in round 5, and seen by the monitor in round 6.
+  auto sweep = SweepSystem();
+  auto simulator = TraceSimulator(circuit, stateLength, stateLength);
+  std::stringstream trace;
+  auto flagRound = simulator.run(sweep, 100, &trace);
+  assert (flagRound and *flagRound == 6);
+  printf("flag raised in round %u\n", *flagRound);
+
+  // Replaying the recorded trace gives the same verdict.
+  auto traceFileName = tempFileName(".trace");
+  std::ofstream(traceFileName) << trace.str();
+  auto replay = TraceSystem(traceFileName);
+  assert (replay.length() == 6);
+  auto replaySimulator = TraceSimulator(circuit, stateLength, stateLength);
+  assert (replaySimulator.run(replay, replay.length()) == flagRound);
+  remove(traceFileName.c_str());
+}
+
+// Runs the system and the monitor states against each other,
+// passing messages through in-memory queues rather than sockets;
+// `observe` is called after every step of either party.
+// Each party runs until it waits for a message it has not received.
+void runProtocol(
+  StatePtr system, std::string* systemReceived,
+  StatePtr monitor, std::string* monitorReceived,
+  const std::function<void()>& observe)
+{
+  std::deque<std::string> toSystem, toMonitor;
+  auto step = [&](
+    StatePtr& state, std::string* received,
+    std::deque<std::string>& inbox, std::deque<std::string>& outbox)
+  {
+    if (state->isSend())
+      outbox.push_back(state->message());
+    else if (state->isRecv()) {
+      if (inbox.empty())
+        return false;
+      *received = std::move(inbox.front());
+      inbox.pop_front();
+    }
+    state = state->next();
+    observe();
+    return true;
+  };
+  while (system or monitor) {
+    bool progress = false;
+    while (system and step(system, systemReceived, toSystem, toMonitor))
+      progress = true;
+    while (monitor and step(monitor, monitorReceived, toMonitor, toSystem))
+      progress = true;
+    // Neither party can go on: the protocol is deadlocked.
+    assert (progress);
+  }
+  assert (toSystem.empty() and toMonitor.empty());
+}
+
+void testYaoLabelLeakage() {
+  printf("==== Testing labels held by the Yao monitor ====\n");
+  // With half-gates, both labels of a wire differ by the global offset;
+  // so, holding both labels of any wire gives away those of all wires.
+  unsigned stateLength = 4, securityParameter = 1024;
+  auto circuit = copyStateCircuit(stateLength).withXorCopies();
+  auto systemCircuit = Circuit(2 * stateLength, stateLength + 1);
+  auto systemGarbler = HalfGatesGarbler(securityParameter >> 2);
+  auto monitorGarbler = HalfGatesGarbler(securityParameter >> 2);
+  auto sweep = SweepSystem();
+  auto parameters = [&](YaoGarbler* garbler) {
+    return Y::ParameterSet {
+      .gateCount          = circuit.size() - 2 * stateLength,
+      .monitorStateLength = stateLength,
+      .systemStateLength  = stateLength,
+      .garbler            = garbler,
+      .securityParameter  = securityParameter
+    };
+  };
+  auto systemParameters = parameters(&systemGarbler);
+  auto monitorParameters = parameters(&monitorGarbler);
+  auto systemMemory = Y::SystemMemory {
+    .circuit = &systemCircuit,
+    .system  = &sweep
+  };
+  auto monitorMemory = Y::MonitorMemory { .circuit = &circuit };
+  systemMemory.timer.start();
+  monitorMemory.timer.start();
+
+  // Every label (or digest) the monitor has held so far, in hex.
+  std::set<std::string> held;
+  unsigned checkedPairs = 0;
+  auto observe = [&]() {
+    for (auto& label : monitorMemory.evaluatedDriverLabels)
+      if (not label.empty())
+        held.insert(label.toHex());
+    for (auto& digest : monitorMemory.flagBitDigests)
+      if (not digest.empty())
+        held.insert(digest.toHex());
+    // Gate labels are written while a chunk is garbled in the background.
+    if (systemMemory.nextGarbledChunk.valid())
+      return;
+    for (auto& labels : systemMemory.driverLabels) {
+      assert (not (held.count(labels[0].toHex())
+        and held.count(labels[1].toHex())));
+      assert (not held.count((labels[0] ^ labels[1]).toHex()));
+      checkedPairs++;
+    }
+    auto& digests = monitorMemory.flagBitDigests;
+    if (not digests[0].empty() and not systemMemory.driverLabels.empty()) {
+      auto& labels = systemMemory.driverLabels.back();
+      assert ((digests[0] ^ digests[1]) != (labels[0] ^ labels[1]));
+    }
+  };
+  runProtocol(
+    std::make_unique<Y::InitSystem>(&systemParameters, &systemMemory),
+    &systemMemory.receivedMessage,
+    std::make_unique<Y::InitMonitor>(&monitorParameters, &monitorMemory),
+    &monitorMemory.receivedMessage,
+    observe);
+  // The flag is raised in round 6 (see testTraceSimulator).
+  assert (sweep.n == 5);
+  printf("%zu labels held, none with its pair (%u pairs checked)\n",
+    held.size(), checkedPairs);
+}
+
+void testYaoTweaks() {
+  printf("==== Testing Yao gate tweaks across rounds ====\n");
+  // The monitor state toggles, so the same labels reach the flag gate
+  // in every other round; with half-gates, tables of that gate garbled
+  // with the same tweak would differ by the global offset, or not at all.
+  unsigned securityParameter = 1024;
+  auto circuit = Circuit(5, 2);
+  auto toggle = circuit.addNot(0);
+  auto flag = circuit.addGate(0, 4, GateType::AND);
+  circuit.updateOutputs({ toggle, flag });
+  auto systemCircuit = Circuit(5, 2);
+  auto systemGarbler = HalfGatesGarbler(securityParameter >> 2);
+  auto monitorGarbler = HalfGatesGarbler(securityParameter >> 2);
+  auto sweep = SweepSystem();
+  auto parameters = [&](YaoGarbler* garbler) {
+    return Y::ParameterSet {
+      .gateCount          = circuit.gateCount(),
+      .monitorStateLength = 1,
+      .systemStateLength  = 4,
+      .garbler            = garbler,
+      .securityParameter  = securityParameter
+    };
+  };
+  auto systemParameters = parameters(&systemGarbler);
+  auto monitorParameters = parameters(&monitorGarbler);
+  auto systemMemory = Y::SystemMemory {
+    .circuit = &systemCircuit,
+    .system  = &sweep
+  };
+  auto monitorMemory = Y::MonitorMemory { .circuit = &circuit };
+  systemMemory.timer.start();
+  monitorMemory.timer.start();
+
+  // The garbler half of the flag gate's table, in every round.
+  std::vector<Label> tables;
+  auto observe = [&]() {
+    auto& garbledGates = monitorMemory.garbledGates;
+    if (not garbledGates.empty() and tables.size() == monitorMemory.round)
+      tables.push_back(garbledGates.back()[0]);
+  };
+  runProtocol(
+    std::make_unique<Y::InitSystem>(&systemParameters, &systemMemory),
+    &systemMemory.receivedMessage,
+    std::make_unique<Y::InitMonitor>(&monitorParameters, &monitorMemory),
+    &monitorMemory.receivedMessage,
+    observe);
+  // Rounds are counted once their outputs are copied; the last is not.
+  assert (tables.size() == monitorMemory.round + 1);
+  assert (tables.size() >= 4);
+  auto& labels = systemMemory.driverLabels[0];
+  auto offset = labels[0] ^ labels[1];
+  for (unsigned i = 0; i < tables.size(); i++)
+    for (unsigned j = i + 1; j < tables.size(); j++) {
+      assert (tables[i] != tables[j]);
+      assert ((tables[i] ^ tables[j]) != offset);
+    }
+  printf("%zu rounds, flag gate tables pairwise unrelated\n", tables.size());
+}
+
+void testStreamedEvaluation() {
+  printf("==== Testing streamed evaluation ====\n");
+  // The monitor evaluates each message of garbled gates as it arrives;
+  // outputs of the last round are decoded with the labels of the system,
+  // and compared with those of the circuit.
+  unsigned stateLength = 4, securityParameter = 1024;
+  auto circuit = copyStateCircuit(stateLength);
+  // The flag is raised in round 6 (see testTraceSimulator):
+  // the monitor state is that of the system in round 5.
+  auto lastRound = SweepSystem();
+  for (unsigned round = 1; round < 5; round++)
+    lastRound.next();
+  ValueWord input = lastRound.data();
+  lastRound.next();
+  for (auto bit : lastRound.data())
+    input.push_back(bit);
+  auto expected = circuit.evaluate(input);
+  auto outputs = circuit.outputs();
+
+  // Pools do not take loops from several threads at once; so, each
+  // party has its own, as the system garbles in the background.
+  auto systemPool = ThreadPool(2);
+  auto monitorPool = ThreadPool(2);
+  auto systemGarbler = HalfGatesGarbler(securityParameter >> 2);
+  auto monitorGarbler = HalfGatesGarbler(securityParameter >> 2);
+  auto yaoCircuit = circuit.withXorCopies();
+  auto yaoGateCount = yaoCircuit.size() - 2 * stateLength;
+  std::vector<ValueWord> yaoOutputs;
+  for (unsigned chunkSize : { 0, 3 }) {
+    auto parameters = [&](YaoGarbler* garbler, ThreadPool* pool) {
+      return Y::ParameterSet {
+        .gateCount          = yaoGateCount,
+        .monitorStateLength = stateLength,
+        .systemStateLength  = stateLength,
+        .garbler            = garbler,
+        .securityParameter  = securityParameter,
+        .threadPool         = pool,
+        .streamChunkSize    = chunkSize
+      };
+    };
+    auto systemParameters = parameters(&systemGarbler, &systemPool);
+    auto monitorParameters = parameters(&monitorGarbler, &monitorPool);
+    auto sweep = SweepSystem();
+    auto systemCircuit = Circuit(2 * stateLength, stateLength + 1);
+    auto systemMemory = Y::SystemMemory {
+      .circuit = &systemCircuit,
+      .system  = &sweep
+    };
+    auto monitorMemory = Y::MonitorMemory { .circuit = &yaoCircuit };
+    systemMemory.timer.start();
+    monitorMemory.timer.start();
+    // The monitor only holds the gates of a single message.
+    auto heldGates = monitorParameters.chunk(0).size();
+    runProtocol(
+      std::make_unique<Y::InitSystem>(&systemParameters, &systemMemory),
+      &systemMemory.receivedMessage,
+      std::make_unique<Y::InitMonitor>(&monitorParameters, &monitorMemory),
+      &monitorMemory.receivedMessage,
+      [&]() { assert (monitorMemory.garbledGates.size() <= heldGates); });
+    assert (sweep.n == 5);
+
+    ValueWord output;
+    auto& slots = monitorMemory.slotAllocation.slots;
+    for (auto id = outputs.begin; id < outputs.end; id++) {
+      auto& label = monitorMemory.evaluatedDriverLabels[slots[id]];
+      auto& labels = systemMemory.driverLabels[id];
+      assert (label == labels[0] or label == labels[1]);
+      output.push_back(label == labels[1]);
+    }
+    assert (output == expected);
+    yaoOutputs.push_back(output);
+    printf("- Yao, chunk size %u: %u messages, outputs match\n",
+      chunkSize, monitorParameters.chunkCount());
+  }
+  assert (yaoOutputs[0] == yaoOutputs[1]);
+
+  // LWY shuffles gates within their message.
+  auto group = std::make_shared<QuadraticResidueGroup>(
+    getSafePrime(securityParameter));
+  auto lwyGarbler = Shake256YaoGarbler();
+  auto lwyCircuit = circuit.toNand();
+  auto lwyGateCount = lwyCircuit.size() - 2 * stateLength;
+  for (unsigned chunkSize : { 0, 3 }) {
+    auto parameters = [&](ThreadPool* pool) {
+      return LWY::ParameterSet {
+        .gateCount          = lwyGateCount,
+        .monitorStateLength = stateLength,
+        .systemStateLength  = stateLength,
+        .group              = group,
+        .garbler            = &lwyGarbler,
+        .securityParameter  = securityParameter,
+        .threadPool         = pool,
+        .streamChunkSize    = chunkSize
+      };
+    };
+    auto systemParameters = parameters(&systemPool);
+    auto monitorParameters = parameters(&monitorPool);
+    auto sweep = SweepSystem();
+    auto systemMemory = LWY::SystemMemory { .system = &sweep };
+    auto monitorMemory = LWY::MonitorMemory { .circuit = &lwyCircuit };
+    auto heldGates = monitorParameters.chunk(0).size();
+    runProtocol(
+      std::make_unique<LWY::InitSystem>(&systemParameters, &systemMemory),
+      &systemMemory.receivedMessage,
+      std::make_unique<LWY::InitMonitor>(&monitorParameters, &monitorMemory),
+      &monitorMemory.receivedMessage,
+      [&]() { assert (monitorMemory.garbledGates.size() <= heldGates); });
+    assert (sweep.n == 5);
+
+    // Outputs stay in place in the shuffled circuit; their labels are
+    // raised to the exponents picked for the next round.
+    ValueWord output;
+    auto& exponents = systemMemory.nextRoundGarblingExponents;
+    auto& slots = monitorMemory.slotAllocation.slots;
+    auto lwyOutputs = lwyCircuit.outputs();
+    for (auto id = lwyOutputs.begin; id < lwyOutputs.end; id++) {
+      auto& label = monitorMemory.evaluatedDriverLabels[slots[id]];
+      auto& driverLabel = systemMemory.driverLabels[id];
+      auto bit = label == group->exp(driverLabel, exponents[1]);
+      assert (bit or label == group->exp(driverLabel, exponents[0]));
+      output.push_back(bit);
+    }
+    assert (output == expected);
+    printf("- LWY, chunk size %u: %u messages, outputs match\n",
+      chunkSize, monitorParameters.chunkCount());
+  }
+}
+
+void testThreadPool() {
+  printf("==== Testing thread pool ====\n");
+  auto pool = ThreadPool(4);
+  // Every index is visited exactly once, whatever the grain.
+  for (size_t grain : {1, 7, 1000}) {
+    vector<unsigned> visits(1000, 0);
+    pool.parallelFor(0, visits.size(), grain, [&] (size_t b, size_t e) {
+      for (auto i = b; i < e; i++)
+        visits[i]++;
+    });
+    for (auto v : visits)
+      assert (v == 1);
+  }
+  // Exceptions of a chunk reach the caller.
+  bool caught = false;
+  try {
+    pool.parallelFor(0, 100, 10, [] (size_t b, size_t) {
+      if (b == 50)
+        throw std::runtime_error("chunk failed");
+    });
+  } catch (const std::runtime_error& e) {
+    caught = true;
+  }
+  assert (caught);
+  printf("%u threads OK\n", pool.size());
+}
+
 void testSpec2Circ() {
   try {
     auto converter = BaseConverter("test.spec");
@@ -264,12 +1625,56 @@ int main() {
   sep();
   testQR();
   sep();
+  testFixedBase();
+  sep();
+  testEllipticCurve();
+  sep();
+  testLabel();
+  sep();
   testGarblerSha512();
   sep();
   testGarblerShake256();
   sep();
+  testGarblerPointAndPermute();
+  sep();
+  testGarblerHalfGates();
+  sep();
   testModule();
   sep();
+  testModuleVariants();
+  sep();
+  testBitSliced();
+  sep();
+  testGateTypes();
+  sep();
+  testOptimizer();
+  sep();
+  testOutputCopies();
+  sep();
+  testCircuitCache();
+  sep();
+  testBlifParser();
+  sep();
+  testBristol();
+  sep();
+  testCircuitProfiler();
+  sep();
+  testSlotAllocation();
+  sep();
+  testStreamChunks();
+  sep();
+  testWireFormat();
+  sep();
+  testTraceSimulator();
+  sep();
+  testYaoLabelLeakage();
+  sep();
+  testYaoTweaks();
+  sep();
+  testStreamedEvaluation();
+  sep();
+  testThreadPool();
+  sep();
   testSpec2Circ();
   sep();
   testSpec2CircYosys();
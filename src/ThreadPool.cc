@@ -0,0 +1,128 @@
+#include <cassert>
+#include <exception>
+#include "ThreadPool.hh"
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+  assert (threadCount >= 1);
+  for (unsigned i = 0; i < threadCount; i++)
+    this->queues.push_back(std::make_unique<TaskQueue>());
+  for (unsigned i = 1; i < threadCount; i++)
+    this->workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(this->mutex);
+    this->stopping = true;
+  }
+  this->wakeUp.notify_all();
+  for (auto& worker : this->workers)
+    worker.join();
+}
+
+unsigned ThreadPool::size() {
+  return this->queues.size();
+}
+
+bool ThreadPool::runTask(unsigned self) {
+  Task task;
+  auto queueCount = this->queues.size();
+  // Own queue first (front), then steal from the others (back).
+  for (unsigned i = 0; i < queueCount and not task; i++) {
+    auto& queue = *this->queues[(self + i) % queueCount];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+    if (i == 0) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    } else {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+  }
+  if (not task)
+    return false;
+  this->pending--;
+  task();
+  return true;
+}
+
+void ThreadPool::work(unsigned self) {
+  while (true) {
+    if (this->runTask(self))
+      continue;
+    std::unique_lock lock(this->mutex);
+    this->wakeUp.wait(lock, [this] {
+      return this->stopping or this->pending > 0; });
+    if (this->stopping and this->pending == 0)
+      return;
+  }
+}
+
+void ThreadPool::parallelFor(
+  size_t begin, size_t end, size_t grain,
+  const std::function<void(size_t, size_t)>& body)
+{
+  assert (grain > 0);
+  if (begin >= end)
+    return;
+  size_t chunkCount = (end - begin + grain - 1) / grain;
+  // State shared by all chunks of this loop.
+  struct Loop {
+    std::atomic<size_t> remaining;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable done;
+  } loop;
+  loop.remaining = chunkCount;
+
+  for (size_t c = 0; c < chunkCount; c++) {
+    auto chunkBegin = begin + c * grain;
+    auto chunkEnd = std::min(end, chunkBegin + grain);
+    auto task = [&loop, &body, chunkBegin, chunkEnd] {
+      std::exception_ptr error;
+      try {
+        body(chunkBegin, chunkEnd);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      // The caller may return as soon as `remaining` drops to 0;
+      // holding the lock keeps `loop` alive until we are done with it.
+      std::lock_guard lock(loop.mutex);
+      if (error and not loop.error)
+        loop.error = error;
+      if (--loop.remaining == 0)
+        loop.done.notify_all();
+    };
+    // Consecutive chunks go to the same queue,
+    // so that each thread starts on a contiguous range.
+    auto& queue = *this->queues[c * this->queues.size() / chunkCount];
+    std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    this->pending++;
+  }
+  {
+    // Notifying after taking the lock makes sure that
+    // no idle worker misses the new tasks.
+    std::lock_guard lock(this->mutex);
+  }
+  this->wakeUp.notify_all();
+
+  while (loop.remaining > 0 and this->runTask(0));
+  std::unique_lock lock(loop.mutex);
+  loop.done.wait(lock, [&loop] { return loop.remaining == 0; });
+  if (loop.error)
+    std::rethrow_exception(loop.error);
+}
+
+void parallelFor(
+  ThreadPool* pool,
+  size_t begin, size_t end, size_t grain,
+  const std::function<void(size_t, size_t)>& body)
+{
+  if (pool)
+    pool->parallelFor(begin, end, grain, body);
+  else if (begin < end)
+    body(begin, end);
+}
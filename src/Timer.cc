@@ -39,6 +39,10 @@ void Timer::reset() {
   accumulated = 0;
 }
 
+void Timer::add(float milliseconds) {
+  accumulated += milliseconds;
+}
+
 float Timer::display() {
   // Display just reads from the timer.
   // Hence, it doesn't affect the timer state.
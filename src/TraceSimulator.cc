@@ -0,0 +1,59 @@
+#include <cassert>
+#include "TraceSimulator.hh"
+
+TraceSimulator::TraceSimulator(
+  Circuit& circuit,
+  unsigned monitorStateLength,
+  unsigned systemStateLength)
+  : monitorStateLength(monitorStateLength),
+    systemStateLength(systemStateLength),
+    evaluator(circuit)
+{
+  assert (circuit.inputs().size() == monitorStateLength + systemStateLength);
+  assert (circuit.outputs().size() == monitorStateLength + 1);
+  // ASSUMPTION: monitor starts in an all-zero state.
+  this->inputs.assign(circuit.inputs().size(), 0);
+  this->outputs.assign(circuit.outputs().size(), 0);
+}
+
+bool TraceSimulator::step(const std::vector<bool>& systemState) {
+  assert (systemState.size() == this->systemStateLength);
+  auto offset = this->monitorStateLength;
+  for (unsigned i = 0; i < this->systemStateLength; i++)
+    this->inputs[offset + i] = systemState[i];
+  this->evaluator.evaluateSliced(
+    this->inputs.data(), this->outputs.data(), 1);
+  for (unsigned i = 0; i < this->monitorStateLength; i++)
+    this->inputs[i] = this->outputs[i] & 1;
+  this->rounds++;
+  // ASSUMPTION: flag bit is always the last output.
+  return this->outputs.back() & 1;
+}
+
+std::optional<unsigned> TraceSimulator::run(
+  MonitorableSystem& system, unsigned rounds, std::ostream* trace)
+{
+  for (unsigned round = 1; round <= rounds; round++) {
+    auto& systemState = system.data();
+    if (trace) {
+      for (auto bit : systemState)
+        *trace << bit;
+      *trace << '\n';
+    }
+    if (this->step(systemState))
+      return this->rounds;
+    system.next();
+  }
+  return std::nullopt;
+}
+
+ValueWord TraceSimulator::monitorState() {
+  ValueWord state(this->monitorStateLength);
+  for (unsigned i = 0; i < this->monitorStateLength; i++)
+    state[i] = this->inputs[i];
+  return state;
+}
+
+unsigned TraceSimulator::roundCount() {
+  return this->rounds;
+}
@@ -0,0 +1,182 @@
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include "WireFormat.hh"
+#include "Exceptions.hh"
+#include "MathUtils.hh"
+
+const char* wireFormatName(WireFormat format) {
+  return format == WireFormat::BINARY ? "binary" : "text";
+}
+
+WireFormat parseWireFormat(const std::string& name) {
+  if (name == "text")
+    return WireFormat::TEXT;
+  if (name == "binary")
+    return WireFormat::BINARY;
+  throw std::invalid_argument("unknown wire format: " + name);
+}
+
+MessageWriter::MessageWriter(WireFormat format) : format(format) {}
+
+void MessageWriter::putBytes(uint64_t n, unsigned count) {
+  for (unsigned i = count; i-- > 0;)
+    this->buffer.push_back(static_cast<char>((n >> (8 * i)) & 0xff));
+}
+
+void MessageWriter::number(uint32_t n) {
+  if (this->format == WireFormat::TEXT) {
+    this->buffer += std::to_string(n);
+    this->buffer.push_back(' ');
+    return;
+  }
+  this->putBytes(n, 4);
+}
+
+void MessageWriter::label(const Label& label, unsigned column) {
+  if (this->format == WireFormat::TEXT) {
+    this->buffer += label.toHex();
+    this->buffer.push_back(' ');
+    return;
+  }
+  assert (not label.empty() and label.size() <= UINT16_MAX);
+  auto& length = this->labelLengths.at(column);
+  if (length == 0) {
+    length = label.size();
+    this->putBytes(length, 2);
+  }
+  assert (label.size() == length);
+  this->buffer.append(
+    reinterpret_cast<const char*>(label.data()), label.size());
+}
+
+void MessageWriter::element(const BigInt& element, unsigned byteLength) {
+  if (this->format == WireFormat::TEXT) {
+    this->buffer += element.get_str(16);
+    this->buffer.push_back(' ');
+    return;
+  }
+  assert (element >= 0);
+  size_t size = (mpz_sizeinbase(element.get_mpz_t(), 2) + 7) / 8;
+  assert (size <= byteLength);
+  auto offset = this->buffer.size();
+  this->buffer.resize(offset + byteLength, 0);
+  // Zero is exported as no bytes at all; so, it is all padding.
+  size_t count;
+  mpz_export(
+    &this->buffer[offset + byteLength - size], &count,
+    1, 1, 1, 0, element.get_mpz_t());
+}
+
+void MessageWriter::hex(const std::string& hex) {
+  assert (not hex.empty());
+  if (this->format == WireFormat::TEXT) {
+    this->buffer += hex;
+    this->buffer.push_back(' ');
+    return;
+  }
+  // Odd-length strings get a leading zero digit, which the reader
+  // drops again, knowing the number of digits.
+  assert (hex.size() <= UINT16_MAX);
+  this->putBytes(hex.size(), 2);
+  auto packed = Label::fromHex(hex);
+  this->buffer.append(
+    reinterpret_cast<const char*>(packed.data()), packed.size());
+}
+
+std::string MessageWriter::take() {
+  this->labelLengths = {};
+  return std::move(this->buffer);
+}
+
+MessageReader::MessageReader(WireFormat format, const std::string& message)
+  : format(format),
+    position(reinterpret_cast<const unsigned char*>(message.data())),
+    end(position + message.size()) {}
+
+std::string_view MessageReader::token() {
+  while (this->position < this->end and std::isspace(*this->position))
+    this->position++;
+  auto begin = this->position;
+  while (this->position < this->end and not std::isspace(*this->position))
+    this->position++;
+  if (begin == this->position)
+    throw MalformedMessage();
+  return std::string_view(
+    reinterpret_cast<const char*>(begin), this->position - begin);
+}
+
+const unsigned char* MessageReader::bytes(size_t count) {
+  if (static_cast<size_t>(this->end - this->position) < count)
+    throw MalformedMessage();
+  auto begin = this->position;
+  this->position += count;
+  return begin;
+}
+
+uint64_t MessageReader::getBytes(unsigned count) {
+  auto p = this->bytes(count);
+  uint64_t n = 0;
+  for (unsigned i = 0; i < count; i++)
+    n = (n << 8) | p[i];
+  return n;
+}
+
+uint32_t MessageReader::number() {
+  if (this->format == WireFormat::BINARY)
+    return this->getBytes(4);
+  auto field = this->token();
+  uint32_t n;
+  auto [last, error] =
+    std::from_chars(field.data(), field.data() + field.size(), n);
+  if (error != std::errc() or last != field.data() + field.size())
+    throw MalformedMessage();
+  return n;
+}
+
+Label MessageReader::label(unsigned column) {
+  if (this->format == WireFormat::TEXT)
+    return Label::fromHex(this->token());
+  auto& length = this->labelLengths.at(column);
+  if (length == 0) {
+    length = this->getBytes(2);
+    if (length == 0)
+      throw MalformedMessage();
+  }
+  Label label(length);
+  std::memcpy(label.data(), this->bytes(label.size()), label.size());
+  return label;
+}
+
+BigInt MessageReader::element(unsigned byteLength) {
+  if (this->format == WireFormat::TEXT)
+    return BigInt(std::string(this->token()), 16);
+  BigInt element;
+  mpz_import(
+    element.get_mpz_t(), byteLength, 1, 1, 1, 0, this->bytes(byteLength));
+  return element;
+}
+
+std::string MessageReader::hex() {
+  if (this->format == WireFormat::TEXT)
+    return std::string(this->token());
+  auto digits = this->getBytes(2);
+  auto packed = this->bytes((digits + 1) / 2);
+  std::string hex(digits, 0);
+  for (size_t i = 0; i < digits; i++) {
+    // Digit i is nibble i + 1 of an odd-length string.
+    auto nibble = i + digits % 2;
+    auto byte = packed[nibble / 2];
+    hex[i] = HEX_ALPHABET[nibble % 2 ? byte & 0xf : byte >> 4];
+  }
+  return hex;
+}
+
+bool MessageReader::atEnd() {
+  if (this->format == WireFormat::TEXT)
+    while (this->position < this->end and std::isspace(*this->position))
+      this->position++;
+  return this->position == this->end;
+}
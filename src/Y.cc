@@ -1,12 +1,41 @@
+#include <algorithm>
 #include "Y.hh"
 #include "StringUtils.hh"
 #include "MathUtils.hh"
 #include "QuadraticResidueGroup.hh"
 
+uint64_t Y::gateTweak(unsigned round, unsigned gateId) {
+  return (uint64_t(round) << 32) | gateId;
+}
+
+Label Y::flagBitDigest(const Label& label, uint64_t tweak) {
+  Label digest(label.size());
+  hashShake256(
+    { { label.data(), label.size() }, { &tweak, sizeof(tweak) } },
+    digest.data(), digest.size());
+  return digest;
+}
+
 unsigned Y::ParameterSet::inputLength() {
   return this->monitorStateLength + this->systemStateLength;
 }
 
+unsigned Y::ParameterSet::chunkCount() {
+  auto size = this->streamChunkSize;
+  if (size == 0 or this->gateCount == 0)
+    return 1;
+  return (this->gateCount + size - 1) / size;
+}
+
+DriverRange Y::ParameterSet::chunk(unsigned k) {
+  auto offset = this->inputLength();
+  if (this->streamChunkSize == 0)
+    return { offset, offset + this->gateCount };
+  auto begin = std::min(k * this->streamChunkSize, this->gateCount);
+  auto end = std::min(begin + this->streamChunkSize, this->gateCount);
+  return { offset + begin, offset + end };
+}
+
 Y::SystemInterface::SystemInterface(
   ParameterSet* parameters,
   SystemMemory* memory,
@@ -76,18 +105,18 @@ void Y::RecvCircuit::parseCircuit(const std::string& circuitString) {
   // The circuit should not contain any gates at this stage;
   // so, there are just as many drivers as circuit inputs.
   assert (circuit->size() == inputLength);
-  std::vector<std::string> gateSpecs;
   auto gateCount = this->parameters->gateCount;
-  std::tie(gateSpecs, std::ignore) =
-    readStrings(circuitString, 3 * gateCount);
+  MessageReader reader(this->parameters->wireFormat, circuitString);
   for (unsigned i = 0; i < gateCount; i++) {
-    auto inputLeft = std::stoul(gateSpecs[3 * i]);
-    auto inputRight = std::stoul(gateSpecs[3 * i + 1]);
-    auto id = std::stoul(gateSpecs[3 * i + 2]);
+    auto inputLeft = reader.number();
+    auto inputRight = reader.number();
+    auto type = reader.number();
+    auto id = reader.number();
     // Since the circuit uses an increment counter for gate ID's,
     // Each received gate ID should be equal to the current counter value.
     assert (id == i + inputLength);
-    circuit->addGate(inputLeft, inputRight);
+    assert (type < GATE_TYPE_COUNT);
+    circuit->addGate(inputLeft, inputRight, static_cast<GateType>(type));
     // No need to set output for the circuit,
     // as it is not evaluated on System side.
   }
@@ -114,10 +143,8 @@ StatePtr Y::InitMonitorStateLabels::next() {
   auto secLen = secParam >> 2;
   auto& driverLabels = this->memory->driverLabels;
   assert (driverLabels.empty());
-  for (unsigned i = 0; i < parameters->monitorStateLength; i++) {
-    driverLabels.push_back(
-      { randomHexString(secLen), randomHexString(secLen) } );
-  }
+  for (unsigned i = 0; i < parameters->monitorStateLength; i++)
+    driverLabels.push_back(this->parameters->garbler->randomLabelPair(secLen));
 
   return std::make_unique<GenerateGarbledGates>
     (this->parameters, this->memory);
@@ -133,38 +160,81 @@ void Y::GenerateGarbledGates::fillDriverLabels() {
   driverLabels.resize(driverCount);
   auto secParam = this->parameters->securityParameter;
   auto secLen = secParam >> 2;
-  for (unsigned i = monitorStateLength; i < driverCount; i++)
-    driverLabels[i] =
-      { randomHexString(secLen), randomHexString(secLen) };
+  auto garbler = this->parameters->garbler;
+  // Gate labels of schemes that derive them are filled by garble().
+  auto labelCount = garbler->derivesOutputLabels()
+    ? this->parameters->inputLength()
+    : driverCount;
+  for (unsigned i = monitorStateLength; i < labelCount; i++)
+    driverLabels[i] = garbler->randomLabelPair(secLen);
 }
 
-void Y::GenerateGarbledGates::garble() {
+void Y::GenerateGarbledGates::garble(DriverRange gates) {
   auto& driverLabels = this->memory->driverLabels;
   auto& garbledGates = this->memory->garbledGates;
-  auto gateCount = this->parameters->gateCount;
-  garbledGates.resize(gateCount);
-  auto offset =
-    this->parameters->systemStateLength +
-    this->parameters->monitorStateLength;
-  auto drivers = this->memory->circuit->get();
-  for (unsigned i = 0; i < gateCount; i++) {
+  garbledGates.resize(gates.size());
+  auto circuit = this->memory->circuit;
+  auto garbler = this->parameters->garbler;
+  auto round = this->memory->round;
+  auto garbleGate = [&] (unsigned id) {
     // Generate garbled gates using the garbler
-    auto gate = static_cast<Gate*>(drivers[offset + i]);
-    auto leftIdx = gate->inputLeft;
-    auto rightIdx = gate->inputRight;
-    // printf("D:   garbling gate %d\n", i);
+    auto leftIdx = circuit->inputLeft(id);
+    auto rightIdx = circuit->inputRight(id);
+    // printf("D:   garbling gate %d\n", id - offset);
     // printf("D:     left  labels (%d): %s %s\n", leftIdx,
-    //   driverLabels[leftIdx][0].c_str(),
-    //   driverLabels[leftIdx][1].c_str());
+    //   driverLabels[leftIdx][0].toHex().c_str(),
+    //   driverLabels[leftIdx][1].toHex().c_str());
     // printf("D:     right labels (%d): %s %s\n", rightIdx,
-    //   driverLabels[rightIdx][0].c_str(),
-    //   driverLabels[rightIdx][1].c_str());
+    //   driverLabels[rightIdx][0].toHex().c_str(),
+    //   driverLabels[rightIdx][1].toHex().c_str());
     // fflush(stdout);
-    garbledGates[i] =
-      this->parameters->garbler->enc(
-        driverLabels[leftIdx],
-        driverLabels[rightIdx],
-        driverLabels[offset + i] );
+    garbledGates[id - gates.begin] = garbler->enc(
+      driverLabels[leftIdx],
+      driverLabels[rightIdx],
+      driverLabels[id],
+      gateTweak(round, id),
+      circuit->gateType(id));
+  };
+  auto pool = this->parameters->threadPool;
+  if (not garbler->derivesOutputLabels()) {
+    // All driver labels are fixed by fillDriverLabels();
+    // so, gates are garbled independently, each into its own slot.
+    parallelFor(
+      pool, gates.begin, gates.end, Y::GARBLING_CHUNK_SIZE,
+      [&] (size_t begin, size_t end) {
+        for (auto id = begin; id < end; id++)
+          garbleGate(id);
+      });
+    return;
+  }
+
+  // Output labels depend on input labels;
+  // so, gates are garbled in topological order.
+  if (pool == nullptr or pool->size() == 1) {
+    for (auto id = gates.begin; id < gates.end; id++)
+      garbleGate(id);
+    return;
+  }
+  // Gates of a level are sorted by ID;
+  // so, those of the chunk are found by binary search.
+  auto& levelization = this->memory->levelization;
+  if (levelization.levels.empty())
+    levelization = circuit->levelize();
+  auto order = levelization.order.begin();
+  for (unsigned k = 1; k <= levelization.depth(); k++) {
+    auto level = levelization.level(k);
+    auto begin = std::lower_bound(
+      order + level.begin, order + level.end, gates.begin) - order;
+    auto end = std::lower_bound(
+      order + begin, order + level.end, gates.end) - order;
+    if (begin == end)
+      continue;
+    pool->parallelFor(
+      begin, end, Y::GARBLING_CHUNK_SIZE,
+      [&] (size_t begin, size_t end) {
+        for (auto j = begin; j < end; j++)
+          garbleGate(levelization.order[j]);
+      });
   }
 }
 
@@ -175,30 +245,68 @@ StatePtr Y::GenerateGarbledGates::next() {
   // printf("D:   driver labels:\n");
   // for (unsigned i = 0; i < this->memory->driverLabels.size(); i++) {
   //   printf("D:     %d: %s %s\n", i,
-  //     this->memory->driverLabels[i][0].c_str(),
-  //     this->memory->driverLabels[i][1].c_str());
+  //     this->memory->driverLabels[i][0].toHex().c_str(),
+  //     this->memory->driverLabels[i][1].toHex().c_str());
   // }
-  this->garble();
-  return std::make_unique<SendGarbledGates>(this->parameters, this->memory);
+  // Chunks are garbled while input labels and earlier chunks are sent.
+  this->garbleChunkInBackground(0);
+  return std::make_unique<SendSystemInputLabels>
+    (this->parameters, this->memory);
 }
 
+std::string Y::GenerateGarbledGates::garbleChunk(unsigned k) {
+  auto gates = this->parameters->chunk(k);
+  this->garble(gates);
+  MessageWriter writer(this->parameters->wireFormat);
+  auto circuit = this->memory->circuit;
+  auto garbler = this->parameters->garbler;
+  auto& garbledGates = this->memory->garbledGates;
+  for (auto id = gates.begin; id < gates.end; id++) {
+    auto width = garbler->ciphertextCount(circuit->gateType(id));
+    for (unsigned j = 0; j < width; j++)
+      writer.label(garbledGates[id - gates.begin][j], j);
+  }
+  return writer.take();
+}
+
+void Y::GenerateGarbledGates::garbleChunkInBackground(unsigned k) {
+  auto memory = this->memory;
+  memory->nextGarbledChunk = std::async(std::launch::async,
+    [generator = *this, memory, k] () mutable {
+      Timer timer;
+      timer.start();
+      auto message = generator.garbleChunk(k);
+      memory->nextGarblingTime = timer.display();
+      return message;
+    });
+}
+
+Y::SendGarbledGates::SendGarbledGates(
+  ParameterSet* parameters, SystemMemory* memory, unsigned chunk)
+  : SystemState(parameters, memory), chunk(chunk) {}
+
 bool Y::SendGarbledGates::isSend() {
   return true;
 }
 
 std::string Y::SendGarbledGates::message() {
-  std::stringstream ss;
-  for (auto& gate : this->memory->garbledGates)
-    for (auto& label : gate)
-      ss << label << ' ';
-  return ss.str();
+  auto memory = this->memory;
+  auto message = memory->nextGarbledChunk.get();
+  // The timer does not see the thread that garbled the chunk.
+  memory->timer.add(memory->nextGarblingTime);
+  auto k = this->chunk + 1;
+  if (k < this->parameters->chunkCount())
+    GenerateGarbledGates(this->parameters, memory).garbleChunkInBackground(k);
+  return message;
 }
 
 StatePtr Y::SendGarbledGates::next() {
   printf("I: SendGarbledGates::next\n");
   fflush(stdout);
-  return std::make_unique<SendSystemInputLabels>
-    (this->parameters, this->memory);
+  if (this->chunk + 1 < this->parameters->chunkCount())
+    return std::make_unique<SendGarbledGates>(
+      this->parameters, this->memory, this->chunk + 1);
+  return std::make_unique<SendFlagBitLabels>(this->parameters, this->memory);
 }
 
 bool Y::SendSystemInputLabels::isSend() {
@@ -213,50 +321,53 @@ std::vector<Label> Y::SendSystemInputLabels::systemInputLabels() {
   auto offset = this->parameters->monitorStateLength;
   for (unsigned i = 0; i < systemData.size(); i++) {
     auto index = systemData[i];
-    auto driverLabelPair = driverLabels[offset + i];
-    labels.push_back( driverLabelPair[index] );
+    labels.push_back( driverLabels[offset + i][index] );
   }
   return labels;
 }
 
 std::string Y::SendSystemInputLabels::message() {
-  std::stringstream ss;
+  MessageWriter writer(this->parameters->wireFormat);
   for (auto& label : this->systemInputLabels())
-    ss << label << ' ';
-  return ss.str();
+    writer.label(label);
+  return writer.take();
 }
 
 StatePtr Y::SendSystemInputLabels::next() {
   printf("I: SendSystemInputLabels::next\n");
   fflush(stdout);
-  return std::make_unique<SendFlagBitLabels>(this->parameters, this->memory);
+  if (this->memory->isFirstRound) {
+    this->memory->isFirstRound = false;
+    return std::make_unique<SystemObliviousTransfer>
+      (this->parameters, this->memory);
+  }
+  return std::make_unique<SendGarbledGates>(
+    this->parameters, this->memory, 0);
 }
 
 bool Y::SendFlagBitLabels::isSend() {
   return true;
 }
 
-LabelPair Y::SendFlagBitLabels::flagBitLabels() {
+LabelPair Y::SendFlagBitLabels::flagBitDigests() {
   // ASSUMPTION: flag bit is always output from the last gate (driver).
   auto& driverLabels = this->memory->driverLabels;
-  return driverLabels.back();
+  auto tweak = gateTweak(this->memory->round, driverLabels.size() - 1);
+  auto& labels = driverLabels.back();
+  return {
+    flagBitDigest(labels[0], tweak), flagBitDigest(labels[1], tweak) };
 }
 
 std::string Y::SendFlagBitLabels::message() {
-  std::stringstream ss;
-  for (auto& label : this->flagBitLabels())
-    ss << label << ' ';
-  return ss.str();
+  MessageWriter writer(this->parameters->wireFormat);
+  for (auto& digest : this->flagBitDigests())
+    writer.label(digest);
+  return writer.take();
 }
 
 StatePtr Y::SendFlagBitLabels::next() {
   printf("I: SendFlagBitLabels::next\n");
   fflush(stdout);
-  if (this->memory->isFirstRound) {
-    this->memory->isFirstRound = false;
-    return std::make_unique<SystemObliviousTransfer>
-      (this->parameters, this->memory);
-  }
   return std::make_unique<RecvFlagBit> (this->parameters, this->memory);
 }
 
@@ -271,7 +382,9 @@ Y::SystemObliviousTransfer::SystemObliviousTransfer(
   this->OTParameters = std::make_unique<BM::ParameterSet>(
     BM::ParameterSet {
       .securityParameter= secParam,
-      .group = QuadraticResidueGroup(getSafePrime(secParam))
+      .group =
+        std::make_shared<QuadraticResidueGroup>(getSafePrime(secParam)),
+      .wireFormat = this->parameters->wireFormat
     }
   );
   this->senderMemory = std::make_unique<BM::SenderMemory>();
@@ -307,9 +420,9 @@ std::string Y::SystemObliviousTransfer::message() {
 void Y::SystemObliviousTransfer::setOTMessages() {
   auto& memory = this->memory;
   auto& senderMemory = this->senderMemory;
-  LabelPair inputDriverLabels = memory->driverLabels[this->counter];
+  auto& inputDriverLabels = memory->driverLabels[this->counter];
   for (unsigned i = 0; i < 2; i++)
-    senderMemory->messages[i] = inputDriverLabels[i];
+    senderMemory->messages[i] = inputDriverLabels[i].toHex();
 }
 
 StatePtr Y::SystemObliviousTransfer::next() {
@@ -317,7 +430,8 @@ StatePtr Y::SystemObliviousTransfer::next() {
   fflush(stdout);
   if (this->counter == this->parameters->monitorStateLength) {
     printf("I: ---- OT duration: %f ms\n", this->OTTimer.display());
-    return std::make_unique<RecvFlagBit>(this->parameters, this->memory);
+    return std::make_unique<SendGarbledGates>(
+      this->parameters, this->memory, 0);
   }
   this->OTTimer.resume();
   if (not this->state) {
@@ -340,8 +454,9 @@ bool Y::RecvFlagBit::isRecv() {
 StatePtr Y::RecvFlagBit::next() {
   printf("I: RecvFlagBit::next\n");
   fflush(stdout);
-  auto& message = this->memory->receivedMessage;
-  bool flagBit = std::stoi(message);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  bool flagBit = reader.number();
   auto& timer = this->memory->timer;
   printf("D: ==== round duration: %f ms ====\n", timer.display());
   fflush(stdout);
@@ -370,6 +485,7 @@ StatePtr Y::SystemCopyMonitorStateLabels::next() {
   for (unsigned i = 0; i < monitorStateLength; i++)
     driverLabels[i] = driverLabels[offset + i];
   driverLabels.resize(monitorStateLength);
+  this->memory->round++;
   return std::make_unique<GenerateGarbledGates>
     (this->parameters, this->memory);
 }
@@ -414,23 +530,29 @@ std::string Y::SendCircuit::message() {
   auto offset =
     this->parameters->monitorStateLength +
     this->parameters->systemStateLength;
-  auto drivers = this->memory->circuit->get();
-  std::stringstream ss;
+  auto circuit = this->memory->circuit;
+  MessageWriter writer(this->parameters->wireFormat);
   for (unsigned i = 0; i < this->parameters->gateCount; i++) {
-    auto gate = static_cast<Gate*>( drivers[offset + i] );
-    ss << gate->inputLeft << ' ';
-    ss << gate->inputRight << ' ';
-    ss << gate->id << ' ';
+    auto id = offset + i;
+    writer.number(circuit->inputLeft(id));
+    writer.number(circuit->inputRight(id));
+    writer.number(static_cast<unsigned>(circuit->gateType(id)));
+    writer.number(id);
   }
-  return ss.str();
+  return writer.take();
 }
 
 StatePtr Y::SendCircuit::next() {
   printf("I: SendCircuit::next\n");
   fflush(stdout);
-  return std::make_unique<RecvGarbledGates> (this->parameters, this->memory);
+  return std::make_unique<RecvSystemInputLabels>
+    (this->parameters, this->memory);
 }
 
+Y::RecvGarbledGates::RecvGarbledGates(
+  ParameterSet* parameters, MonitorMemory* memory, unsigned chunk)
+  : MonitorState(parameters, memory), chunk(chunk) {}
+
 bool Y::RecvGarbledGates::isRecv() {
   return true;
 }
@@ -438,32 +560,62 @@ bool Y::RecvGarbledGates::isRecv() {
 StatePtr Y::RecvGarbledGates::next() {
   printf("I: RecvGarbledGates::next\n");
   fflush(stdout);
-  auto message = this->memory->receivedMessage;
-  auto gateCount = this->parameters->gateCount;
   auto& garbledGates = this->memory->garbledGates;
-  std::tie(garbledGates, message) = readGarbledGates(message, gateCount);
-  return std::make_unique<RecvSystemInputLabels>
-    (this->parameters, this->memory);
+  auto circuit = this->memory->circuit;
+  auto garbler = this->parameters->garbler;
+  auto gates = this->parameters->chunk(this->chunk);
+  // Gates of earlier chunks are dropped once evaluated.
+  assert (garbledGates.empty());
+  garbledGates.reserve(gates.size());
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  for (auto id = gates.begin; id < gates.end; id++) {
+    // Gates of some types take fewer ciphertexts than others.
+    auto& gate = garbledGates.emplace_back();
+    auto width = garbler->ciphertextCount(circuit->gateType(id));
+    for (unsigned j = 0; j < width; j++)
+      gate[j] = reader.label(j);
+  }
+  return std::make_unique<EvaluateCircuit>
+    (this->parameters, this->memory, this->chunk);
 }
 
 bool Y::RecvSystemInputLabels::isRecv() {
   return true;
 }
 
+void Y::RecvSystemInputLabels::allocateSlots() {
+  auto memory = this->memory;
+  if (not memory->slotAllocation.slots.empty())
+    return;
+  if (memory->levelization.levels.empty())
+    memory->levelization =
+      memory->circuit->levelize(this->parameters->streamChunkSize);
+  memory->slotAllocation =
+    memory->circuit->allocateSlots(memory->levelization);
+  printf("D:   %u label slots for %u drivers\n",
+    memory->slotAllocation.slotCount, memory->circuit->size());
+}
+
 StatePtr Y::RecvSystemInputLabels::next() {
   printf("I: RecvSystemInputLabels::next\n");
   fflush(stdout);
-  auto message = this->memory->receivedMessage;
-  std::vector<Label> systemInputLabels;
-  std::tie(systemInputLabels, message) =
-    readStrings(message, this->parameters->systemStateLength);
-  // Store the received system input labels in memory
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  // Store the received system input labels in memory;
+  // inputs keep their ID's as slots.
+  this->allocateSlots();
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
   auto offset = this->parameters->monitorStateLength;
-  evaluatedDriverLabels.resize(this->memory->circuit->size());
-  for (unsigned i = 0; i < systemInputLabels.size(); i++)
-    evaluatedDriverLabels[offset + i] = systemInputLabels[i];
-  return std::make_unique<RecvFlagBitLabels>(this->parameters, this->memory);
+  evaluatedDriverLabels.resize(this->memory->slotAllocation.slotCount);
+  for (unsigned i = 0; i < this->parameters->systemStateLength; i++)
+    evaluatedDriverLabels[offset + i] = reader.label();
+  if (this->memory->isFirstRound) {
+    this->memory->isFirstRound = false;
+    return std::make_unique<Y::MonitorObliviousTransfer>
+      (this->parameters, this->memory);
+  }
+  return std::make_unique<RecvGarbledGates>(this->parameters, this->memory);
 }
 
 bool Y::RecvFlagBitLabels::isRecv() {
@@ -473,17 +625,11 @@ bool Y::RecvFlagBitLabels::isRecv() {
 StatePtr Y::RecvFlagBitLabels::next() {
   printf("I: RecvFlagBitLabels::next\n");
   fflush(stdout);
-  auto message = this->memory->receivedMessage;
-  std::vector<Label> flagBitLabels;
-  std::tie(flagBitLabels, message) = readStrings(message, 2);
-  this->memory->flagBitLabels[0] = flagBitLabels[0];
-  this->memory->flagBitLabels[1] = flagBitLabels[1];
-  if (this->memory->isFirstRound) {
-    this->memory->isFirstRound = false;
-    return std::make_unique<Y::MonitorObliviousTransfer>
-      (this->parameters, this->memory);
-  }
-  return std::make_unique<Y::EvaluateCircuit>(this->parameters, this->memory);
+  MessageReader reader(
+    this->parameters->wireFormat, this->memory->receivedMessage);
+  this->memory->flagBitDigests[0] = reader.label();
+  this->memory->flagBitDigests[1] = reader.label();
+  return std::make_unique<Y::SendFlagBit>(this->parameters, this->memory);
 }
 
 Y::MonitorObliviousTransfer::MonitorObliviousTransfer(
@@ -495,7 +641,9 @@ Y::MonitorObliviousTransfer::MonitorObliviousTransfer(
   this->OTParameters = std::make_unique<BM::ParameterSet>
     (BM::ParameterSet {
       .securityParameter = secParam,
-      .group = QuadraticResidueGroup(getSafePrime(secParam)) });
+      .group =
+        std::make_shared<QuadraticResidueGroup>(getSafePrime(secParam)),
+      .wireFormat = this->parameters->wireFormat });
   this->chooserMemory = std::make_unique<BM::ChooserMemory>();
   this->state = std::make_unique<BM::InitChooser>
     (this->OTParameters.get(), this->chooserMemory.get());
@@ -526,11 +674,12 @@ StatePtr Y::MonitorObliviousTransfer::next() {
   printf("I: MonitorObliviousTransfer::next\n");
   fflush(stdout);
   if (this->counter == this->parameters->monitorStateLength)
-    return std::make_unique<Y::EvaluateCircuit>(this->parameters, this->memory);
+    return std::make_unique<Y::RecvGarbledGates>
+      (this->parameters, this->memory);
 
   if (not this->state) {
     this->memory->evaluatedDriverLabels[this->counter] =
-      this->chooserMemory->chosenMessage;
+      Label::fromHex(this->chooserMemory->chosenMessage);
     this->counter++;
     this->setSigma();
     this->state = std::make_unique<BM::InitChooser>
@@ -542,26 +691,62 @@ StatePtr Y::MonitorObliviousTransfer::next() {
   return std::make_unique<Y::MonitorObliviousTransfer> (std::move(*this));
 }
 
-void Y::EvaluateCircuit::evaluateDriverLabels() {
-  auto drivers = this->memory->circuit->get();
+Y::EvaluateCircuit::EvaluateCircuit(
+  ParameterSet* parameters, MonitorMemory* memory, unsigned chunk)
+  : MonitorState(parameters, memory), chunk(chunk) {}
+
+void Y::EvaluateCircuit::evaluateGate(unsigned id, unsigned chunkBegin) {
+  auto circuit = this->memory->circuit;
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
+  auto& slots = this->memory->slotAllocation.slots;
   auto& garbledGates = this->memory->garbledGates;
-  auto offset =
-    this->parameters->monitorStateLength +
-    this->parameters->systemStateLength;
+  // printf("D:   evaluating gate %d\n", id);
+  auto&  leftLabel = evaluatedDriverLabels[slots[circuit->inputLeft(id)]];
+  auto& rightLabel = evaluatedDriverLabels[slots[circuit->inputRight(id)]];
+  // printf("     left  label (%d): %s\n", circuit->inputLeft(id), leftLabel.toHex().c_str());
+  // printf("     right label (%d): %s\n", circuit->inputRight(id), rightLabel.toHex().c_str());
+  // fflush(stdout);
+  auto outLabel = this->parameters->garbler->dec(
+    leftLabel, rightLabel, garbledGates[id - chunkBegin],
+    gateTweak(this->memory->round, id), circuit->gateType(id));
+  // printf("     out   label (%d): %s\n", id, outLabel.toHex().c_str());
+  evaluatedDriverLabels[slots[id]] = outLabel;
+}
 
-  for (unsigned i = 0; i < this->parameters->gateCount; i++) {
-    // printf("D:   evaluating gate %d\n", i);
-    auto gate = static_cast<Gate*>(drivers[offset + i]);
-    auto  leftLabel = evaluatedDriverLabels[gate->inputLeft];
-    auto rightLabel = evaluatedDriverLabels[gate->inputRight];
-    // printf("     left  label (%d): %s\n", gate->inputLeft, leftLabel.c_str());
-    // printf("     right label (%d): %s\n", gate->inputRight, rightLabel.c_str());
-    // fflush(stdout);
-    auto outLabel = this->parameters->garbler->dec(
-      leftLabel, rightLabel, garbledGates[gate->id - offset]);
-    // printf("     out   label (%d): %s\n", gate->id, outLabel.c_str());
-    evaluatedDriverLabels[gate->id] = outLabel;
+void Y::EvaluateCircuit::evaluateDriverLabels() {
+  // Levels of a chunk are above those of earlier chunks
+  // (see Circuit::levelize()); so, its gates take the positions
+  // of their ID's in the level order.
+  auto gates = this->parameters->chunk(this->chunk);
+  auto begin = gates.begin - this->parameters->inputLength();
+  auto end = gates.end - this->parameters->inputLength();
+  if (begin == end)
+    return;
+  // Label slots are allocated for evaluation in level order;
+  // so, gates are evaluated in that order even on a single thread.
+  auto& levelization = this->memory->levelization;
+  auto pool = this->parameters->threadPool;
+  if (pool == nullptr or pool->size() == 1) {
+    for (auto i = begin; i < end; i++)
+      this->evaluateGate(levelization.order[i], gates.begin);
+    return;
+  }
+
+  // Gates of the same level only depend on gates of lower levels;
+  // so, levels are evaluated one after another,
+  // and the gates of each level in parallel.
+  auto& levels = levelization.levels;
+  auto firstLevel = levels[levelization.order[begin]];
+  auto lastLevel = levels[levelization.order[end - 1]];
+  for (auto k = firstLevel; k <= lastLevel; k++) {
+    auto level = levelization.level(k);
+    assert (begin <= level.begin and level.end <= end);
+    pool->parallelFor(
+      level.begin, level.end, Y::EVALUATION_CHUNK_SIZE,
+      [this, &levelization, &gates] (size_t begin, size_t end) {
+        for (auto j = begin; j < end; j++)
+          this->evaluateGate(levelization.order[j], gates.begin);
+      });
   }
 }
 
@@ -569,7 +754,12 @@ StatePtr Y::EvaluateCircuit::next() {
   printf("I: EvaluateCircuit::next\n");
   fflush(stdout);
   this->evaluateDriverLabels();
-  return std::make_unique<Y::SendFlagBit> (this->parameters, this->memory);
+  this->memory->garbledGates.clear();
+  if (this->chunk + 1 < this->parameters->chunkCount())
+    return std::make_unique<Y::RecvGarbledGates>
+      (this->parameters, this->memory, this->chunk + 1);
+  return std::make_unique<Y::RecvFlagBitLabels>
+    (this->parameters, this->memory);
 }
 
 bool Y::SendFlagBit::isSend() {
@@ -577,17 +767,20 @@ bool Y::SendFlagBit::isSend() {
 }
 
 bool Y::SendFlagBit::getFlagBit() {
-  auto& flagBitLabels = this->memory->flagBitLabels;
+  auto& flagBitDigests = this->memory->flagBitDigests;
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
-  auto flagBitLabel = evaluatedDriverLabels.back();
-  assert (
-    flagBitLabel == flagBitLabels[0] or
-    flagBitLabel == flagBitLabels[1]   );
-  return flagBitLabel == flagBitLabels[1];
+  auto& slots = this->memory->slotAllocation.slots;
+  auto id = slots.size() - 1;
+  auto digest = flagBitDigest(
+    evaluatedDriverLabels[slots[id]], gateTweak(this->memory->round, id));
+  assert (digest == flagBitDigests[0] or digest == flagBitDigests[1]);
+  return digest == flagBitDigests[1];
 }
 
 std::string Y::SendFlagBit::message() {
-  return std::to_string(this->getFlagBit());
+  MessageWriter writer(this->parameters->wireFormat);
+  writer.number(this->getFlagBit());
+  return writer.take();
 }
 
 StatePtr Y::SendFlagBit::next() {
@@ -617,11 +810,19 @@ StatePtr Y::MonitorCopyMonitorStateLabels::next() {
   fflush(stdout);
   auto monitorStateLength = this->parameters->monitorStateLength;
   auto& evaluatedDriverLabels = this->memory->evaluatedDriverLabels;
+  auto& slots = this->memory->slotAllocation.slots;
   auto offset =
     this->parameters->systemStateLength + this->parameters->gateCount - 1;
+  // Output slots may be input slots of other monitor state bits;
+  // so, all outputs are read before any input is written.
+  std::vector<Label> nextState(monitorStateLength);
   for (unsigned i = 0; i < monitorStateLength; i++)
-    evaluatedDriverLabels[i] = evaluatedDriverLabels[offset + i];
-  return std::make_unique<Y::RecvGarbledGates> (this->parameters, this->memory);
+    nextState[i] = evaluatedDriverLabels[slots[offset + i]];
+  for (unsigned i = 0; i < monitorStateLength; i++)
+    evaluatedDriverLabels[i] = std::move(nextState[i]);
+  this->memory->round++;
+  return std::make_unique<Y::RecvSystemInputLabels>
+    (this->parameters, this->memory);
 }
 
 StatePtr Y::MonitorDone::next() {
@@ -5,27 +5,24 @@
 #include "YaoGarbler.hh"
 
 GarbledGate YaoGarbler::enc(
-  LabelPair left,
-  LabelPair right,
-  LabelPair out)
+  const LabelPair& left,
+  const LabelPair& right,
+  LabelPair& out,
+  uint64_t tweak,
+  GateType type)
 {
-  std::vector<Label> labels;
-  labels.reserve(3 * 2);
-  labels.insert(labels.end(), left.begin(), left.end());
-  labels.insert(labels.end(), right.begin(), right.end());
-  labels.insert(labels.end(), out.begin(), out.end());
+  std::vector<const Label*> labels = {
+    &left[0], &left[1], &right[0], &right[1], &out[0], &out[1] };
   if (not checkLabels(labels))
     throw InvalidLabels();
 
   GarbledGate gate;
-  // ****************************************************************
-  // * ASSUMPTION: Every gate is a 2-input NAND gate.               *
-  // * TODO: Generalize to arbitrary gates.                         *
-  // ****************************************************************
-  gate[0] = this->encImpl(left[0], right[0], out[1]);
-  gate[1] = this->encImpl(left[0], right[1], out[1]);
-  gate[2] = this->encImpl(left[1], right[0], out[1]);
-  gate[3] = this->encImpl(left[1], right[1], out[0]);
+  // Row 2a + b encrypts the output label for inputs (a, b).
+  // For NOT gates, rows with a != b are never decrypted.
+  for (unsigned a = 0; a < 2; a++)
+    for (unsigned b = 0; b < 2; b++)
+      gate[2 * a + b] = this->encImpl(
+        left[a], right[b], out[evaluateGate(type, a, b)]);
 
   // Garbled gate is a random permutation of the encrypted values.
   // ****************************************************************
@@ -39,9 +36,11 @@ GarbledGate YaoGarbler::enc(
 }
 
 Label YaoGarbler::dec(
-  Label left,
-  Label right,
-  GarbledGate gate)
+  const Label& left,
+  const Label& right,
+  const GarbledGate& gate,
+  uint64_t tweak,
+  GateType type)
 {
   // ****************************************************************
   // * ASSUMPTION: Labels and ciphertexts are of appropriate sizes. *
@@ -57,3 +56,40 @@ Label YaoGarbler::dec(
     throw InvalidCipher();
   return labels[0];
 }
+
+unsigned YaoGarbler::ciphertextCount(GateType type) {
+  return 4;
+}
+
+// One pad per row; decryption tries every row.
+unsigned YaoGarbler::garblingHashCount(GateType type) {
+  return 4;
+}
+
+unsigned YaoGarbler::evaluationHashCount(GateType type) {
+  return 4;
+}
+
+bool YaoGarbler::derivesOutputLabels() {
+  return false;
+}
+
+LabelPair YaoGarbler::randomLabelPair(unsigned length) {
+  return { Label::random(length), Label::random(length) };
+}
+
+bool YaoGarbler::checkLabels(const std::vector<const Label*>& labels) {
+  throw std::logic_error("YaoGarbler::checkLabels is not implemented");
+}
+
+Ciphertext YaoGarbler::encImpl(
+  const Label& left, const Label& right, const Label& out)
+{
+  throw std::logic_error("YaoGarbler::encImpl is not implemented");
+}
+
+Label YaoGarbler::decImpl(
+  const Label& left, const Label& right, const Ciphertext& cipher)
+{
+  throw std::logic_error("YaoGarbler::decImpl is not implemented");
+}